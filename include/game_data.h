@@ -3,12 +3,16 @@
 
 #include <player/core/player.h>
 #include <util.h>
+#include <util/settings.h>
 #include <string.h>
 #include <stdlib.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <unistd.h>
 
-#define FLOATS_PER_MODEL_VERT 8
+// Rotations a custom model can be placed with: 0-3 are quarter turns about
+// the Y axis, 4 flips the model upside down
+#define MODEL_ROTATION_COUNT 5
 
 typedef struct {
     int x, y, z;
@@ -22,120 +26,184 @@ typedef struct {
     int ao;  // Packed AO values for 4 vertices (2 bits each, values 0-3)
 } side_instance;
 
+// A placed Blockbench model. The model geometry lives on the GPU, chunks only
+// carry one of these per block. All ints so it uploads as-is.
+typedef struct {
+    int x, y, z;
+    int model_id;  // blockbench_model id
+    int rotation;  // 0 to MODEL_ROTATION_COUNT - 1
+} model_instance;
+
+// Face lists a chunk mesh is split into, each drawn by its own pass
+typedef enum {
+    MESH_LAYER_OPAQUE = 0,
+    MESH_LAYER_TRANSPARENT,
+    MESH_LAYER_LIQUID,
+    MESH_LAYER_FOLIAGE,
+    MESH_LAYER_COUNT
+} mesh_layer;
+
+// Which faces of a chunk section see each other through its open blocks, one
+// bit per pair of block sides (NORTH to DOWN). Built when a chunk is meshed.
+typedef uint16_t section_visibility;
+
+#define SECTION_OPEN 0x7FFF  // every face sees every other one
+#define SECTION_CLOSED 0     // solid, no face sees another
+
+static inline int section_face_pair_bit(int a, int b) {
+    if (a > b) {
+        int t = a;
+        a = b;
+        b = t;
+    }
+    return a * (11 - a) / 2 + b - a - 1;
+}
+
+static inline int section_faces_connected(section_visibility visibility, int a, int b) {
+    return a == b || (visibility >> section_face_pair_bit(a, b)) & 1;
+}
+
+#define SIDE_DIRECTIONS 6
+#define MAX_SIDE_BUCKETS (SIDE_DIRECTIONS * VISIBILITY_SECTIONS)
+
+// How the sides of a layer are grouped so the renderer can skip whole
+// buckets: by block side, then by section. Bucket side * sections + section
+// holds sides starts[b] to starts[b + 1].
+typedef struct {
+    int directions;  // SIDE_DIRECTIONS, or 1 when sides are not split by side
+    int sections;    // VISIBILITY_SECTIONS, or 1 when the layer is depth sorted
+    int starts[MAX_SIDE_BUCKETS + 1];
+} side_buckets;
+
 typedef struct {
     int x, z;
     side_instance* opaque_sides;
     side_instance* liquid_sides;
     side_instance* transparent_sides;
     side_instance* foliage_sides;
-    float* custom_model_data;
+    model_instance* model_instances;
     int num_opaque_sides;
     int num_transparent_sides;
     int num_liquid_sides;
     int num_foliage_sides;
-    int num_custom_verts;
+    int num_model_instances;
     short lod_scale;
+    short adj_lod_scales[4]; // neighbour LODs the borders were stitched against
+    unsigned int layer_versions[MESH_LAYER_COUNT]; // change whenever that layer's faces do
+    section_visibility visibility[VISIBILITY_SECTIONS];
+    side_buckets buckets[MESH_LAYER_COUNT];
 } chunk_mesh;
 
+// One layer of a chunk in upload layout, VBO_WIDTH ints per side. Never
+// changed once packed and shared between world meshes by reference count.
 typedef struct {
-    int num_opaque_sides;
-    int num_transparent_sides;
-    int num_liquid_sides;
-    int num_foliage_sides;
-    int num_custom_verts;
+    atomic_int refs;
+    unsigned int version;  // layer_versions entry it was packed from
+    int num_sides;
+    side_buckets buckets;
+    int data[];
+} packed_sides;
+
+static inline packed_sides* retain_packed_sides(packed_sides* sides) {
+    if (sides != NULL) {
+        atomic_fetch_add_explicit(&sides->refs, 1, memory_order_relaxed);
+    }
+    return sides;
+}
 
-    int* transparent_data;
-    int* opaque_data;
-    int* liquid_data;
-    int* foliage_data;
-    float* custom_model_data;
+static inline void release_packed_sides(packed_sides* sides) {
+    if (sides != NULL && atomic_fetch_sub_explicit(&sides->refs, 1, memory_order_acq_rel) == 1) {
+        free(sides);
+    }
+}
+
+// A chunk of a world mesh, NULL layers have no faces
+typedef struct {
+    int x, z;
+    packed_sides* layers[MESH_LAYER_COUNT];
+    section_visibility visibility[VISIBILITY_SECTIONS];
+} world_mesh_chunk;
+
+// Every chunk in render distance. The renderer keeps their faces on the GPU,
+// uploads a layer again only when its version changes and culls the chunks
+// against the view itself.
+typedef struct {
+    unsigned int version;      // grows with every world mesh built, never 0
+    int num_chunks;
+    world_mesh_chunk* chunks;  // back to front
+    int num_sides[MESH_LAYER_COUNT];
+    int num_model_instances;
+    model_instance* model_instances;  // grouped by model_id
 } world_mesh;
 
 static inline void free_world_mesh(world_mesh* mesh) {
     if (mesh == NULL) {
         return;
     }
-    free(mesh->transparent_data);
-    free(mesh->opaque_data);
-    free(mesh->liquid_data);
-    if (mesh->num_foliage_sides > 0) {
-        free(mesh->foliage_data);
-    }
-    if (mesh->num_custom_verts > 0) {
-        free(mesh->custom_model_data);
+    for (int i = 0; i < mesh->num_chunks; i++) {
+        for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+            release_packed_sides(mesh->chunks[i].layers[layer]);
+        }
     }
+    free(mesh->chunks);
+    free(mesh->model_instances);
     free(mesh);
 }
 
-typedef struct double_buffer_t {
-    // buffers;
-    world_mesh* a;
-    world_mesh* b;
-    int a_count, b_count;
-    pthread_mutex_t a_lock, b_lock;
-    pthread_mutex_t selector_lock;
-
-    // t = a, 
-    // f = b
-    bool read_buffer;
-} double_buffer_t;
-
-static inline double_buffer_t* create_double_buffer() {
-    double_buffer_t* buf = malloc(sizeof(double_buffer_t));
-
-    buf->read_buffer = 0;
-    buf->a = NULL;
-    buf->b = NULL;
-
-    pthread_mutex_init(&buf->a_lock, NULL);
-    pthread_mutex_init(&buf->b_lock, NULL);
-    pthread_mutex_init(&buf->selector_lock, NULL);
-
-    return buf;
-}
+#define WORLD_MESH_UNREAD 4
 
-static inline void lock_double_buffer(double_buffer_t* buf, bool target_buffer) {
+// Hands world meshes from the mesh pipeline to the render thread without
+// locks or copies. Each side owns one of three slots, the third is swapped
+// through middle: the writer puts a finished mesh there, the reader takes it
+// when it is unread. Neither ever touches a mesh the other one holds, and the
+// faces the meshes share are reference counted.
+typedef struct {
+    world_mesh* slots[3];
+    atomic_int middle;  // slot index, | WORLD_MESH_UNREAD until the reader takes it
+    int back;           // the writer's slot
+    int front;          // the reader's slot
+} world_mesh_buffer;
+
+static inline world_mesh_buffer* create_world_mesh_buffer(void) {
+    world_mesh_buffer* buf = calloc(1, sizeof(world_mesh_buffer));
     if (buf == NULL) {
-        printf("ERROR: Failed to lock double buffer.  Argument \"buf\" cannot be NULL.\n");
-        return;
-    }
-
-    if (target_buffer) {
-        pthread_mutex_lock(&buf->a_lock);
-    }
-    else {
-        pthread_mutex_lock(&buf->b_lock);
+        printf("ERROR: Failed to allocate world mesh buffer.\n");
+        return NULL;
     }
+    buf->back = 0;
+    atomic_init(&buf->middle, 1);
+    buf->front = 2;
+    return buf;
 }
 
-static inline void unlock_double_buffer(double_buffer_t* buf, bool target_buffer) {
+static inline void destroy_world_mesh_buffer(world_mesh_buffer* buf) {
     if (buf == NULL) {
-        printf("ERROR: Failed to lock double buffer.  Argument \"buf\" cannot be NULL.\n");
         return;
     }
-
-    if (target_buffer) {
-        pthread_mutex_unlock(&buf->a_lock);
-    }
-    else {
-        pthread_mutex_unlock(&buf->b_lock);
+    for (int i = 0; i < 3; i++) {
+        free_world_mesh(buf->slots[i]);
     }
+    free(buf);
 }
 
-static inline void write_double_buffer(double_buffer_t* buf, world_mesh* new_mesh) {
-    pthread_mutex_lock(&buf->selector_lock);
-
-    bool target = !buf->read_buffer;
-    world_mesh** addr = target ? &buf->a : &buf->b;
-    lock_double_buffer(buf, target);
-
-    world_mesh* old = *addr;
-    *addr = new_mesh;
-    free_world_mesh(old);
+// Writer side, takes ownership of mesh
+static inline void publish_world_mesh(world_mesh_buffer* buf, world_mesh* mesh) {
+    // Whatever is left in our slot was either read and handed back or
+    // replaced before the reader got to it
+    free_world_mesh(buf->slots[buf->back]);
+    buf->slots[buf->back] = mesh;
+    buf->back = atomic_exchange_explicit(&buf->middle, buf->back | WORLD_MESH_UNREAD, memory_order_acq_rel)
+        & ~WORLD_MESH_UNREAD;
+}
 
-    buf->read_buffer = target;
-    pthread_mutex_unlock(&buf->selector_lock);
-    unlock_double_buffer(buf, target);
+// Reader side, the newest published mesh or NULL before the first one. It
+// stays valid until the next call.
+static inline world_mesh* acquire_world_mesh(world_mesh_buffer* buf) {
+    if (atomic_load_explicit(&buf->middle, memory_order_relaxed) & WORLD_MESH_UNREAD) {
+        buf->front = atomic_exchange_explicit(&buf->middle, buf->front, memory_order_acq_rel)
+            & ~WORLD_MESH_UNREAD;
+    }
+    return buf->slots[buf->front];
 }
 
 typedef struct {
@@ -143,7 +211,7 @@ typedef struct {
     int z;
     int* num_packets;
     chunk_mesh** packet;
-    double_buffer_t* world_mesh;
+    world_mesh_buffer* world_mesh;
     player player;
     int is_running;
     bool mesh_requires_update;
@@ -157,7 +225,7 @@ typedef struct {
 } game_data;
 
 static inline void destroy_game_data(game_data data) {
-    free(data.world_mesh);
+    destroy_world_mesh_buffer(data.world_mesh);
     free(data.packet);
 }
 
@@ -166,76 +234,4 @@ static inline void update_game_data(game_data* data) {
     data->z = data->player.cam.position[2];
 }
 
-static inline world_mesh* copy_world_mesh(double_buffer_t* buf) {
-    world_mesh* src = NULL;
-
-    pthread_mutex_lock(&buf->selector_lock);
-    bool target = buf->read_buffer;
-    pthread_mutex_unlock(&buf->selector_lock);
-
-    lock_double_buffer(buf, target);
-
-    if (target) {
-        src = buf->a;
-    } else {
-        src = buf->b;
-    }
- 
-    if (!src) {
-        unlock_double_buffer(buf, target);
-        return NULL;
-    }
-    
-    world_mesh* copy = (world_mesh*)malloc(sizeof(world_mesh));
-    copy->num_opaque_sides = src->num_opaque_sides;
-    copy->num_transparent_sides = src->num_transparent_sides;
-    copy->num_liquid_sides = src->num_liquid_sides;
-    copy->num_foliage_sides = src->num_foliage_sides;
-    copy->num_custom_verts = src->num_custom_verts;
-    
-    if (src->opaque_data && src->num_opaque_sides > 0) {
-        int opaque_size = src->num_opaque_sides * VBO_WIDTH;
-        copy->opaque_data = (int*)malloc(sizeof(int) * opaque_size);
-        memcpy(copy->opaque_data, src->opaque_data, sizeof(int) * opaque_size);
-    } else {
-        copy->opaque_data = NULL;
-    }
-    
-    if (src->transparent_data && src->num_transparent_sides > 0) {
-        int transparent_size = src->num_transparent_sides * VBO_WIDTH;
-        copy->transparent_data = (int*)malloc(sizeof(int) * transparent_size);
-        memcpy(copy->transparent_data, src->transparent_data, sizeof(int) * transparent_size);
-    } else {
-        copy->transparent_data = NULL;
-    }
-    
-    if (src->liquid_data && src->num_liquid_sides > 0) {
-        int liquid_size = src->num_liquid_sides * VBO_WIDTH;
-        copy->liquid_data = (int*)malloc(sizeof(int) * liquid_size);
-        memcpy(copy->liquid_data, src->liquid_data, sizeof(int) * liquid_size);
-    } else {
-        copy->liquid_data = NULL;
-    }
-    
-    if (src->foliage_data && src->num_foliage_sides > 0) {
-        int foliage_size = src->num_foliage_sides * VBO_WIDTH;
-        copy->foliage_data = (int*)malloc(sizeof(int) * foliage_size);
-        memcpy(copy->foliage_data, src->foliage_data, sizeof(int) * foliage_size);
-    } else {
-        copy->foliage_data = NULL;
-    }
-    
-    if (src->custom_model_data && src->num_custom_verts > 0) {
-        size_t custom_model_size = sizeof(float) * FLOATS_PER_MODEL_VERT * src->num_custom_verts;
-        copy->custom_model_data = (float*)malloc(custom_model_size);
-        memcpy(copy->custom_model_data, src->custom_model_data, custom_model_size);
-    } else {
-        copy->custom_model_data = NULL;
-    }
-
-    unlock_double_buffer(buf, target);
-    
-    return copy;
-}
-
 #endif
@@ -0,0 +1,23 @@
+#version 330 core
+
+in vec2 texCoord;
+
+out vec4 FragColor;
+
+uniform sampler2D accum;
+uniform sampler2D weight;
+
+void main() {
+    vec4 accumColor = texture(accum, texCoord);
+    float revealage = accumColor.a;
+
+    // nothing transparent covered this pixel
+    if (revealage >= 1.0) {
+        discard;
+    }
+
+    float totalWeight = max(texture(weight, texCoord).r, 1e-5);
+    vec3 averageColor = accumColor.rgb / totalWeight;
+
+    FragColor = vec4(averageColor, 1.0 - revealage);
+}
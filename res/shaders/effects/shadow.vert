@@ -7,8 +7,7 @@ layout (location = 3) in int aSide;
 layout (location = 4) in int aUnderwater;
 layout (location = 8) in int aLodScale;
 
-uniform mat4 sunView;
-uniform mat4 sunProj;
+uniform mat4 lightSpace;  // sun projection * view of the cascade
 
 vec3 transformFace(vec3 pos, int face) {
     vec3 side = pos;
@@ -33,5 +32,5 @@ void main() {
     vec3 instancePos = vec3(aInstancePos);
     vec3 worldPos = transformFace(aPos, aSide) + instancePos;
 
-    gl_Position = sunProj * sunView * vec4(worldPos, 1.0);
+    gl_Position = lightSpace * vec4(worldPos, 1.0);
 }
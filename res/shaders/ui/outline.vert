@@ -3,8 +3,13 @@
 layout (location = 0) in vec3 aPos;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 proj;
+
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 proj;
+    vec3 cameraPos;
+    float time;
+};
 
 void main() {
     gl_Position = proj * view * model * vec4(aPos, 1.0);
@@ -3,23 +3,33 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aUV;
+layout (location = 3) in ivec3 aInstancePos;
+layout (location = 4) in int aRotation;
 
 out vec2 texCoord;
 out vec3 normal;
 out vec3 fragPos;
 out float dist;
 
-uniform mat4 view;
-uniform mat4 proj;
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 proj;
+    vec3 cameraPos;
+    float time;
+};
+
 uniform float atlasSize;
+uniform mat4 modelRotations[5];
 
 void main() {
-    gl_Position = proj * view * vec4(aPos, 1.0);
+    mat4 rotation = modelRotations[aRotation];
+    vec3 worldPos = (rotation * vec4(aPos, 1.0)).xyz + vec3(aInstancePos);
+    gl_Position = proj * view * vec4(worldPos, 1.0);
     
     texCoord = vec2(aUV.x, aUV.y);
     
-    normal = aNormal;
-    fragPos = aPos;
+    normal = mat3(rotation) * aNormal;
+    fragPos = worldPos;
     
     dist = length(gl_Position.xyz);
 }
@@ -11,27 +11,39 @@ out vec4 FragColor;
 
 uniform sampler2D atlas;
 uniform sampler2D bump;
-uniform sampler2D shadowMap;
+uniform sampler2DArray shadowMap;
 uniform sampler2D caustic;
 
 uniform float atlasSize;
-uniform float time;
-uniform float shadowSoftness;
-uniform float shadowBias;
-uniform int shadowSamples;
-uniform float fogDistance;
 uniform float waterLevel;
 
-uniform mat4 sunView;
-uniform mat4 sunProj;
-uniform vec3 sunPos;
-uniform vec3 sunColor;
-uniform float sunSpecularStrength;
-uniform float waterShininess;
-uniform vec3 ambientLight;
-uniform vec3 cameraPos;
-uniform mat4 view;
-uniform mat4 proj;
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 proj;
+    vec3 cameraPos;
+    float time;
+};
+
+layout (std140) uniform Sun {
+    vec3 sunPos;
+    float sunIntensity;
+    vec3 sunColor;
+    float sunSpecularStrength;
+    vec3 ambientLight;
+    float waterShininess;
+};
+
+layout (std140) uniform Fog {
+    float fogDistance;
+};
+
+layout (std140) uniform Shadow {
+    mat4 sunCascades[4];  // narrowest first
+    float shadowSoftness;
+    float shadowBias;
+    int shadowSamples;
+    int shadowCascades;
+};
 
 float getDiffuse(vec3 normal, vec3 lightDir) {
     return max(dot(normal, lightDir), 0.0);
@@ -44,26 +56,38 @@ float getSpecular(vec3 normal, vec3 lightDir, vec3 viewDir, float strength, floa
 }
 
 vec3 getShadowIntensity(vec2 coord) {
-    vec3 fragLightPos = vec3(sunProj * sunView * vec4(fragPos, 1.0));
-
-    vec2 uvCoord;
-    uvCoord.x = 0.5 * fragLightPos.x + 0.5;
-    uvCoord.y = 0.5 * fragLightPos.y + 0.5;
-
-    float z = 0.5 * fragLightPos.z + 0.5;
-    
     if (sunPos.y < -0.2) {
         return vec3(0.0);
     }
+
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    vec2 kernel = texelSize * shadowSoftness * float(shadowSamples / 2 + 1);
+
+    // The narrowest cascade that holds the fragment and the PCF kernel
+    int cascade = -1;
+    vec3 fragLightPos;
+    for (int i = 0; i < shadowCascades; i++) {
+        fragLightPos = 0.5 * vec3(sunCascades[i] * vec4(fragPos, 1.0)) + 0.5;
+        if (all(greaterThan(fragLightPos.xy, kernel)) && all(lessThan(fragLightPos.xy, 1.0 - kernel))) {
+            cascade = i;
+            break;
+        }
+    }
+    if (cascade < 0) {
+        return vec3(1.0);
+    }
+
+    vec2 uvCoord = fragLightPos.xy;
+    float z = fragLightPos.z;
     
+    // PCF (Percentage-Closer Filtering)
     float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
     
     int sampleCount = 0;
     for(int x = -(shadowSamples / 2); x <= (shadowSamples / 2); ++x) {
         for(int y = -(shadowSamples / 2); y <= (shadowSamples / 2); ++y) {
             vec2 sampleCoord = uvCoord + vec2(x, y) * texelSize * shadowSoftness;
-            float depth = texture(shadowMap, sampleCoord).r;
+            float depth = texture(shadowMap, vec3(sampleCoord, cascade)).r;
             shadow += (depth < z - shadowBias) ? 0.0 : 1.0;
             sampleCount++;
         }
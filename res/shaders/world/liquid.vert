@@ -17,10 +17,14 @@ out vec3 fragPos;
 out float dist;
 flat out int faceType;
 
-uniform mat4 view;
-uniform mat4 proj;
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 proj;
+    vec3 cameraPos;
+    float time;
+};
+
 uniform float waterLevel;
-uniform float time;
 
 vec3 transformFace(vec3 pos, int face) {
     vec3 side = pos;
@@ -7,47 +7,73 @@ in float dist; // distance from the camera
 in vec3 normal;
 in float aoFactor; // ambient occlusion factor (0.4 - 1.0)
 
-out vec4 FragColor;
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out vec4 OitWeight;
+
+// 0: regular blending, 1: opaque texels only, 2: weighted blended accumulation
+uniform int transparencyPass;
+const float OIT_OPAQUE_ALPHA = 0.99;
 
 uniform float atlasSize;
 uniform sampler2D atlas;
 uniform sampler2D bump;
-uniform sampler2D shadowMap;
-uniform float shadowSoftness;
-uniform float shadowBias;
-uniform int shadowSamples;
-uniform float fogDistance;
-uniform vec3 sunPos;
-uniform vec3 sunColor;
-uniform float sunIntensity;
-uniform mat4 sunView;
-uniform mat4 sunProj;
-uniform vec3 ambientLight;
+uniform sampler2DArray shadowMap;
 
+layout (std140) uniform Sun {
+    vec3 sunPos;
+    float sunIntensity;
+    vec3 sunColor;
+    float sunSpecularStrength;
+    vec3 ambientLight;
+    float waterShininess;
+};
 
-vec3 getShadowIntensity(vec2 coord) {
-    vec3 fragLightPos = vec3(sunProj * sunView * vec4(fragPos, 1.0));
+layout (std140) uniform Fog {
+    float fogDistance;
+};
 
-    vec2 uvCoord;
-    uvCoord.x = 0.5 * fragLightPos.x + 0.5;
-    uvCoord.y = 0.5 * fragLightPos.y + 0.5;
+layout (std140) uniform Shadow {
+    mat4 sunCascades[4];  // narrowest first
+    float shadowSoftness;
+    float shadowBias;
+    int shadowSamples;
+    int shadowCascades;
+};
 
-    float z = 0.5 * fragLightPos.z + 0.5;
-    
+vec3 getShadowIntensity(vec2 coord) {
     // total shadow if night time
     if (sunPos.y < -0.2) {
         return vec3(0.0);
     }
+
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    vec2 kernel = texelSize * shadowSoftness * float(shadowSamples / 2 + 1);
+
+    // The narrowest cascade that holds the fragment and the PCF kernel
+    int cascade = -1;
+    vec3 fragLightPos;
+    for (int i = 0; i < shadowCascades; i++) {
+        fragLightPos = 0.5 * vec3(sunCascades[i] * vec4(fragPos, 1.0)) + 0.5;
+        if (all(greaterThan(fragLightPos.xy, kernel)) && all(lessThan(fragLightPos.xy, 1.0 - kernel))) {
+            cascade = i;
+            break;
+        }
+    }
+    if (cascade < 0) {
+        return vec3(1.0);
+    }
+
+    vec2 uvCoord = fragLightPos.xy;
+    float z = fragLightPos.z;
     
     // PCF (Percentage-Closer Filtering)
     float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
     
     int sampleCount = 0;
     for(int x = -(shadowSamples / 2); x <= (shadowSamples / 2); ++x) {
         for(int y = -(shadowSamples / 2); y <= (shadowSamples / 2); ++y) {
             vec2 sampleCoord = uvCoord + vec2(x, y) * texelSize * shadowSoftness;
-            float depth = texture(shadowMap, sampleCoord).r;
+            float depth = texture(shadowMap, vec3(sampleCoord, cascade)).r;
             shadow += (depth < z - shadowBias) ? 0.0 : 1.0;
             sampleCount++;
         }
@@ -57,6 +83,30 @@ vec3 getShadowIntensity(vec2 coord) {
     return vec3(shadow);
 }
 
+// Weighted blended OIT weight (McGuire and Bavoil, equation 7)
+float oitWeight(float alpha) {
+    return alpha * clamp(10.0 / (1e-5 + pow(dist / 5.0, 2.0) + pow(dist / 200.0, 6.0)), 1e-2, 3e3);
+}
+
+void writeColor(vec4 color) {
+    if (transparencyPass == 1) {
+        // opaque texels are drawn normally so they keep writing depth
+        if (color.a < OIT_OPAQUE_ALPHA) {
+            discard;
+        }
+        FragColor = vec4(color.rgb, 1.0);
+    } else if (transparencyPass == 2) {
+        if (color.a >= OIT_OPAQUE_ALPHA) {
+            discard;
+        }
+        float w = oitWeight(color.a);
+        FragColor = vec4(color.rgb * w, color.a);
+        OitWeight = vec4(w, 0.0, 0.0, 0.0);
+    } else {
+        FragColor = color;
+    }
+}
+
 void main() {
     vec2 coord = (atlasCoord + texCoord) / atlasSize;
 
@@ -72,7 +122,7 @@ void main() {
 
     vec4 textureColor = texture(atlas, coord);
     vec4 baseColor = vec4(textureColor.rgb * lightIntensity, textureColor.a);
-    FragColor = mix(baseColor,
+    writeColor(mix(baseColor,
         vec4(1.0, 1.0, 1.0, 1.0),
-        clamp(dist / fogDistance, 0.0, 1.0));
+        clamp(dist / fogDistance, 0.0, 1.0)));
 }
\ No newline at end of file
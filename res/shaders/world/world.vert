@@ -18,9 +18,12 @@ out vec3 normal;
 out vec3 fragPos;
 out float aoFactor;
 
-uniform mat4 view;
-uniform mat4 proj;
-uniform float time;
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 proj;
+    vec3 cameraPos;
+    float time;
+};
 
 vec3 transformFace(vec3 pos, int face) {
     vec3 side = pos;
@@ -2,17 +2,29 @@
 #include "render/core/render.h"
 #include "player/input/input.h"
 #include "mesh/core/mesh.h"
+#include "mesh/generation/mesh_pipeline.h"
 #include "world/core/block.h"
 #include "server/server.h"
 #include "server/threads/client_recv.h"
 #include "util/metrics.h"
 #include "util/core.h"
+#include "util/thread_event.h"
+#include "util/sort_benchmark.h"
+#include "mesh/core/mesh_benchmark.h"
+#include "mesh/core/pool_benchmark.h"
+
+// How long the main thread sleeps in the event queue while the first
+// world mesh is built
+#define MAIN_IDLE_WAIT_SECONDS 0.05
+
+static thread_usage main_usage = THREAD_USAGE_INITIALIZER("main");
 
 int main(int argc, char** argv) {
     
     char env[16] = {0};
     bool server_mode = false;
     bool profile_client = false;
+    bool benchmark_mesh = false;
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--server") == 0) {
             server_mode = true;
@@ -20,6 +32,17 @@ int main(int argc, char** argv) {
         if (strcmp(argv[i], "--profile-client") == 0) {
             profile_client = true;
         }
+        if (strcmp(argv[i], "--benchmark-sort") == 0) {
+            run_sort_benchmark();
+            return 0;
+        }
+        if (strcmp(argv[i], "--benchmark-pool") == 0) {
+            run_pool_benchmark();
+            return 0;
+        }
+        if (strcmp(argv[i], "--benchmark-mesh") == 0) {
+            benchmark_mesh = true;
+        }
         if (strcmp(argv[i], "--localhost") == 0) {
             start_local_server();
         }
@@ -38,6 +61,10 @@ int main(int argc, char** argv) {
 
     init_core();
     profile_startup_checkpoint("init_core");
+    if (benchmark_mesh) {
+        run_mesh_benchmark();
+        return 0;
+    }
     if (server_mode) {
         server_main();
         return 0;
@@ -57,7 +84,7 @@ int main(int argc, char** argv) {
         .show_fps = false,
         .num_packets = NULL,
         .packet = NULL,
-        .world_mesh = create_double_buffer(),
+        .world_mesh = create_world_mesh_buffer(),
         .mesh_requires_update = true,
     };
 
@@ -66,19 +93,31 @@ int main(int argc, char** argv) {
     renderer r = create_renderer(&data);
     profile_startup_checkpoint("create_renderer");
     
-    start_chunk_mesh_updater(&data);
-    profile_startup_checkpoint("chunk_mesh_updater");
-    start_world_mesh_updater(&data);
-    profile_startup_checkpoint("world_mesh_updater");
+    start_mesh_pipeline(&data);
+    profile_startup_checkpoint("mesh_pipeline");
     
     init_input(window, &data);
     profile_startup_checkpoint("init_input");
     init_metrics();
 
+    // Every other thread is running now, so none inherits the single CPU
+    if (PIN_WORKER_THREADS && pool_pin_reserved_cpu(get_mesh_worker_pool()) != 0) {
+        fprintf(stderr, "Could not pin the render thread, leaving it unpinned\n");
+    }
+
+    thread_usage_register(&main_usage);
+    thread_usage_begin(&main_usage);
     while (!glfwWindowShouldClose(window)) {
 
-        if (data.world_mesh == NULL || data.num_packets == NULL || *data.num_packets == 0)
+        // The newest world mesh, ours until the next acquire
+        world_mesh* render_mesh = data.world_mesh != NULL ? acquire_world_mesh(data.world_mesh) : NULL;
+        if (render_mesh == NULL || data.num_packets == NULL || *data.num_packets == 0) {
+            // Keep the window responsive without spinning a core
+            thread_usage_idle(&main_usage);
+            glfwWaitEventsTimeout(MAIN_IDLE_WAIT_SECONDS);
+            thread_usage_wake(&main_usage);
             continue;
+        }
 
         profile_frame_begin();
 
@@ -104,15 +143,11 @@ int main(int argc, char** argv) {
         update_selected_block(&data.player);
         profile_end_section(PROFILE_SECTION_UPDATE_SELECTED_BLOCK);
 
-        profile_begin_section(PROFILE_SECTION_COPY_WORLD_MESH);
-        world_mesh* render_mesh = copy_world_mesh(data.world_mesh);
         int render_packet_count = *(data.num_packets);
-        profile_end_section(PROFILE_SECTION_COPY_WORLD_MESH);
 
         profile_begin_section(PROFILE_SECTION_RENDER_TOTAL);
         render(&data, &r, render_mesh, render_packet_count);
         profile_end_section(PROFILE_SECTION_RENDER_TOTAL);
-        free_world_mesh(render_mesh);
 
         profile_begin_section(PROFILE_SECTION_SWAP_BUFFERS);
         glfwSwapBuffers(window);
@@ -124,9 +159,11 @@ int main(int argc, char** argv) {
 
         profile_frame_end();
     }
+    thread_usage_end(&main_usage);
 
-    kill_chunk_mesh_updater();
-    kill_world_mesh_updater();
+    // Closing the window does not go through the escape key handler
+    data.is_running = false;
+    kill_mesh_pipeline();
 
     destroy_renderer(&r);
     destroy_game_data(data);
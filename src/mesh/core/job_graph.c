@@ -0,0 +1,158 @@
+#include "job_graph.h"
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+typedef struct {
+    const char* name;
+    job_fn run;
+    void* ctx;
+    job_graph* graph;
+    
+    int* dependents;
+    int num_dependents;
+    int num_dependencies;
+    atomic_int waiting;  // dependencies still running this run
+} graph_job;
+
+struct job_graph {
+    worker_pool* pool;
+    graph_job* jobs;
+    int num_jobs;
+    int capacity;
+    
+    int unfinished;  // jobs not finished this run, guarded by done_mutex
+    pthread_mutex_t done_mutex;
+    pthread_cond_t done_signal;
+};
+
+job_graph* graph_create(worker_pool* pool) {
+    if (pool == NULL) {
+        return NULL;
+    }
+    
+    job_graph* graph = (job_graph*)malloc(sizeof(job_graph));
+    if (graph == NULL) {
+        return NULL;
+    }
+    
+    graph->pool = pool;
+    graph->jobs = NULL;
+    graph->num_jobs = 0;
+    graph->capacity = 0;
+    graph->unfinished = 0;
+    pthread_mutex_init(&graph->done_mutex, NULL);
+    pthread_cond_init(&graph->done_signal, NULL);
+    return graph;
+}
+
+int graph_add(job_graph* graph, const char* name, job_fn run, void* ctx) {
+    if (graph == NULL || run == NULL) {
+        return -1;
+    }
+    
+    if (graph->num_jobs == graph->capacity) {
+        int capacity = graph->capacity > 0 ? graph->capacity * 2 : 8;
+        graph_job* jobs = realloc(graph->jobs, capacity * sizeof(graph_job));
+        if (jobs == NULL) {
+            return -1;
+        }
+        graph->jobs = jobs;
+        graph->capacity = capacity;
+    }
+    
+    graph_job* job = &graph->jobs[graph->num_jobs];
+    job->name = name;
+    job->run = run;
+    job->ctx = ctx;
+    job->graph = graph;
+    job->dependents = NULL;
+    job->num_dependents = 0;
+    job->num_dependencies = 0;
+    atomic_init(&job->waiting, 0);
+    return graph->num_jobs++;
+}
+
+void graph_depends(job_graph* graph, int job, int dependency) {
+    if (graph == NULL) {
+        return;
+    }
+    // Dependencies always point backwards so the graph cannot have cycles
+    assert(dependency >= 0 && dependency < job && job < graph->num_jobs && "Invalid job dependency");
+    
+    graph_job* before = &graph->jobs[dependency];
+    int* dependents = realloc(before->dependents, (before->num_dependents + 1) * sizeof(int));
+    assert(dependents != NULL && "Failed to grow job dependents");
+    dependents[before->num_dependents++] = job;
+    before->dependents = dependents;
+    
+    graph->jobs[job].num_dependencies++;
+}
+
+static void* run_graph_job(void* ctx);
+
+static void submit_graph_job(graph_job* job) {
+    // Stages are short and something is waiting on them, run them ahead of
+    // queued background work
+    pool_run(job->graph->pool, &(pool_task){.run = run_graph_job, .ctx = job, .urgent = 1});
+}
+
+static void* run_graph_job(void* ctx) {
+    graph_job* job = (graph_job*)ctx;
+    job_graph* graph = job->graph;
+    
+    job->run(job->ctx);
+    
+    for (int i = 0; i < job->num_dependents; i++) {
+        graph_job* next = &graph->jobs[job->dependents[i]];
+        if (atomic_fetch_sub(&next->waiting, 1) == 1) {
+            submit_graph_job(next);
+        }
+    }
+    
+    // Count down under the lock so graph_run cannot return, and the graph be
+    // freed, while this job still touches it
+    pthread_mutex_lock(&graph->done_mutex);
+    if (--graph->unfinished == 0) {
+        pthread_cond_signal(&graph->done_signal);
+    }
+    pthread_mutex_unlock(&graph->done_mutex);
+    return NULL;
+}
+
+void graph_run(job_graph* graph) {
+    if (graph == NULL || graph->num_jobs == 0) {
+        return;
+    }
+    
+    graph->unfinished = graph->num_jobs;
+    for (int i = 0; i < graph->num_jobs; i++) {
+        atomic_store(&graph->jobs[i].waiting, graph->jobs[i].num_dependencies);
+    }
+    
+    for (int i = 0; i < graph->num_jobs; i++) {
+        if (graph->jobs[i].num_dependencies == 0) {
+            submit_graph_job(&graph->jobs[i]);
+        }
+    }
+    
+    pthread_mutex_lock(&graph->done_mutex);
+    while (graph->unfinished > 0) {
+        pthread_cond_wait(&graph->done_signal, &graph->done_mutex);
+    }
+    pthread_mutex_unlock(&graph->done_mutex);
+}
+
+void graph_free(job_graph* graph) {
+    if (graph == NULL) {
+        return;
+    }
+    
+    for (int i = 0; i < graph->num_jobs; i++) {
+        free(graph->jobs[i].dependents);
+    }
+    free(graph->jobs);
+    pthread_mutex_destroy(&graph->done_mutex);
+    pthread_cond_destroy(&graph->done_signal);
+    free(graph);
+}
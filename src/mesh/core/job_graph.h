@@ -0,0 +1,50 @@
+#ifndef JOB_GRAPH_H
+#define JOB_GRAPH_H
+
+#include "worker_pool.h"
+
+typedef struct job_graph job_graph;
+
+// Runs one job of the graph
+typedef void (*job_fn)(void* ctx);
+
+/**
+ * Create an empty graph whose jobs run on a worker pool
+ * @param pool Pool the jobs are submitted to
+ * @return Pointer to the graph, or NULL on failure
+ */
+job_graph* graph_create(worker_pool* pool);
+
+/**
+ * Add a job to the graph
+ * @param graph Graph to add to, must not be running
+ * @param name Label for debugging, not copied
+ * @param run Function to run
+ * @param ctx Passed to run
+ * @return Id of the job, -1 on failure
+ */
+int graph_add(job_graph* graph, const char* name, job_fn run, void* ctx);
+
+/**
+ * Make a job wait until another one finished
+ * @param graph Graph both jobs belong to, must not be running
+ * @param job Id of the job that waits
+ * @param dependency Id of the job it waits on, added before it
+ */
+void graph_depends(job_graph* graph, int job, int dependency);
+
+/**
+ * Run every job once, each as soon as its dependencies finished, and block
+ * until all of them did. Jobs without a path between them run in parallel.
+ * Must not be called from one of the pool's workers.
+ * @param graph Graph to run
+ */
+void graph_run(job_graph* graph);
+
+/**
+ * Free a graph that is not running
+ * @param graph Graph to free
+ */
+void graph_free(job_graph* graph);
+
+#endif
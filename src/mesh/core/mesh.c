@@ -3,18 +3,27 @@
 #include <assert.h>
 #include <math.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "../../player/core/camera.h"
-#include "../../util/queue.h"
+#include "../../util/metrics.h"
+#include "../../util/dedupe_queue.h"
 #include "../../util/settings.h"
+#include "../../util/thread_event.h"
 #include "../../world/core/block.h"
+#include "../../world/core/chunk_lod.h"
 #include "../../world/core/world.h"
 #include "../effects/ambient_occlusion.h"
 #include "../generation/chunk_mesh.h"
+#include "../generation/mesh_pipeline.h"
 #include "../geometry/blockbench_loader.h"
+#include "mesh_buffer.h"
+#include "mesh_cache.h"
+#include "section_visibility.h"
 #include "worker_pool.h"
 
 // Hashmap keyed by (chunk_coordinate + LOD level) for efficient multi-LOD
@@ -32,62 +41,208 @@ pthread_cond_t packet_update_signal = PTHREAD_COND_INITIALIZER;
 // Worker pool for chunk mesh generation
 worker_pool *chunk_worker_pool = NULL;
 
-// Last-known player position, updated each frame via load_chunk
-static float g_player_x = 0.0f;
-static float g_player_z = 0.0f;
+// Sections thinner than this are not worth a job of their own
+#define MESH_MIN_SECTION_HEIGHT 16
+
+// Priority multiplier for queued chunks inside the view cone
+#define MESH_VIEW_PRIORITY_SCALE 0.25f
+// Queued work is reordered after the view turns by more than ~15 degrees
+#define MESH_REPRIORITIZE_COS 0.966f
+
+// Last-known player position, updated each frame via load_chunk. Both
+// coordinates share one word so workers always read a matching pair.
+static _Atomic uint64_t g_player_pos = 0;
+
+// Camera queued mesh work is ordered by, and the view it was last ordered for
+static camera *mesh_camera = NULL;
+static int priority_chunk_x = 0;
+static int priority_chunk_z = 0;
+static float priority_front_x = 0.0f;
+static float priority_front_z = 0.0f;
+
+// Queued chunk jobs dropped before they started, by reason
+static atomic_ulong stale_out_of_range = 0;
+static atomic_ulong stale_already_meshed = 0;
 
 void get_mesh_player_pos(float *out_x, float *out_z) {
-  *out_x = g_player_x;
-  *out_z = g_player_z;
+  uint64_t pos = atomic_load_explicit(&g_player_pos, memory_order_relaxed);
+  uint32_t x_bits = (uint32_t)(pos >> 32);
+  uint32_t z_bits = (uint32_t)pos;
+  memcpy(out_x, &x_bits, sizeof(float));
+  memcpy(out_z, &z_bits, sizeof(float));
+}
+
+static void set_mesh_player_pos(float x, float z) {
+  uint32_t x_bits, z_bits;
+  memcpy(&x_bits, &x, sizeof(float));
+  memcpy(&z_bits, &z, sizeof(float));
+  atomic_store_explicit(&g_player_pos, ((uint64_t)x_bits << 32) | z_bits,
+                        memory_order_relaxed);
+}
+
+worker_pool *get_mesh_worker_pool(void) { return chunk_worker_pool; }
+
+int adjust_mesh_worker_threads(int delta) {
+  int current = pool_thread_count(chunk_worker_pool);
+  int target = current + delta;
+  if (target < 1 || target > POOL_MAX_THREADS) {
+    return current;
+  }
+  return pool_resize(chunk_worker_pool, target);
+}
+
+// Guards the structure of chunk_packets. Entries are only replaced or
+// removed while the mesh lock is held as well, so code holding the mesh lock
+// can keep using the meshes it looked up. Code that cannot take the mesh lock
+// looks entries up under this one alone.
+static pthread_mutex_t chunk_packets_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Chunk meshes waiting for a sort, and coordinates of chunks nobody meshed
+// yet. Both keep one entry per chunk and lock internally.
+dedupe_queue sort_queue;
+dedupe_queue chunk_load_queue;
+
+// Squared distance from the player in chunks. Chunks in front of the camera
+// count as closer so the view fills in before what is behind the player.
+static float chunk_work_priority(void *item) {
+  chunk_work_item *work = (chunk_work_item *)item;
+  float player_x, player_z;
+  get_mesh_player_pos(&player_x, &player_z);
+  float dx = (float)work->x + 0.5f - F_WORLD_POS_TO_CHUNK_POS(player_x);
+  float dz = (float)work->z + 0.5f - F_WORLD_POS_TO_CHUNK_POS(player_z);
+  float dist_sq = dx * dx + dz * dz;
+
+  if (mesh_camera == NULL || dist_sq <= 1.0f) {
+    return dist_sq;
+  }
+
+  float fx = mesh_camera->front[0];
+  float fz = mesh_camera->front[2];
+  float front_len = sqrtf(fx * fx + fz * fz);
+  if (front_len <= 0.0f) {
+    return dist_sq;
+  }
+
+  float facing = (dx * fx + dz * fz) / (front_len * sqrtf(dist_sq));
+  if (facing >= cosf(FOV * (float)M_PI / 180.0f)) {
+    dist_sq *= MESH_VIEW_PRIORITY_SCALE;
+  }
+  return dist_sq;
+}
+
+// Revalidate a queued chunk job against the current view. Drops chunks that
+// left render distance or already have a mesh at their current LOD. Called
+// under the pool's queue lock, so it only takes the chunk_packets lock.
+static int chunk_work_valid(void *item) {
+  chunk_work_item *work = (chunk_work_item *)item;
+
+  float player_x, player_z;
+  get_mesh_player_pos(&player_x, &player_z);
+  int dx = work->x - WORLD_POS_TO_CHUNK_POS(player_x);
+  int dz = work->z - WORLD_POS_TO_CHUNK_POS(player_z);
+  if (dx * dx + dz * dz > CHUNK_RENDER_DISTANCE * CHUNK_RENDER_DISTANCE) {
+    atomic_fetch_add_explicit(&stale_out_of_range, 1, memory_order_relaxed);
+    return 0;
+  }
+
+  chunk_mesh_key key = {work->x, work->z,
+                        calculate_lod(work->x, work->z, player_x, player_z)};
+  pthread_mutex_lock(&chunk_packets_mutex);
+  chunk_mesh *mesh = chunk_mesh_lod_map_get(&chunk_packets, key);
+  int meshed = mesh != NULL && !chunk_mesh_seams_stale(mesh, player_x, player_z);
+  pthread_mutex_unlock(&chunk_packets_mutex);
+  if (meshed) {
+    atomic_fetch_add_explicit(&stale_already_meshed, 1, memory_order_relaxed);
+    return 0;
+  }
+  return 1;
 }
 
-// Mutexes for shared structures
-pthread_mutex_t chunk_packets_mutex;
-pthread_mutex_t sort_queue_mutex;
-pthread_mutex_t chunk_load_queue_mutex;
+// Reorder queued work once the player changes chunk or turns far enough
+static void update_work_priorities(float player_x, float player_z) {
+  if (mesh_camera == NULL) {
+    return;
+  }
 
-queue_node *sort_queue = NULL;
-queue_node *chunk_load_queue = NULL;
+  int chunk_x = WORLD_POS_TO_CHUNK_POS(player_x);
+  int chunk_z = WORLD_POS_TO_CHUNK_POS(player_z);
+  float fx = mesh_camera->front[0];
+  float fz = mesh_camera->front[2];
+  float front_len = sqrtf(fx * fx + fz * fz);
+  if (front_len > 0.0f) {
+    fx /= front_len;
+    fz /= front_len;
+  }
+
+  int moved = chunk_x != priority_chunk_x || chunk_z != priority_chunk_z;
+  int turned =
+      fx * priority_front_x + fz * priority_front_z < MESH_REPRIORITIZE_COS;
+  if (!moved && !turned) {
+    return;
+  }
+
+  priority_chunk_x = chunk_x;
+  priority_chunk_z = chunk_z;
+  priority_front_x = fx;
+  priority_front_z = fz;
+  pool_reprioritize(chunk_worker_pool);
+}
 
 void m_init(camera *camera) {
   chunk_packets = chunk_mesh_lod_map_init(CHUNK_CACHE_SIZE);
   chunk_packets_buffer =
       chunk_mesh_lod_map_init(CHUNK_CACHE_SIZE); // Initialize staging buffer
-  queue_init(&sort_queue);
-  queue_init(&chunk_load_queue);
+  dedupe_queue_init(&sort_queue, sizeof(chunk_mesh *), chunk_mesh_queue_key, 1);
+  dedupe_queue_init(&chunk_load_queue, sizeof(chunk_coord),
+                    chunk_coord_queue_key, 1);
   init_chunk_mesh(camera);
 
-  pthread_mutex_init(&chunk_packets_mutex, NULL);
-  pthread_mutex_init(&sort_queue_mutex, NULL);
-  pthread_mutex_init(&chunk_load_queue_mutex, NULL);
+  init_mesh_cache();
 
   // Initialize worker pool for chunk mesh generation
-  chunk_worker_pool =
-      pool_init(WORKER_THREADS, (work_processor_fn)process_chunk_work_item);
+  int worker_threads =
+      WORKER_THREADS > 0 ? WORKER_THREADS : pool_auto_thread_count();
+  chunk_worker_pool = pool_init(worker_threads);
   if (chunk_worker_pool == NULL) {
     fprintf(stderr, "Failed to initialize worker pool with %d threads\n",
-            WORKER_THREADS);
+            worker_threads);
     exit(EXIT_FAILURE);
   }
+  if (PIN_WORKER_THREADS && pool_pin_workers(chunk_worker_pool) != 0) {
+    fprintf(stderr, "Could not pin worker threads, leaving them unpinned\n");
+  }
+
+  mesh_camera = camera;
+}
+
+static void print_chunk_job_stats(void) {
+  pool_stats stats;
+  pool_get_stats(chunk_worker_pool, &stats);
+  printf("[profile] chunk jobs: %lu queued, %lu merged, %lu run, %lu "
+         "cancelled (%lu out of range, %lu already meshed)\n",
+         stats.submitted, stats.merged, stats.completed, stats.cancelled,
+         atomic_load(&stale_out_of_range), atomic_load(&stale_already_meshed));
 }
 
 void mesh_cleanup() {
   // Shutdown worker pool
   if (chunk_worker_pool != NULL) {
+    if (client_profiling_enabled()) {
+      print_chunk_job_stats();
+      print_thread_usage();
+    }
     pool_shutdown(chunk_worker_pool);
     chunk_worker_pool = NULL;
   }
 
   chunk_mesh_lod_map_free(&chunk_packets);
   chunk_mesh_lod_map_free(&chunk_packets_buffer);
-  queue_cleanup(&sort_queue);
-  queue_cleanup(&chunk_load_queue);
+  dedupe_queue_free(&sort_queue);
+  dedupe_queue_free(&chunk_load_queue);
 
   blockbench_cleanup();
 
   pthread_mutex_destroy(&chunk_packets_mutex);
-  pthread_mutex_destroy(&sort_queue_mutex);
-  pthread_mutex_destroy(&chunk_load_queue_mutex);
   pthread_mutex_destroy(&packet_swap_mutex);
   pthread_cond_destroy(&packet_update_signal);
 }
@@ -120,7 +275,9 @@ void preload_initial_chunks(game_data *data) {
 
   for (int i = 0; i < max_iter; i++) {
     if (sqrt(pow(sx - player_chunk_x, 2) + pow(sz - player_chunk_z, 2)) <= CHUNK_RENDER_DISTANCE) {
+      lock_mesh();
       chunk_mesh *existing = get_chunk_mesh(sx, sz);
+      unlock_mesh();
       if (existing == NULL) {
         chunks_queued++;
       }
@@ -138,52 +295,82 @@ void preload_initial_chunks(game_data *data) {
   }
 
   // Submit all queued chunks to workers - they will be processed in the
-  // background
+  // background, nearest first
   if (chunks_queued > 0) {
-    for (int i = 0; i < chunks_queued; i++) {
-      load_chunk(player_x, player_z);
+    load_chunk(player_x, player_z);
+  }
+}
+
+// Block types indexed by id, so packing never searches TYPES or compares
+// block names per face
+#define MESH_MAX_BLOCK_IDS 1024
+static block_type mesh_block_types[MESH_MAX_BLOCK_IDS];
+static const block_type mesh_invalid_block_type = {.id = -1};
+static short mesh_air_id = -1;
+static short mesh_water_id = -1;
+static pthread_once_t mesh_block_types_once = PTHREAD_ONCE_INIT;
+
+static void build_mesh_block_types(void) {
+  for (int id = 0; id < MESH_MAX_BLOCK_IDS; id++) {
+    mesh_block_types[id] = mesh_invalid_block_type;
+  }
+  // first match wins, same as get_block_type
+  for (int i = BLOCK_COUNT - 1; i >= 0; i--) {
+    if (TYPES[i].id < MESH_MAX_BLOCK_IDS) {
+      mesh_block_types[TYPES[i].id] = TYPES[i];
     }
   }
+  mesh_air_id = get_block_id("air");
+  mesh_water_id = get_block_id("water");
+}
+
+static void init_mesh_block_types(void) {
+  pthread_once(&mesh_block_types_once, build_mesh_block_types);
+}
+
+static inline const block_type *lookup_block_type(short id) {
+  if (id < 0 || id >= MESH_MAX_BLOCK_IDS) {
+    return &mesh_invalid_block_type;
+  }
+  return &mesh_block_types[id];
 }
 
+// Decide face visibility from the block and its neighbour on that side. Shared
+// by the full resolution packer and the LOD pyramid packer.
 // TODO: this function is messy, clean it up
-void get_side_visible(int x, int y, int z, short side, short lod_scale,
-                      chunk *c, chunk *adj, int *visible_out,
-                      int *underwater_out, int *water_level_out) {
-  // calculate adjacent block
-  short adjacent_id = get_adjacent_block(x, y, z, side, lod_scale, c, adj);
+static void resolve_side_visible(block_data_t current_data,
+                                 block_data_t adjacent_data, int y, short side,
+                                 int *visible_out, int *underwater_out,
+                                 int *water_level_out) {
+  short adjacent_id = 0;
+  get_block_info(adjacent_data, &adjacent_id, NULL, NULL, NULL);
 
   short current_id = 0;
-
-  short current_water_level = 0;
-  get_block_info(c->blocks[x][y][z], &current_id, NULL, NULL,
-                 &current_water_level);
-  block_type current = get_block_type(current_id);
-  if (current.id == -1) {
+  get_block_info(current_data, &current_id, NULL, NULL, NULL);
+  const block_type *current = lookup_block_type(current_id);
+  if (current->id == -1) {
     *visible_out = 0;
     return; // Invalid block, don't render
   }
 
   // calculate visibility
-  block_type adjacent = get_block_type(adjacent_id);
-  if (adjacent.id == -1) {
+  const block_type *adjacent = lookup_block_type(adjacent_id);
+  if (adjacent->id == -1) {
     *visible_out = 0;
     return; // Invalid adjacent block, don't render
   }
-  uint visible = adjacent_id == get_block_id("air") ||
-                 adjacent.transparent != current.transparent;
+  uint visible = adjacent_id == mesh_air_id ||
+                 adjacent->transparent != current->transparent;
 
   // check if we are underwater
-  if (adjacent_id == get_block_id("water")) {
+  if (adjacent_id == mesh_water_id) {
     *underwater_out = 1;
   }
 
   // get water level from adjacent block
   short adj_water_level = 0;
-  if (adjacent_id == get_block_id("water")) {
-    block_data_t adj_block_data =
-        get_adjacent_block_data(x, y, z, side, lod_scale, c, adj);
-    get_block_info(adj_block_data, NULL, NULL, NULL, &adj_water_level);
+  if (adjacent_id == mesh_water_id) {
+    get_block_info(adjacent_data, NULL, NULL, NULL, &adj_water_level);
     *water_level_out = (int)adj_water_level;
   } else {
     *water_level_out = 0;
@@ -191,32 +378,32 @@ void get_side_visible(int x, int y, int z, short side, short lod_scale,
 
   // For liquid blocks: show face at any boundary where we can see the water
   // volume This includes: water-to-air, water-to-solid, but NOT water-to-water
-  if (current.liquid) {
+  if (current->liquid) {
     // Hide face if adjacent is also liquid (same type)
-    if (adjacent.id != -1 && adjacent.liquid) {
+    if (adjacent->id != -1 && adjacent->liquid) {
       visible = 0;
     }
     // Show face if adjacent is not water (air, solid blocks, etc.)
-    else if (adjacent_id != get_block_id("water")) {
+    else if (adjacent_id != mesh_water_id) {
       visible = 1;
     }
   }
 
   // make sure transparent neighbors are visible
-  if (adjacent.id == -1 && adjacent.transparent != current.transparent) {
+  if (adjacent->id == -1 && adjacent->transparent != current->transparent) {
     visible = 1;
   }
 
-  if (adjacent.is_custom_model) {
+  if (adjacent->is_custom_model) {
     visible = 1;
   }
 
-  if (adjacent.id != -1 && (adjacent.transparent && current.transparent) &&
-      adjacent.id != current.id) {
+  if (adjacent->id != -1 && (adjacent->transparent && current->transparent) &&
+      adjacent->id != current->id) {
     visible = 1;
   }
 
-  if (current.is_foliage) {
+  if (current->is_foliage) {
     visible = 1; // foliage is always visible
   }
 
@@ -328,38 +515,26 @@ short get_converted_side(int side, short orientation) {
   return new_side;
 }
 
-void get_model_transformation(mat4 transform, block_type *block,
-                              short orientation, short rot) {
-  // get orientation and rotation info
-  glm_mat4_identity(transform);
-  glm_translate(
-      transform,
-      (vec3){0.5f, 0.5f, 0.5f}); // translate to center of block for rotation
-  if (block->oriented) {
-    switch (orientation) {
-    case (short)UP:
-      glm_rotate(transform, (float)(M_PI), (vec3){1.0f, 0.0f, 0.0f});
-      break;
-    case (short)NORTH:
-      // glm_rotate(transform, (float)(-M_PI / 2.0), (vec3){1.0f, 0.0f, 0.0f});
-      break;
-    case (short)SOUTH:
-      glm_rotate(transform, (float)(M_PI), (vec3){0.0f, 1.0f, 0.0f});
-      break;
-    case (short)EAST:
-      glm_rotate(transform, (float)(M_PI / 2.0), (vec3){0.0f, 1.0f, 0.0f});
-      break;
-    case (short)WEST:
-      glm_rotate(transform, (float)(-M_PI / 2.0), (vec3){0.0f, 1.0f, 0.0f});
-      break;
-    default:
-      break;
-    }
-  } else {
-    glm_rotate(transform, (float)(rot * (M_PI / 2.0)),
-               (vec3){0.0f, 1.0f, 0.0f});
+// Index into the model rotation table (see MODEL_ROTATION_COUNT) for a
+// placed model. Quarter turns are counter-clockwise about Y.
+static short get_model_rotation(const block_type *block, short orientation, short rot) {
+  if (!block->oriented) {
+    return rot & 0x3;
+  }
+
+  switch (orientation) {
+  case (short)UP:
+    return 4;
+  case (short)SOUTH:
+    return 2;
+  case (short)EAST:
+    return 1;
+  case (short)WEST:
+    return 3;
+  case (short)NORTH:
+  default:
+    return 0;
   }
-  glm_translate(transform, (vec3){-0.5f, -0.5f, -0.5f}); // translate back
 }
 
 void pack_side(int x_0, int y_0, int z_0, short side, short orientation,
@@ -375,35 +550,35 @@ void pack_side(int x_0, int y_0, int z_0, short side, short orientation,
   data->ao = ao;
 
   // block specific data
-  block_type block = get_block_type(type);
-  if (block.id == -1) {
+  const block_type *block = lookup_block_type(type);
+  if (block->id == -1) {
     return; // Invalid block type, skip packing
   }
-  data->orientation = block.oriented ? orientation : (short)DOWN;
+  data->orientation = block->oriented ? orientation : (short)DOWN;
 
   short display_side = get_rotated_side(side, rot);
-  if (!block.is_custom_model && !block.is_foliage && block.oriented) {
+  if (!block->is_custom_model && !block->is_foliage && block->oriented) {
     display_side = get_converted_side(side, orientation);
   }
   // Foliage only uses sides 0 and 1, clamp to valid range
-  if (block.is_foliage && display_side > 1) {
+  if (block->is_foliage && display_side > 1) {
     display_side = side % 2;
   }
-  data->atlas_x = block.face_atlas_coords[display_side][0];
-  data->atlas_y = block.face_atlas_coords[display_side][1];
+  data->atlas_x = block->face_atlas_coords[display_side][0];
+  data->atlas_y = block->face_atlas_coords[display_side][1];
 }
 
 // Generate water flow transition faces between blocks with different water
 // levels
 void pack_water_transitions(int x, int y, int z, short lod_scale, chunk *c,
                             chunk *adj_chunks[4], short current_water_level,
-                            side_instance **chunk_side_data, int *num_sides) {
+                            side_buffer *out) {
 
   int world_x = CHUNK_POS_TO_WORLD_POS(c->x, x);
   int world_y = y;
   int world_z = CHUNK_POS_TO_WORLD_POS(c->z, z);
 
-  short water_id = get_block_id("water");
+  short water_id = mesh_water_id;
 
   // Check 4 cardinal directions (0=NORTH, 1=WEST, 2=SOUTH, 3=EAST)
   for (int side = 0; side < 4; side++) {
@@ -448,18 +623,9 @@ void pack_water_transitions(int x, int y, int z, short lod_scale, chunk *c,
       continue;
     }
 
-    // Allocate space for transition face
-    int new_side_count = (*num_sides) + 1;
-    if (new_side_count > SIDES_PER_CHUNK) {
-      side_instance *tmp =
-          realloc(*chunk_side_data, new_side_count * sizeof(side_instance));
-      assert(tmp != NULL &&
-             "Failed to allocate memory for transition side data");
-      *chunk_side_data = tmp;
-    }
-
     // Create transition face
-    side_instance *trans = &((*chunk_side_data)[*num_sides]);
+    side_buffer_reserve(out, out->count + 1);
+    side_instance *trans = &out->sides[out->count];
     trans->x = world_x;
     trans->y = world_y;
     trans->z = world_z;
@@ -468,24 +634,144 @@ void pack_water_transitions(int x, int y, int z, short lod_scale, chunk *c,
     trans->water_level_transition = from_level; // Lower level (source)
     trans->underwater = 0;
     trans->orientation = (short)DOWN;
-    trans->ao = 0xFF; // No AO for water transitions (all vertices = 3)
+    trans->ao = AO_NONE; // No AO for water transitions (all vertices = 3)
 
     // Use water texture for transition
-    block_type water_block = get_block_type(water_id);
-    if (water_block.id != -1) {
+    const block_type *water_block = lookup_block_type(water_id);
+    if (water_block->id != -1) {
       continue; // Invalid water block type
     }
     short display_side = side; // Use the cardinal direction directly
-    trans->atlas_x = water_block.face_atlas_coords[display_side][0];
-    trans->atlas_y = water_block.face_atlas_coords[display_side][1];
+    trans->atlas_x = water_block->face_atlas_coords[display_side][0];
+    trans->atlas_y = water_block->face_atlas_coords[display_side][1];
 
-    (*num_sides)++;
+    out->count++;
   }
 }
 
-void pack_block(int x, int y, int z, short lod_scale, chunk *c,
-                chunk *adj_chunks[4], // front, back, left, right
-                side_instance **chunk_side_data, int *num_sides) {
+// How each horizontal neighbour is meshed, so faces on the chunk border are
+// culled against what the neighbour actually draws rather than its blocks
+typedef struct {
+  short lod_scale[4];
+  chunk_lod *lod[4];     // neighbour pyramid when its LOD has a level
+  chunk_lod *adj_lod[4]; // neighbour pyramids held for the whole build
+} mesh_seams;
+
+// Takes a reference on every neighbour pyramid the build samples, so a
+// rebuild on another thread never changes them underneath the mesher
+static void init_mesh_seams(mesh_seams *seams, chunk *adj_chunks[4],
+                            const short adj_lod_scales[4], short lod_scale) {
+  for (int side = 0; side < 4; side++) {
+    int has_level = chunk_lod_has_level(adj_lod_scales[side]);
+    int needed = has_level || chunk_lod_has_level(lod_scale);
+    seams->lod_scale[side] = adj_lod_scales[side];
+    seams->adj_lod[side] = adj_chunks[side] != NULL && needed
+                               ? get_chunk_lod(adj_chunks[side])
+                               : NULL;
+    seams->lod[side] = has_level ? seams->adj_lod[side] : NULL;
+  }
+}
+
+static void release_mesh_seams(mesh_seams *seams) {
+  for (int side = 0; side < 4; side++) {
+    release_chunk_lod(seams->adj_lod[side]);
+  }
+}
+
+// Neighbour block at x, y, z as seen by a mesh at lod_scale. The full
+// resolution packer samples the origin block of each cell.
+static block_data_t sample_neighbour(chunk *adj, chunk_lod *l,
+                                     short lod_scale, int x, int y, int z) {
+  if (l != NULL) {
+    return chunk_lod_sample(l, lod_scale, x / lod_scale, y / lod_scale,
+                            z / lod_scale);
+  }
+  return adj->blocks[x - x % lod_scale][y - y % lod_scale][z - z % lod_scale];
+}
+
+static int is_border_side(int x, int z, short side, short lod_scale) {
+  switch (side) {
+  case (int)WEST:
+    return x + lod_scale >= CHUNK_SIZE;
+  case (int)EAST:
+    return x - lod_scale < 0;
+  case (int)NORTH:
+    return z - lod_scale < 0;
+  case (int)SOUTH:
+    return z + lod_scale >= CHUNK_SIZE;
+  default:
+    return 0;
+  }
+}
+
+// Neighbour of a border face when the chunk across the border is meshed at
+// another LOD. The face spans lod_scale blocks and can overlap several
+// neighbour cells, so anything see-through behind any part of it wins and
+// the face is only culled where the neighbour's mesh closes the gap.
+static block_data_t get_seam_block_data(int x, int y, int z, short side,
+                                        short lod_scale, chunk *adj,
+                                        const mesh_seams *seams) {
+  short adj_lod = seams->lod_scale[side];
+  chunk_lod *l = seams->lod[side];
+  short air_id = mesh_air_id;
+
+  // the neighbour column touching the border runs along z for WEST and EAST
+  int along_z = side == (int)WEST || side == (int)EAST;
+  int edge = 0;
+  if (side == (int)EAST || side == (int)NORTH) {
+    edge = CHUNK_SIZE - 1;
+  }
+  int start = along_z ? z : x;
+
+  block_data_t result = sample_neighbour(adj, l, adj_lod, along_z ? edge : x,
+                                         y, along_z ? z : edge);
+  int see_through = 0;
+  for (int t = start - start % adj_lod; t < start + lod_scale; t += adj_lod) {
+    for (int v = y - y % adj_lod; v < y + lod_scale && v < CHUNK_HEIGHT;
+         v += adj_lod) {
+      block_data_t data = sample_neighbour(adj, l, adj_lod, along_z ? edge : t,
+                                           v, along_z ? t : edge);
+      short id = 0;
+      get_block_info(data, &id, NULL, NULL, NULL);
+      if (id == air_id) {
+        return data;
+      }
+
+      const block_type *type = lookup_block_type(id);
+      if (!see_through && type->id != -1 &&
+          (type->transparent || type->liquid || type->is_custom_model)) {
+        result = data;
+        see_through = 1;
+      }
+    }
+  }
+  return result;
+}
+
+// Replace the neighbours of border faces that look into a chunk at another
+// LOD. Borders between chunks at the same LOD are left alone.
+static void stitch_border_sides(block_data_t adjacent[6], int x, int y, int z,
+                                short lod_scale, chunk *adj_chunks[4],
+                                const mesh_seams *seams) {
+  if (seams == NULL) {
+    return;
+  }
+
+  for (int side = 0; side < 4; side++) {
+    if (adj_chunks[side] == NULL || seams->lod_scale[side] == lod_scale ||
+        !is_border_side(x, z, side, lod_scale)) {
+      continue;
+    }
+    adjacent[side] = get_seam_block_data(x, y, z, side, lod_scale,
+                                         adj_chunks[side], seams);
+  }
+}
+
+// Pack the visible faces of a block given its six neighbours (indexed by side).
+// x, y, z are block coordinates within the chunk.
+static void pack_block_sides(block_data_t current, block_data_t adjacent[6],
+                             int x, int y, int z, chunk *c,
+                             const ao_grid *ao_grid, side_buffer *out) {
 
   int world_x = CHUNK_POS_TO_WORLD_POS(c->x, x);
   int world_y = y;
@@ -495,124 +781,90 @@ void pack_block(int x, int y, int z, short lod_scale, chunk *c,
   short orientation = 0;
   short rot = 0;
   short current_water_level = 0;
-  get_block_info(c->blocks[x][y][z], &block_id, &orientation, &rot,
-                 &current_water_level);
+  get_block_info(current, &block_id, &orientation, &rot, &current_water_level);
 
   for (int side = 0; side < 6; side++) {
-    chunk *adj = NULL;
-    if (side < 4) {
-      adj = adj_chunks[side];
-    }
-
     int visible = 0;
     int underwater = 0;
     int adj_water_level = 0;
-    get_side_visible(x, y, z, side, lod_scale, c, adj, &visible, &underwater,
-                     &adj_water_level);
+    resolve_side_visible(current, adjacent[side], y, side, &visible,
+                         &underwater, &adj_water_level);
     if (!visible) {
       continue;
     }
 
-    int new_side_count = (*num_sides) + 1;
-
-    // check if we need to reallocate memory
-    if (new_side_count > SIDES_PER_CHUNK) {
-      side_instance *tmp =
-          realloc(*chunk_side_data, new_side_count * sizeof(side_instance));
-      assert(tmp != NULL && "Failed to allocate memory for side data");
-      *chunk_side_data = tmp;
-    }
-
     // For liquid blocks, use the current block's water level
     // For non-liquid blocks, use the adjacent water level (for underwater
     // effects)
-    block_type block = get_block_type(block_id);
-    if (block.id == -1) {
+    const block_type *block = lookup_block_type(block_id);
+    if (block->id == -1) {
       continue; // Invalid block type, skip this face
     }
     short water_level_to_use =
-        block.liquid ? current_water_level : (short)adj_water_level;
+        block->liquid ? current_water_level : (short)adj_water_level;
 
     // Calculate AO for this face
-    int ao = calculate_face_ao(x, y, z, side, c, adj_chunks);
+    int ao = calculate_face_ao(x, y, z, side, ao_grid);
 
     pack_side(world_x, world_y, world_z, side, orientation, rot, block_id,
-              water_level_to_use, underwater, ao,
-              &((*chunk_side_data)[*num_sides]));
-    (*num_sides)++;
+              water_level_to_use, underwater, ao, side_buffer_push(out));
+  }
+}
+
+void pack_block(int x, int y, int z, short lod_scale, chunk *c,
+                chunk *adj_chunks[4], // front, back, left, right
+                const mesh_seams *seams, const ao_grid *ao_grid,
+                side_buffer *out) {
+  block_data_t adjacent[6];
+  for (int side = 0; side < 6; side++) {
+    chunk *adj = side < 4 ? adj_chunks[side] : NULL;
+    adjacent[side] = get_adjacent_block_data(x, y, z, side, lod_scale, c, adj);
   }
+  stitch_border_sides(adjacent, x, y, z, lod_scale, adj_chunks, seams);
+
+  pack_block_sides(c->blocks[x][y][z], adjacent, x, y, z, c, ao_grid, out);
 }
 
-void pack_model(int x, int y, int z, chunk *c, float **custom_model_data,
-                int *num_custom_verts) {
+static void pack_model_data(block_data_t data, int dest_x, int dest_y,
+                            int dest_z, model_buffer *out) {
   short block_id = 0;
   short orientation = 0;
   short rot = 0;
   short water_level = 0;
-  get_block_info(c->blocks[x][y][z], &block_id, &orientation, &rot,
-                 &water_level);
-  block_type block = get_block_type(block_id);
-  if (block.id == -1 || !block.is_custom_model || block.model == NULL) {
+  get_block_info(data, &block_id, &orientation, &rot, &water_level);
+  const block_type *block = lookup_block_type(block_id);
+  if (block->id == -1 || !block->is_custom_model || block->model == NULL) {
     return;
   }
 
   // reference blockbench model data hashmap based on model name
   blockbench_model *model = NULL;
 
-  if (block.oriented) {
-    model = get_blockbench_model(block.models[orientation]);
+  if (block->oriented) {
+    model = get_blockbench_model(block->models[orientation]);
   } else {
-    model = get_blockbench_model(block.model);
+    model = get_blockbench_model(block->model);
   }
 
   if (model == NULL) {
     return;
   }
 
-  int new_vert_count = (*num_custom_verts) + model->index_count;
-  if (new_vert_count > MODEL_VERTICES_PER_CHUNK) {
-    float *tmp = realloc(*custom_model_data, new_vert_count * sizeof(float) *
-                                                 FLOATS_PER_MODEL_VERT);
-    assert(tmp != NULL && "Failed to allocate memory for custom model data");
-    *custom_model_data = tmp;
+  if (model->id < 0) {
+    return;
   }
 
-  mat4 transformation;
-  get_model_transformation(transformation, &block, orientation, rot);
-
-  // copy model data into chunk mesh data
-  for (int i = 0; i < model->index_count; i++) {
-    int dest_idx = (*num_custom_verts + i) * FLOATS_PER_MODEL_VERT;
-
-    float dest_x = F_CHUNK_POS_TO_WORLD_POS(c->x, x);
-    float dest_y = (float)y;
-    float dest_z = F_CHUNK_POS_TO_WORLD_POS(c->z, z);
-    blockbench_vertex vert = model->vertices[model->indices[i]];
-
-    // apply transformation
-    vec4 pos = {vert.position[0], vert.position[1], vert.position[2], 1.0f};
-    vec4 normals = {vert.normal[0], vert.normal[1], vert.normal[2], 0.0f};
-
-    vec4 transformed_vert, transformed_normals;
-    glm_mat4_mulv(transformation, pos, transformed_vert);
-    glm_mat4_mulv(transformation, normals, transformed_normals);
-
-    // position
-    (*custom_model_data)[dest_idx + 0] = dest_x + transformed_vert[0];
-    (*custom_model_data)[dest_idx + 1] = dest_y + transformed_vert[1];
-    (*custom_model_data)[dest_idx + 2] = dest_z + transformed_vert[2];
-
-    // normal
-    (*custom_model_data)[dest_idx + 3] = transformed_normals[0];
-    (*custom_model_data)[dest_idx + 4] = transformed_normals[1];
-    (*custom_model_data)[dest_idx + 5] = transformed_normals[2];
-
-    // uv
-    (*custom_model_data)[dest_idx + 6] = vert.uv[0];
-    (*custom_model_data)[dest_idx + 7] = vert.uv[1];
-  }
+  model_instance *instance = model_buffer_push(out);
+  instance->x = dest_x;
+  instance->y = dest_y;
+  instance->z = dest_z;
+  instance->model_id = model->id;
+  instance->rotation = get_model_rotation(block, orientation, rot);
+}
 
-  *num_custom_verts = new_vert_count;
+void pack_model(int x, int y, int z, chunk *c, model_buffer *out) {
+  pack_model_data(c->blocks[x][y][z], CHUNK_POS_TO_WORLD_POS(c->x, x), y,
+                  CHUNK_POS_TO_WORLD_POS(c->z, z), out);
 }
 
 bool in_chunk_bounds(int x, int y, int z) {
@@ -620,191 +872,607 @@ bool in_chunk_bounds(int x, int y, int z) {
          z < CHUNK_SIZE && z >= 0;
 }
 
-static int get_stored_surface_block_height(chunk* c, int x, int z) {
-  if (c == NULL || x < 0 || x >= CHUNK_SIZE || z < 0 || z >= CHUNK_SIZE) {
-    return -1;
-  }
+// Neighbour of a pyramid cell, crossing into the adjacent chunk's pyramid on
+// the horizontal sides. Cell coordinates are in units of lod_scale.
+static block_data_t get_lod_adjacent_block_data(int x, int y, int z,
+                                                short side, short lod_scale,
+                                                chunk_lod *l, chunk_lod *adj) {
+  int width = CHUNK_SIZE / lod_scale;
 
-  short id = 0;
-  short water_id = get_block_id("water");
-  short air_id = get_block_id("air");
-  for (int y = CHUNK_HEIGHT - 1; y >= 0; y--) {
-    get_block_info(c->blocks[x][y][z], &id, NULL, NULL, NULL);
-    if (id == air_id || id == water_id) {
-      continue;
-    }
-
-    block_type type = get_block_type(id);
-    if (type.id == -1 || type.is_custom_model) {
-      continue;
-    }
-
-    return y;
+  switch (side) {
+  case (int)UP:
+    return chunk_lod_sample(l, lod_scale, x, y + 1, z);
+  case (int)DOWN:
+    return chunk_lod_sample(l, lod_scale, x, y - 1, z);
+  case (int)WEST:
+    return x + 1 < width ? chunk_lod_sample(l, lod_scale, x + 1, y, z)
+                         : chunk_lod_sample(adj, lod_scale, 0, y, z);
+  case (int)EAST:
+    return x > 0 ? chunk_lod_sample(l, lod_scale, x - 1, y, z)
+                 : chunk_lod_sample(adj, lod_scale, width - 1, y, z);
+  case (int)NORTH:
+    return z > 0 ? chunk_lod_sample(l, lod_scale, x, y, z - 1)
+                 : chunk_lod_sample(adj, lod_scale, x, y, width - 1);
+  case (int)SOUTH:
+    return z + 1 < width ? chunk_lod_sample(l, lod_scale, x, y, z + 1)
+                         : chunk_lod_sample(adj, lod_scale, x, y, 0);
+  default:
+    // out of range sample returns air
+    return chunk_lod_sample(NULL, lod_scale, x, y, z);
   }
-
-  return -1;
 }
 
-void pack_skirt_side(short side, chunk* c, chunk* adj_chunks[4], side_instance **opaque_side_data, int *num_opaque_sides, int skirt_depth, short lod_scale) {
-  struct direction {
-    int x;
-    int z;
-  };
+// Mesh a chunk from its LOD pyramid, one cell per lod_scale^3 block region,
+// without touching the full resolution blocks
+static void pack_lod_chunk(chunk *c, chunk_lod *l, chunk *adj_chunks[4],
+                           const mesh_seams *seams, short lod_scale,
+                           mesh_scratch *out,
+                           int render_transparent, int render_foliage) {
+  chunk_lod *const *adj_lods = seams->adj_lod;
 
-  struct direction dir = {.x = 0, .z = 0};
+  short air_id = mesh_air_id;
+  int width = CHUNK_SIZE / lod_scale;
+  int height = CHUNK_HEIGHT / lod_scale;
 
-  int start_x = 0;
-  int start_z = 0;
+  for (int i = 0; i < width; i++) {
+    for (int j = 0; j < width; j++) {
+      for (int k = 0; k < height; k++) {
+        block_data_t current = chunk_lod_sample(l, lod_scale, i, k, j);
 
-  switch(side) {
-    case (short)NORTH:
-      dir.x = lod_scale;
-      start_z = 0;
-      break;
-    case (short)SOUTH:
-      dir.x = lod_scale;
-      start_z = CHUNK_SIZE - lod_scale;
-      break;
-    case (short)EAST:
-      dir.z = lod_scale;
-      start_x = 0;
-      break;
-    case (short)WEST:
-      dir.z = lod_scale;
-      start_x = CHUNK_SIZE - lod_scale;
-      break;
-  }
-
-  int num_positions = CHUNK_SIZE / lod_scale;
-  int idx = *num_opaque_sides;
-  (*num_opaque_sides) += skirt_depth * num_positions;
-
-  // check if we need to reallocate memory
-  if (*num_opaque_sides > SIDES_PER_CHUNK) {
-    side_instance *tmp = realloc(*opaque_side_data, *(num_opaque_sides) * sizeof(side_instance));
-    assert(tmp != NULL && "Failed to allocate memory for side data");
-    *opaque_side_data = tmp;
-  }
-
-  for (int i = 0; i < num_positions; i++) {
-    int x = start_x + dir.x * i;
-    int z = start_z + dir.z * i;
+        short block_id = 0;
+        get_block_info(current, &block_id, NULL, NULL, NULL);
+        if (block_id == air_id) {
+          continue;
+        }
 
-    int surface_block_height = get_stored_surface_block_height(c, x, z);
-    if (surface_block_height < 0) {
-      continue;
-    }
+        const block_type *block = lookup_block_type(block_id);
+        if (block->id == -1) {
+          continue; // Invalid block type, skip
+        }
 
-    // needs to be normalized so that the top of the block matches the sides.
-    // so, the surface_y should divide lod_scale to ensure that no chunk skirt pops through the top of the chunk
-    int surface_y = lod_scale * (int)((surface_block_height / lod_scale) + 1);
-    int start_y = surface_y - skirt_depth * lod_scale;
+        // block coordinates of the cell origin
+        int x = i * lod_scale;
+        int y = k * lod_scale;
+        int z = j * lod_scale;
 
-    for (int y = start_y; y < surface_y; y += lod_scale) {
-      if (y < 0 || y >= CHUNK_HEIGHT) {
-        continue;
+        block_data_t adjacent[6];
+        for (int side = 0; side < 6; side++) {
+          chunk_lod *adj = side < 4 ? adj_lods[side] : NULL;
+          adjacent[side] = get_lod_adjacent_block_data(i, k, j, side,
+                                                       lod_scale, l, adj);
+        }
+        stitch_border_sides(adjacent, x, y, z, lod_scale, adj_chunks, seams);
+
+        // Water flow transitions need full resolution levels, so LOD liquids
+        // only get their surface faces
+        if (block->liquid) {
+          pack_block_sides(current, adjacent, x, y, z, c, NULL,
+                           &out->liquid);
+        } else if (block->transparent && !block->is_foliage) {
+          if (render_transparent) {
+            pack_block_sides(current, adjacent, x, y, z, c, NULL,
+                             &out->transparent);
+          }
+        } else if (block->transparent && block->is_foliage) {
+          if (render_foliage) {
+            pack_block_sides(current, adjacent, x, y, z, c, NULL,
+                             &out->foliage);
+          }
+        } else if (block->is_custom_model) {
+          pack_model_data(current, CHUNK_POS_TO_WORLD_POS(c->x, x), y,
+                          CHUNK_POS_TO_WORLD_POS(c->z, z), &out->models);
+        } else {
+          pack_block_sides(current, adjacent, x, y, z, c, NULL,
+                           &out->opaque);
+        }
       }
-
-      short rot = 0;
-      short orientation = 0;
-      short id = 0;
-      short water_level = 0;
-      bool underwater = 0;
-
-      get_block_info(c->blocks[x][y][z], &id, &orientation, &rot, &water_level);
-      int ao = calculate_face_ao(x, y, z, (int)side, c, adj_chunks);
-
-      int world_x = CHUNK_POS_TO_WORLD_POS(c->x, x);
-      int world_y = y;
-      int world_z = CHUNK_POS_TO_WORLD_POS(c->z, z);
-      pack_side(world_x, world_y, world_z, (short)side, orientation, rot, id, water_level, underwater, ao, &((*opaque_side_data)[idx]));
-      idx++;
     }
   }
-
-}
-
-// Generate vertical skirt faces along chunk boundaries to hide LOD seams
-// The skirt extends downward from the bottom of terrain at each edge position
-void pack_chunk_skirt(chunk *c, chunk* adj_chunks[4], side_instance **opaque_side_data, int *num_opaque_sides, int skirt_depth, short lod_scale) {
-  if (c == NULL) {
-    return;
-  }
-
-  pack_skirt_side((int)NORTH, c, adj_chunks, opaque_side_data, num_opaque_sides, skirt_depth, lod_scale);
-  pack_skirt_side((int)SOUTH, c, adj_chunks, opaque_side_data, num_opaque_sides, skirt_depth, lod_scale);
-  pack_skirt_side((int)EAST, c, adj_chunks, opaque_side_data, num_opaque_sides, skirt_depth, lod_scale);
-  pack_skirt_side((int)WEST, c, adj_chunks, opaque_side_data, num_opaque_sides, skirt_depth, lod_scale);
 }
 
-void pack_chunk(chunk *c, chunk *adj_chunks[4], short lod_scale,
-                side_instance **opaque_side_data, int *num_opaque_sides,
-                side_instance **transparent_side_data,
-                int *num_transparent_sides, side_instance **foliage_side_data,
-                int *num_foliage_sides, side_instance **liquid_side_data,
-                int *num_liquid_sides, float **custom_model_data,
-                int *num_custom_verts, int render_transparent,
-                int render_foliage) {
-  if (c == NULL) {
-    return;
-  }
-
+// Mesh the full resolution blocks with y in [y_min, y_max)
+static void pack_chunk_range(chunk *c, chunk *adj_chunks[4],
+                             const mesh_seams *seams, short lod_scale,
+                             const ao_grid *ao_grid, int y_min, int y_max,
+                             mesh_scratch *out, int render_transparent,
+                             int render_foliage) {
   for (int i = 0; i < CHUNK_SIZE; i += lod_scale) {
     for (int j = 0; j < CHUNK_SIZE; j += lod_scale) {
-      for (int k = 0; k < CHUNK_HEIGHT; k += lod_scale) {
+      for (int k = y_min; k < y_max; k += lod_scale) {
         if (!in_chunk_bounds(i, k, j)) {
           continue;
         }
 
         short block_id = 0;
-        get_block_info(c->blocks[i][k][j], &block_id, NULL, NULL,
-                       NULL); // this may need to turn in to an average of a
-                              // nxnxn box where n is lod_scale
-        if (block_id == get_block_id("air")) {
+        get_block_info(c->blocks[i][k][j], &block_id, NULL, NULL, NULL);
+        if (block_id == mesh_air_id) {
           continue;
         }
 
-        block_type block = get_block_type(block_id);
-        if (block.id == -1) {
+        const block_type *block = lookup_block_type(block_id);
+        if (block->id == -1) {
           continue; // Invalid block type, skip
         }
-        if (block.liquid) {
+        if (block->liquid) {
           // Pack normal liquid faces
-          pack_block(i, k, j, lod_scale, c, adj_chunks, liquid_side_data,
-                     num_liquid_sides);
+          pack_block(i, k, j, lod_scale, c, adj_chunks, seams, ao_grid,
+                     &out->liquid);
 
           // Pack water flow transitions
           short current_water_level = 0;
           get_block_info(c->blocks[i][k][j], NULL, NULL, NULL,
                          &current_water_level);
           pack_water_transitions(i, k, j, lod_scale, c, adj_chunks,
-                                 current_water_level, liquid_side_data,
-                                 num_liquid_sides);
-        } else if (block.transparent && !block.is_foliage) {
+                                 current_water_level, &out->liquid);
+        } else if (block->transparent && !block->is_foliage) {
           // Only pack transparent blocks if within render distance
           if (render_transparent) {
-            pack_block(i, k, j, lod_scale, c, adj_chunks, transparent_side_data,
-                       num_transparent_sides);
+            pack_block(i, k, j, lod_scale, c, adj_chunks, seams, ao_grid,
+                       &out->transparent);
           }
-        } else if (block.transparent && block.is_foliage) {
+        } else if (block->transparent && block->is_foliage) {
           // Only pack foliage blocks if within render distance
           if (render_foliage) {
-            pack_block(i, k, j, lod_scale, c, adj_chunks, foliage_side_data,
-                       num_foliage_sides);
+            pack_block(i, k, j, lod_scale, c, adj_chunks, seams, ao_grid,
+                       &out->foliage);
           }
-        } else if (block.is_custom_model) {
-          pack_model(i, k, j, c, custom_model_data, num_custom_verts);
+        } else if (block->is_custom_model) {
+          pack_model(i, k, j, c, &out->models);
         } else {
-          pack_block(i, k, j, lod_scale, c, adj_chunks, opaque_side_data,
-                     num_opaque_sides);
+          pack_block(i, k, j, lod_scale, c, adj_chunks, seams, ao_grid,
+                     &out->opaque);
         }
       }
     }
   }
+}
 
-  // Generate chunk boundary skirts to hide LOD seams
-  pack_chunk_skirt(c, adj_chunks, opaque_side_data, num_opaque_sides,
-                   CHUNK_SKIRT_DEPTH, lod_scale);
+// Kernels specialized for one LOD. Each copy is instantiated with the scale
+// as a compile time constant, so strides, bounds and neighbour offsets fold
+// away and the generic packers above are only used for scales without one.
+#define MESH_KERNEL_INLINE static inline __attribute__((always_inline))
+
+MESH_KERNEL_INLINE block_data_t
+get_kernel_neighbour(chunk *c, chunk *adj_chunks[4], block_data_t air, int x,
+                     int y, int z, short side, const short lod_scale) {
+  chunk *adj = side < 4 ? adj_chunks[side] : NULL;
+  switch (side) {
+  case (int)UP:
+    return y + lod_scale < CHUNK_HEIGHT ? c->blocks[x][y + lod_scale][z] : air;
+  case (int)DOWN:
+    return y - lod_scale >= 0 ? c->blocks[x][y - lod_scale][z] : air;
+  case (int)WEST:
+    if (x + lod_scale < CHUNK_SIZE) {
+      return c->blocks[x + lod_scale][y][z];
+    }
+    return adj != NULL ? adj->blocks[x + lod_scale - CHUNK_SIZE][y][z] : air;
+  case (int)EAST:
+    if (x - lod_scale >= 0) {
+      return c->blocks[x - lod_scale][y][z];
+    }
+    return adj != NULL ? adj->blocks[CHUNK_SIZE - lod_scale + x][y][z] : air;
+  case (int)NORTH:
+    if (z - lod_scale >= 0) {
+      return c->blocks[x][y][z - lod_scale];
+    }
+    return adj != NULL ? adj->blocks[x][y][CHUNK_SIZE - lod_scale + z] : air;
+  case (int)SOUTH:
+    if (z + lod_scale < CHUNK_SIZE) {
+      return c->blocks[x][y][z + lod_scale];
+    }
+    return adj != NULL ? adj->blocks[x][y][z + lod_scale - CHUNK_SIZE] : air;
+  default:
+    return air;
+  }
+}
+
+MESH_KERNEL_INLINE void pack_chunk_range_kernel(
+    chunk *c, chunk *adj_chunks[4], const mesh_seams *seams,
+    const ao_grid *ao_grid, int y_min, int y_max, mesh_scratch *out,
+    int render_transparent, int render_foliage, const short lod_scale) {
+  short air_id = mesh_air_id;
+  // matches get_adjacent_block_data past the world edges
+  block_data_t air = {.bytes = {0, 0, 0}};
+
+  for (int i = 0; i < CHUNK_SIZE; i += lod_scale) {
+    for (int j = 0; j < CHUNK_SIZE; j += lod_scale) {
+      for (int k = y_min; k < y_max; k += lod_scale) {
+        block_data_t current = c->blocks[i][k][j];
+        short block_id = 0;
+        short water_level = 0;
+        get_block_info(current, &block_id, NULL, NULL, &water_level);
+        if (block_id == air_id) {
+          continue;
+        }
+
+        const block_type *block = lookup_block_type(block_id);
+        if (block->id == -1) {
+          continue; // Invalid block type, skip
+        }
+
+        side_buffer *target = NULL;
+        if (block->liquid) {
+          target = &out->liquid;
+        } else if (block->transparent && !block->is_foliage) {
+          target = render_transparent ? &out->transparent : NULL;
+        } else if (block->transparent && block->is_foliage) {
+          target = render_foliage ? &out->foliage : NULL;
+        } else if (block->is_custom_model) {
+          pack_model(i, k, j, c, &out->models);
+        } else {
+          target = &out->opaque;
+        }
+        if (target == NULL) {
+          continue;
+        }
+
+        block_data_t adjacent[6];
+        for (int side = 0; side < 6; side++) {
+          adjacent[side] = get_kernel_neighbour(c, adj_chunks, air, i, k, j,
+                                                side, lod_scale);
+        }
+        stitch_border_sides(adjacent, i, k, j, lod_scale, adj_chunks, seams);
+        pack_block_sides(current, adjacent, i, k, j, c, ao_grid, target);
+
+        if (block->liquid) {
+          pack_water_transitions(i, k, j, lod_scale, c, adj_chunks,
+                                 water_level, &out->liquid);
+        }
+      }
+    }
+  }
+}
+
+MESH_KERNEL_INLINE block_data_t get_kernel_cell(const block_data_t *cells,
+                                                int x, int y, int z,
+                                                const short lod_scale) {
+  const int width = CHUNK_SIZE / lod_scale;
+  const int height = CHUNK_HEIGHT / lod_scale;
+  return cells[(x * height + y) * width + z];
+}
+
+MESH_KERNEL_INLINE block_data_t get_kernel_lod_neighbour(
+    const block_data_t *cells, const block_data_t *adj_cells[4],
+    block_data_t air, int x, int y, int z, short side, const short lod_scale) {
+  const int width = CHUNK_SIZE / lod_scale;
+  const int height = CHUNK_HEIGHT / lod_scale;
+  const block_data_t *adj = side < 4 ? adj_cells[side] : NULL;
+
+  switch (side) {
+  case (int)UP:
+    return y + 1 < height ? get_kernel_cell(cells, x, y + 1, z, lod_scale)
+                          : air;
+  case (int)DOWN:
+    return y > 0 ? get_kernel_cell(cells, x, y - 1, z, lod_scale) : air;
+  case (int)WEST:
+    if (x + 1 < width) {
+      return get_kernel_cell(cells, x + 1, y, z, lod_scale);
+    }
+    return adj != NULL ? get_kernel_cell(adj, 0, y, z, lod_scale) : air;
+  case (int)EAST:
+    if (x > 0) {
+      return get_kernel_cell(cells, x - 1, y, z, lod_scale);
+    }
+    return adj != NULL ? get_kernel_cell(adj, width - 1, y, z, lod_scale)
+                       : air;
+  case (int)NORTH:
+    if (z > 0) {
+      return get_kernel_cell(cells, x, y, z - 1, lod_scale);
+    }
+    return adj != NULL ? get_kernel_cell(adj, x, y, width - 1, lod_scale)
+                       : air;
+  case (int)SOUTH:
+    if (z + 1 < width) {
+      return get_kernel_cell(cells, x, y, z + 1, lod_scale);
+    }
+    return adj != NULL ? get_kernel_cell(adj, x, y, 0, lod_scale) : air;
+  default:
+    return air;
+  }
+}
+
+MESH_KERNEL_INLINE void
+pack_lod_chunk_kernel(chunk *c, chunk_lod *l, chunk *adj_chunks[4],
+                      const mesh_seams *seams, mesh_scratch *out,
+                      int render_transparent, int render_foliage,
+                      const short lod_scale) {
+  const int width = CHUNK_SIZE / lod_scale;
+  const int height = CHUNK_HEIGHT / lod_scale;
+
+  const block_data_t *cells = chunk_lod_level(l, lod_scale);
+  const block_data_t *adj_cells[4];
+  for (int side = 0; side < 4; side++) {
+    adj_cells[side] = chunk_lod_level(seams->adj_lod[side], lod_scale);
+  }
+
+  short air_id = mesh_air_id;
+  // out of range samples are air, same as chunk_lod_sample
+  block_data_t air = chunk_lod_sample(NULL, lod_scale, 0, 0, 0);
+
+  for (int i = 0; i < width; i++) {
+    for (int j = 0; j < width; j++) {
+      for (int k = 0; k < height; k++) {
+        block_data_t current = get_kernel_cell(cells, i, k, j, lod_scale);
+
+        short block_id = 0;
+        get_block_info(current, &block_id, NULL, NULL, NULL);
+        if (block_id == air_id) {
+          continue;
+        }
+
+        const block_type *block = lookup_block_type(block_id);
+        if (block->id == -1) {
+          continue; // Invalid block type, skip
+        }
+
+        // block coordinates of the cell origin
+        int x = i * lod_scale;
+        int y = k * lod_scale;
+        int z = j * lod_scale;
+
+        side_buffer *target = NULL;
+        if (block->liquid) {
+          target = &out->liquid;
+        } else if (block->transparent && !block->is_foliage) {
+          target = render_transparent ? &out->transparent : NULL;
+        } else if (block->transparent && block->is_foliage) {
+          target = render_foliage ? &out->foliage : NULL;
+        } else if (block->is_custom_model) {
+          pack_model_data(current, CHUNK_POS_TO_WORLD_POS(c->x, x), y,
+                          CHUNK_POS_TO_WORLD_POS(c->z, z), &out->models);
+        } else {
+          target = &out->opaque;
+        }
+        if (target == NULL) {
+          continue;
+        }
+
+        block_data_t adjacent[6];
+        for (int side = 0; side < 6; side++) {
+          adjacent[side] = get_kernel_lod_neighbour(cells, adj_cells, air, i,
+                                                    k, j, side, lod_scale);
+        }
+        stitch_border_sides(adjacent, x, y, z, lod_scale, adj_chunks, seams);
+        pack_block_sides(current, adjacent, x, y, z, c, NULL, target);
+      }
+    }
+  }
+}
+
+typedef void (*pack_range_fn)(chunk *c, chunk *adj_chunks[4],
+                              const mesh_seams *seams, short lod_scale,
+                              const ao_grid *ao_grid, int y_min, int y_max,
+                              mesh_scratch *out, int render_transparent,
+                              int render_foliage);
+
+typedef void (*pack_lod_fn)(chunk *c, chunk_lod *l, chunk *adj_chunks[4],
+                            const mesh_seams *seams, short lod_scale,
+                            mesh_scratch *out, int render_transparent,
+                            int render_foliage);
+
+#define DEFINE_RANGE_KERNEL(scale)                                             \
+  static void pack_chunk_range_##scale(                                        \
+      chunk *c, chunk *adj_chunks[4], const mesh_seams *seams,                 \
+      short lod_scale, const ao_grid *ao_grid, int y_min, int y_max,           \
+      mesh_scratch *out, int render_transparent, int render_foliage) {         \
+    (void)lod_scale;                                                           \
+    pack_chunk_range_kernel(c, adj_chunks, seams, ao_grid, y_min, y_max, out,  \
+                            render_transparent, render_foliage, scale);        \
+  }
+
+#define DEFINE_LOD_KERNEL(scale)                                               \
+  static void pack_lod_chunk_##scale(                                          \
+      chunk *c, chunk_lod *l, chunk *adj_chunks[4], const mesh_seams *seams,   \
+      short lod_scale, mesh_scratch *out, int render_transparent,              \
+      int render_foliage) {                                                    \
+    (void)lod_scale;                                                           \
+    pack_lod_chunk_kernel(c, l, adj_chunks, seams, out, render_transparent,    \
+                          render_foliage, scale);                              \
+  }
+
+DEFINE_RANGE_KERNEL(1)
+DEFINE_LOD_KERNEL(2)
+DEFINE_LOD_KERNEL(4)
+DEFINE_LOD_KERNEL(8)
+
+static mesh_kernel_mode mesh_kernels = MESH_KERNELS_SPECIALIZED;
+
+void set_mesh_kernel_mode(mesh_kernel_mode mode) {
+  mesh_kernels = mode;
+}
+
+static pack_range_fn get_range_kernel(short lod_scale) {
+  if (mesh_kernels == MESH_KERNELS_SPECIALIZED && lod_scale == 1) {
+    return pack_chunk_range_1;
+  }
+  return pack_chunk_range;
+}
+
+static pack_lod_fn get_lod_kernel(short lod_scale) {
+  if (mesh_kernels == MESH_KERNELS_SPECIALIZED) {
+    switch (lod_scale) {
+    case 2:
+      return pack_lod_chunk_2;
+    case 4:
+      return pack_lod_chunk_4;
+    case 8:
+      return pack_lod_chunk_8;
+    default:
+      break;
+    }
+  }
+  return pack_lod_chunk;
+}
+
+// One vertical slice of a chunk
+typedef struct {
+  chunk *c;
+  chunk **adj_chunks;
+  const mesh_seams *seams;
+  short lod_scale;
+  const ao_grid *ao_grid;
+  int y_min, y_max;
+  int render_transparent;
+  int render_foliage;
+  mesh_scratch *out;
+  pack_range_fn pack_range;
+} mesh_section_job;
+
+static void *run_mesh_section(void *ctx) {
+  mesh_section_job *job = (mesh_section_job *)ctx;
+  job->pack_range(job->c, job->adj_chunks, job->seams, job->lod_scale,
+                  job->ao_grid, job->y_min, job->y_max, job->out,
+                  job->render_transparent, job->render_foliage);
+  return job->out;
+}
+
+// Height just above the highest non-air block, everything above it is skipped
+// when splitting so every section gets a share of the actual terrain
+static int get_chunk_top(chunk *c) {
+  short air_id = mesh_air_id;
+  for (int y = CHUNK_HEIGHT - 1; y >= 0; y--) {
+    for (int x = 0; x < CHUNK_SIZE; x++) {
+      for (int z = 0; z < CHUNK_SIZE; z++) {
+        short id = 0;
+        get_block_info(c->blocks[x][y][z], &id, NULL, NULL, NULL);
+        if (id != air_id) {
+          return y + 1;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+static void append_sides(side_buffer *dst, side_buffer *src) {
+  if (src->count == 0) {
+    return;
+  }
+  side_buffer_reserve(dst, dst->count + src->count);
+  memcpy(dst->sides + dst->count, src->sides,
+         src->count * sizeof(side_instance));
+  dst->count += src->count;
+}
+
+static void append_models(model_buffer *dst, model_buffer *src) {
+  if (src->count == 0) {
+    return;
+  }
+  model_buffer_reserve(dst, dst->count + src->count);
+  memcpy(dst->instances + dst->count, src->instances,
+         src->count * sizeof(model_instance));
+  dst->count += src->count;
+}
+
+// Split the full resolution blocks into vertical sections and mesh them on the
+// worker pool. Sections go to the front of the queue (or the calling worker's
+// deque), the calling thread packs the first one itself and waiting takes
+// back any a worker has not started, so this never waits on unrelated chunks
+// and is safe to call from a worker.
+static void pack_chunk_sections(chunk *c, chunk *adj_chunks[4],
+                                const mesh_seams *seams, short lod_scale,
+                                pack_range_fn pack_range,
+                                const ao_grid *ao_grid,
+                                int sections, mesh_scratch *out,
+                                int render_transparent, int render_foliage) {
+  int top = get_chunk_top(c);
+  int section_height = (top + sections - 1) / sections;
+  if (section_height < MESH_MIN_SECTION_HEIGHT) {
+    section_height = MESH_MIN_SECTION_HEIGHT;
+  }
+  // keep every section aligned to the LOD step
+  section_height = (section_height + lod_scale - 1) / lod_scale * lod_scale;
+  sections = (top + section_height - 1) / section_height;
+
+  if (sections <= 1) {
+    pack_range(c, adj_chunks, seams, lod_scale, ao_grid, 0, top, out,
+               render_transparent, render_foliage);
+    return;
+  }
+
+  mesh_section_job jobs[MESH_MAX_SECTIONS];
+  for (int i = 0; i < sections; i++) {
+    mesh_section_job *job = &jobs[i];
+    job->c = c;
+    job->adj_chunks = adj_chunks;
+    job->seams = seams;
+    job->lod_scale = lod_scale;
+    job->ao_grid = ao_grid;
+    job->y_min = i * section_height;
+    job->y_max = i == sections - 1 ? top : (i + 1) * section_height;
+    job->render_transparent = render_transparent;
+    job->render_foliage = render_foliage;
+    // the first section packs straight into the output
+    job->out = i == 0 ? out : get_mesh_section_scratch(i);
+    job->pack_range = pack_range;
+  }
+
+  pool_future *futures[MESH_MAX_SECTIONS] = {NULL};
+  for (int i = sections - 1; i > 0; i--) {
+    futures[i] = pool_submit(
+        chunk_worker_pool,
+        &(pool_task){.run = run_mesh_section, .ctx = &jobs[i], .urgent = 1});
+  }
+
+  run_mesh_section(&jobs[0]);
+  // Waiting runs any section no worker has picked up on this thread
+  for (int i = 1; i < sections; i++) {
+    if (futures[i] == NULL) {
+      run_mesh_section(&jobs[i]);
+      continue;
+    }
+    pool_future_wait(futures[i]);
+    pool_future_release(futures[i]);
+  }
+
+  // Stitch the sections together bottom to top
+  for (int i = 1; i < sections; i++) {
+    append_sides(&out->opaque, &jobs[i].out->opaque);
+    append_sides(&out->transparent, &jobs[i].out->transparent);
+    append_sides(&out->liquid, &jobs[i].out->liquid);
+    append_sides(&out->foliage, &jobs[i].out->foliage);
+    append_models(&out->models, &jobs[i].out->models);
+  }
+}
+
+void pack_chunk(chunk *c, chunk *adj_chunks[4], short lod_scale,
+                const short adj_lod_scales[4], int sections, mesh_scratch *out,
+                int render_transparent, int render_foliage) {
+  if (c == NULL) {
+    return;
+  }
+  init_mesh_block_types();
+
+  // AO is invisible at LOD > 1, so the opacity grid is only built for full
+  // detail meshes and coarser faces are packed fully lit
+  const ao_grid *ao_grid = NULL;
+  if (lod_scale == 1) {
+    build_ao_grid(&out->ao, c, adj_chunks);
+    ao_grid = &out->ao;
+  }
+
+  mesh_seams seams;
+  init_mesh_seams(&seams, adj_chunks, adj_lod_scales, lod_scale);
+
+  // Scales with a pyramid level are meshed from the downsampled grid
+  chunk_lod *l = chunk_lod_has_level(lod_scale) ? get_chunk_lod(c) : NULL;
+  if (l != NULL) {
+    pack_lod_fn pack_lod = get_lod_kernel(lod_scale);
+    pack_lod(c, l, adj_chunks, &seams, lod_scale, out, render_transparent,
+             render_foliage);
+    release_chunk_lod(l);
+  } else {
+    pack_range_fn pack_range = get_range_kernel(lod_scale);
+    if (sections > 1 && chunk_worker_pool != NULL) {
+      pack_chunk_sections(c, adj_chunks, &seams, lod_scale, pack_range,
+                          ao_grid, sections, out, render_transparent,
+                          render_foliage);
+    } else {
+      pack_range(c, adj_chunks, &seams, lod_scale, ao_grid, 0, CHUNK_HEIGHT,
+                 out, render_transparent, render_foliage);
+    }
+  }
+  release_mesh_seams(&seams);
 }
 
 short calculate_lod(int x, int z, float player_x, float player_z) {
@@ -816,8 +1484,35 @@ short calculate_lod(int x, int z, float player_x, float player_z) {
   float dist = sqrtf(dx * dx + dz * dz);
 
   float lod = fmax(1.0f, log(dist - 8) / log(LOD_SCALING_CONSTANT));
+  lod = fmin(lod, MAX_LOD_BLOCK_SIZE);
 
-  return (short)fmin(lod, MAX_LOD_BLOCK_SIZE);
+  // Snap down to a power of two so every LOD divides the chunk and maps onto
+  // a level of the chunk LOD pyramid
+  short lod_scale = 1;
+  while (lod_scale * 2 <= lod && lod_scale * 2 <= CHUNK_SIZE) {
+    lod_scale *= 2;
+  }
+  return lod_scale;
+}
+
+// LODs the four neighbours of a chunk are meshed at, in adj_chunks order
+static void get_adjacent_lods(int x, int z, float player_x, float player_z,
+                              short out[4]) {
+  out[(int)NORTH] = calculate_lod(x, z - 1, player_x, player_z);
+  out[(int)WEST] = calculate_lod(x + 1, z, player_x, player_z);
+  out[(int)SOUTH] = calculate_lod(x, z + 1, player_x, player_z);
+  out[(int)EAST] = calculate_lod(x - 1, z, player_x, player_z);
+}
+
+int chunk_mesh_seams_stale(chunk_mesh *mesh, float player_x, float player_z) {
+  if (mesh == NULL) {
+    return 0;
+  }
+
+  short adj_lod_scales[4];
+  get_adjacent_lods(mesh->x, mesh->z, player_x, player_z, adj_lod_scales);
+  return memcmp(mesh->adj_lod_scales, adj_lod_scales,
+                sizeof(adj_lod_scales)) != 0;
 }
 
 // Check if chunk is within foliage render distance
@@ -842,23 +1537,90 @@ int is_chunk_in_transparent_distance(int chunk_x, int chunk_z, float player_x,
   return dist <= (float)TRANSPARENT_RENDER_DISTANCE;
 }
 
-void process_chunk_work_item(chunk_work_item *work) {
-  if (work == NULL) {
-    return;
-  }
+static chunk_mesh *build_chunk_mesh(int x, int z, float player_x,
+                                    float player_z, int edited, int cached);
 
-  // Create chunk mesh for this work item (this also stores it in chunk_packets)
-  chunk_mesh *mesh =
-      create_chunk_mesh(work->x, work->z, work->player_x, work->player_z);
+static void *run_chunk_work(void *ctx) {
+  chunk_work_item *work = (chunk_work_item *)ctx;
 
-  work->result_mesh = mesh;
-  work->work_complete = 1;
+  // Create chunk mesh for this work item (this also stores it in chunk_packets).
+  // Pool jobs run outside the mesh lock, so only they use the disk cache.
+  float player_x, player_z;
+  get_mesh_player_pos(&player_x, &player_z);
+  chunk_mesh *mesh =
+      build_chunk_mesh(work->x, work->z, player_x, player_z, 0, 1);
 
   // Free the work item after processing
   free(work);
+  notify_mesh_pipeline();
+  return mesh;
 }
 
-chunk_mesh *create_chunk_mesh(int x, int z, float player_x, float player_z) {
+// Number of sections to split a chunk into. Only full detail chunks the player
+// is waiting on are split, far chunks stay one job each for throughput.
+static int get_mesh_sections(int x, int z, float player_x, float player_z,
+                             short lod_scale, int edited) {
+  if (lod_scale != 1 || MESH_SECTIONS <= 1) {
+    return 1;
+  }
+
+  int dx = abs(x - WORLD_POS_TO_CHUNK_POS(player_x));
+  int dz = abs(z - WORLD_POS_TO_CHUNK_POS(player_z));
+  if (!edited && (dx > MESH_SECTION_DISTANCE || dz > MESH_SECTION_DISTANCE)) {
+    return 1;
+  }
+
+  return MESH_SECTIONS < MESH_MAX_SECTIONS ? MESH_SECTIONS : MESH_MAX_SECTIONS;
+}
+
+// A rebuilt mesh gets new versions on every layer so the renderer uploads it
+static void stamp_chunk_mesh(chunk_mesh *packet) {
+  for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+    packet->layer_versions[layer] = next_chunk_mesh_version();
+  }
+}
+
+// Opaque sides are split by block side so the renderer can skip the ones
+// facing away from it, and every layer that is not depth sorted by section
+// for occlusion culling
+static void init_side_buckets(chunk_mesh *packet) {
+  for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+    int depth_sorted =
+        layer == MESH_LAYER_LIQUID ||
+        (layer == MESH_LAYER_TRANSPARENT && !ORDER_INDEPENDENT_TRANSPARENCY);
+    side_buckets *buckets = &packet->buckets[layer];
+    buckets->directions = layer == MESH_LAYER_OPAQUE ? SIDE_DIRECTIONS : 1;
+    buckets->sections = depth_sorted ? 1 : VISIBILITY_SECTIONS;
+  }
+}
+
+static void free_chunk_mesh_arrays(chunk_mesh *mesh) {
+  free(mesh->opaque_sides);
+  free(mesh->transparent_sides);
+  free(mesh->liquid_sides);
+  free(mesh->foliage_sides);
+  free(mesh->model_instances);
+}
+
+// Swap a finished mesh into chunk_packets, freeing the arrays of the one it
+// replaces. Taking the mesh lock waits out everyone still reading that one.
+static void publish_chunk_mesh(chunk_mesh_key key, chunk_mesh *packet) {
+  lock_mesh();
+  pthread_mutex_lock(&chunk_packets_mutex);
+  chunk_mesh *replaced = chunk_mesh_lod_map_get(&chunk_packets, key);
+  if (replaced != NULL) {
+    free_chunk_mesh_arrays(replaced);
+  }
+  chunk_mesh_lod_map_insert(&chunk_packets, key, *packet);
+  pthread_mutex_unlock(&chunk_packets_mutex);
+  unlock_mesh();
+}
+
+// Mesh a chunk and publish it. Edited chunks are split into sections even
+// when far away. cached reads and writes the disk cache, which callers
+// holding the mesh lock leave off so nobody waits on the disk behind them.
+static chunk_mesh *build_chunk_mesh(int x, int z, float player_x,
+                                    float player_z, int edited, int cached) {
   chunk_mesh *packet = malloc(sizeof(chunk_mesh));
   assert(packet != NULL && "Failed to allocate memory for packet");
 
@@ -874,66 +1636,107 @@ chunk_mesh *create_chunk_mesh(int x, int z, float player_x, float player_z) {
   chunk *adj_chunks[4] = {get_chunk(x, z - 1), get_chunk(x + 1, z),
                           get_chunk(x, z + 1), get_chunk(x - 1, z)};
 
-  // pack chunk data into packet
-  int transparent_side_count = 0;
-  int foliage_side_count = 0;
-  int opaque_side_count = 0;
-  int liquid_side_count = 0;
-  int custom_model_vert_count = 0;
-
-  // Allocate minimal memory for out-of-distance block types to prevent crashes
-  side_instance *opaque_sides = malloc(SIDES_PER_CHUNK * sizeof(side_instance));
-  side_instance *transparent_sides =
-      malloc(render_transparent ? SIDES_PER_CHUNK * sizeof(side_instance)
-                                : sizeof(side_instance));
-  side_instance *liquid_sides = malloc(SIDES_PER_CHUNK * sizeof(side_instance));
-  side_instance *foliage_sides =
-      malloc(render_foliage ? SIDES_PER_CHUNK * sizeof(side_instance)
-                            : sizeof(side_instance));
-  float *custom_model_data =
-      malloc(MODEL_VERTICES_PER_CHUNK * sizeof(float) *
-             FLOATS_PER_MODEL_VERT); // 16 floats per model
-  assert(opaque_sides != NULL &&
-         "Failed to allocate memory for opaque packet sides");
-  assert(transparent_sides != NULL &&
-         "Failed to allocate memory for transparent packet sides");
-  assert(liquid_sides != NULL &&
-         "Failed to allocate memory for liquid packet sides");
-  assert(foliage_sides != NULL &&
-         "Failed to allocate memory for foliage packet sides");
-  assert(custom_model_data != NULL &&
-         "Failed to allocate memory for custom model data");
-
-  pack_chunk(c, adj_chunks, lod_scale, &opaque_sides, &opaque_side_count,
-             &transparent_sides, &transparent_side_count, &foliage_sides,
-             &foliage_side_count, &liquid_sides, &liquid_side_count,
-             &custom_model_data, &custom_model_vert_count, render_transparent,
-             render_foliage);
+  // Borders are stitched against the LOD each neighbour is meshed at
+  short adj_lod_scales[4];
+  get_adjacent_lods(x, z, player_x, player_z, adj_lod_scales);
 
-  assert(packet != NULL && "Failed to allocate memory for packet");
+  // Occlusion culling walks these, they only depend on the chunk's own blocks
+  build_section_visibility(c, packet->visibility);
+  init_side_buckets(packet);
+
+  chunk_mesh_key key = {x, z, lod_scale};
 
+  // Reuse the mesh from a previous run if nothing it depends on changed
+  uint64_t cache_key = 0;
+  if (cached) {
+    cache_key = mesh_cache_key(c, adj_chunks, lod_scale, adj_lod_scales,
+                               render_transparent, render_foliage);
+  }
+  if (cached && mesh_cache_load(x, z, lod_scale, cache_key, packet)) {
+    memcpy(packet->adj_lod_scales, adj_lod_scales, sizeof(adj_lod_scales));
+    // Stored in bucket order, unless the layout changed since
+    bucket_sides(packet->opaque_sides, packet->num_opaque_sides,
+                 &packet->buckets[MESH_LAYER_OPAQUE]);
+    bucket_sides(packet->transparent_sides, packet->num_transparent_sides,
+                 &packet->buckets[MESH_LAYER_TRANSPARENT]);
+    bucket_sides(packet->liquid_sides, packet->num_liquid_sides,
+                 &packet->buckets[MESH_LAYER_LIQUID]);
+    bucket_sides(packet->foliage_sides, packet->num_foliage_sides,
+                 &packet->buckets[MESH_LAYER_FOLIAGE]);
+    stamp_chunk_mesh(packet);
+    publish_chunk_mesh(key, packet);
+    return packet;
+  }
+
+  // Pack into this thread's scratch buffers, sized up front from the last
+  // mesh of this chunk at this LOD so packing rarely has to grow them
+  mesh_scratch *scratch = get_mesh_scratch();
+  pthread_mutex_lock(&chunk_packets_mutex);
+  chunk_mesh *previous = chunk_mesh_lod_map_get(&chunk_packets, key);
+  if (previous != NULL) {
+    side_buffer_reserve(&scratch->opaque, previous->num_opaque_sides);
+    side_buffer_reserve(&scratch->transparent, previous->num_transparent_sides);
+    side_buffer_reserve(&scratch->liquid, previous->num_liquid_sides);
+    side_buffer_reserve(&scratch->foliage, previous->num_foliage_sides);
+    model_buffer_reserve(&scratch->models, previous->num_model_instances);
+  }
+  pthread_mutex_unlock(&chunk_packets_mutex);
+
+  int sections = get_mesh_sections(x, z, player_x, player_z, lod_scale, edited);
+  pack_chunk(c, adj_chunks, lod_scale, adj_lod_scales, sections, scratch,
+             render_transparent, render_foliage);
+
+  // Copy out once at the final size
   packet->x = x;
   packet->z = z;
   packet->lod_scale = lod_scale;
-  packet->num_opaque_sides = opaque_side_count;
-  packet->num_transparent_sides = transparent_side_count;
-  packet->num_liquid_sides = liquid_side_count;
-  packet->num_foliage_sides = foliage_side_count;
-  packet->num_custom_verts = custom_model_vert_count;
-
-  packet->opaque_sides = opaque_sides;
-  packet->transparent_sides = transparent_sides;
-  packet->liquid_sides = liquid_sides;
-  packet->foliage_sides = foliage_sides;
-  packet->custom_model_data = custom_model_data;
+  memcpy(packet->adj_lod_scales, adj_lod_scales, sizeof(adj_lod_scales));
+  packet->num_opaque_sides = scratch->opaque.count;
+  packet->num_transparent_sides = scratch->transparent.count;
+  packet->num_liquid_sides = scratch->liquid.count;
+  packet->num_foliage_sides = scratch->foliage.count;
+  packet->num_model_instances = scratch->models.count;
+
+  packet->opaque_sides = side_buffer_copy_bucketed(
+      &scratch->opaque, &packet->buckets[MESH_LAYER_OPAQUE]);
+  packet->transparent_sides = side_buffer_copy_bucketed(
+      &scratch->transparent, &packet->buckets[MESH_LAYER_TRANSPARENT]);
+  packet->liquid_sides = side_buffer_copy_bucketed(
+      &scratch->liquid, &packet->buckets[MESH_LAYER_LIQUID]);
+  packet->foliage_sides = side_buffer_copy_bucketed(
+      &scratch->foliage, &packet->buckets[MESH_LAYER_FOLIAGE]);
+  packet->model_instances = model_buffer_copy(&scratch->models);
+
+  stamp_chunk_mesh(packet);
+  if (cached) {
+    mesh_cache_store(packet, cache_key);
+  }
 
   // Cache by coordinate + LOD for efficient multi-LOD reuse
-  chunk_mesh_key key = {x, z, lod_scale};
-  chunk_mesh_lod_map_insert(&chunk_packets, key, *packet);
+  publish_chunk_mesh(key, packet);
 
   return packet;
 }
 
+// Without the disk cache, this runs under the mesh lock for LOD changes and
+// for chunks the server sent, which always miss
+chunk_mesh *create_chunk_mesh(int x, int z, float player_x, float player_z) {
+  return build_chunk_mesh(x, z, player_x, player_z, 0, 0);
+}
+
+static void remove_chunk_mesh(chunk_mesh_key key) {
+  lock_mesh();
+  pthread_mutex_lock(&chunk_packets_mutex);
+  chunk_mesh *mesh = chunk_mesh_lod_map_get(&chunk_packets, key);
+  if (mesh != NULL) {
+    dedupe_queue_remove(&sort_queue, chunk_work_key(mesh->x, mesh->z));
+    free_chunk_mesh_arrays(mesh);
+    chunk_mesh_lod_map_remove(&chunk_packets, key);
+  }
+  pthread_mutex_unlock(&chunk_packets_mutex);
+  unlock_mesh();
+}
+
 chunk_mesh *update_chunk_mesh_at(int x, int z, float player_x, float player_z) {
   // When LOD changes, we generate a NEW mesh at the new LOD
   // The old LOD mesh stays in cache as a fallback
@@ -946,13 +1749,17 @@ chunk_mesh *update_chunk_mesh_at(int x, int z, float player_x, float player_z) {
   chunk_mesh *existing_new_lod =
       chunk_mesh_lod_map_get(&chunk_packets, new_key);
   if (existing_new_lod != NULL) {
-    // Already have the new LOD, just return it
-    return existing_new_lod;
+    // Already have the new LOD, just return it unless a neighbour changed
+    // LOD since its borders were stitched
+    if (!chunk_mesh_seams_stale(existing_new_lod, player_x, player_z)) {
+      return existing_new_lod;
+    }
   }
 
-  // Generate the new LOD mesh
-  // This will be cached with the new LOD key
-  return create_chunk_mesh(x, z, player_x, player_z);
+  // Generate the new LOD mesh. It replaces a stale one at the same key, so
+  // the old mesh stays drawable until the new one is finished.
+  free(create_chunk_mesh(x, z, player_x, player_z));
+  return chunk_mesh_lod_map_get(&chunk_packets, new_key);
 }
 
 chunk_mesh *update_chunk_mesh(int x, int z, float player_x, float player_z) {
@@ -1015,43 +1822,29 @@ chunk_mesh *get_chunk_mesh(int x, int z) {
   }
 
   // If not found at any LOD, queue for generation
-  chunk_coord *coord = malloc(sizeof(chunk_coord));
-  assert(coord != NULL && "Failed to allocate memory for chunk coord");
-  coord->x = x;
-  coord->z = z;
-
-  queue_push(&chunk_load_queue, coord, chunk_coord_equals);
+  chunk_coord coord = {x, z};
+  dedupe_queue_push(&chunk_load_queue, &coord, NULL);
 
   return NULL;
 }
 
 void invalidate_chunk_mesh_all_lods(int x, int z) {
+  // Regenerate synchronously on this thread, bypassing the worker pool.
+  // The new mesh replaces the one at its LOD in chunk_packets; free the
+  // returned outer struct since the cache owns the data arrays.
+  float player_x, player_z;
+  get_mesh_player_pos(&player_x, &player_z);
+  chunk_mesh *mesh = build_chunk_mesh(x, z, player_x, player_z, 1, 0);
+  short built_lod = mesh->lod_scale;
+  free(mesh);
 
-  // Remove all LOD versions of a chunk from the cache
-  for (short lod = 1; lod <= CHUNK_SIZE; lod *= LOD_SCALING_CONSTANT) {
-    chunk_mesh_key key = {x, z, lod};
-    chunk_mesh *mesh = chunk_mesh_lod_map_get(&chunk_packets, key);
-    queue_remove(&sort_queue, mesh, chunk_mesh_equals);
-    if (mesh != NULL) {
-      if (mesh->opaque_sides != NULL)
-        free(mesh->opaque_sides);
-      if (mesh->transparent_sides != NULL)
-        free(mesh->transparent_sides);
-      if (mesh->liquid_sides != NULL)
-        free(mesh->liquid_sides);
-      if (mesh->foliage_sides != NULL)
-        free(mesh->foliage_sides);
-      if (mesh->custom_model_data != NULL)
-        free(mesh->custom_model_data);
-      chunk_mesh_lod_map_remove(&chunk_packets, key);
+  // The other LOD versions are out of date, drop them
+  for (short lod = 1; lod <= CHUNK_SIZE; lod *= 2) {
+    if (lod != built_lod) {
+      chunk_mesh_key key = {x, z, lod};
+      remove_chunk_mesh(key);
     }
   }
-
-  // Regenerate synchronously on this thread, bypassing the worker pool.
-  // create_chunk_mesh inserts the new entry into chunk_packets by value;
-  // free the returned outer struct since the cache owns the data arrays.
-  chunk_mesh* mesh = create_chunk_mesh(x, z, g_player_x, g_player_z);
-  free(mesh);
 }
 
 void load_chunk(float player_x, float player_z) {
@@ -1059,37 +1852,30 @@ void load_chunk(float player_x, float player_z) {
     return;
   }
 
-  g_player_x = player_x;
-  g_player_z = player_z;
-
-  for (int i = 0; i < CHUNK_LOAD_PER_FRAME; i++) {
-    chunk_coord *coord = (chunk_coord *)queue_pop(&chunk_load_queue);
-    if (coord == NULL) {
-      continue;
-    }
+  set_mesh_player_pos(player_x, player_z);
+  update_work_priorities(player_x, player_z);
 
+  // Hand every missing chunk to the pool, which orders them by priority
+  chunk_coord coord;
+  while (dedupe_queue_pop(&chunk_load_queue, &coord)) {
     // Create work item for the worker pool
     chunk_work_item *work = (chunk_work_item *)malloc(sizeof(chunk_work_item));
     if (work == NULL) {
-      free(coord);
-      continue;
-    }
-
-    work->x = coord->x;
-    work->z = coord->z;
-    work->player_x = player_x;
-    work->player_z = player_z;
-    work->result_mesh = NULL;
-    work->work_complete = 0;
-
-    // Submit work to the worker pool
-    if (pool_submit_work(chunk_worker_pool, work) != 0) {
-      free(work);
-      free(coord);
       continue;
     }
 
-    free(coord);
+    work->x = coord.x;
+    work->z = coord.z;
+
+    // A chunk already queued keeps its entry and this work item is freed
+    pool_run(chunk_worker_pool,
+             &(pool_task){.run = run_chunk_work,
+                          .ctx = work,
+                          .priority = chunk_work_priority,
+                          .validate = chunk_work_valid,
+                          .discard = free,
+                          .has_key = 1,
+                          .key = chunk_work_key(coord.x, coord.z)});
   }
 }
 
@@ -1110,15 +1896,28 @@ void queue_chunk_for_sorting(chunk_mesh *packet, int px, int pz) {
     return;
   }
 
-  queue_push(&sort_queue, packet, chunk_mesh_equals);
+  dedupe_queue_push(&sort_queue, &packet, NULL);
 }
 
-void sort_chunk() {
-  chunk_mesh *packet = (chunk_mesh *)queue_pop(&sort_queue);
-  if (packet == NULL) {
-    return;
+int sort_chunk() {
+  // Held so the mesh is not replaced or removed while it is sorted
+  lock_mesh();
+  chunk_mesh *packet = NULL;
+  if (!dedupe_queue_pop(&sort_queue, &packet)) {
+    unlock_mesh();
+    return 0;
   }
 
-  sort_transparent_sides(packet);
-  sort_liquid_sides(packet);
+  // Transparent faces are order independent with OIT, only liquids need sorting
+  // New versions make the renderer upload the reordered faces
+  if (!ORDER_INDEPENDENT_TRANSPARENCY && packet->num_transparent_sides > 1) {
+    sort_transparent_sides(packet);
+    packet->layer_versions[MESH_LAYER_TRANSPARENT] = next_chunk_mesh_version();
+  }
+  if (packet->num_liquid_sides > 1) {
+    sort_liquid_sides(packet);
+    packet->layer_versions[MESH_LAYER_LIQUID] = next_chunk_mesh_version();
+  }
+  unlock_mesh();
+  return 1;
 }
@@ -7,10 +7,13 @@
 #include <block_models.h>
 #include <game_data.h>
 #include "worker_pool.h"
+#include "mesh_buffer.h"
 #include <pthread.h>
 
-#define SIDES_PER_CHUNK 1000
-#define MODEL_VERTICES_PER_CHUNK 1000
+typedef enum {
+    MESH_KERNELS_SPECIALIZED = 0, // per LOD kernels where one exists
+    MESH_KERNELS_GENERIC          // runtime lod_scale everywhere
+} mesh_kernel_mode;
 
 void m_init(camera* camera);
 void mesh_cleanup();
@@ -19,15 +22,23 @@ chunk_mesh* update_chunk_mesh(int x, int z, float player_x, float player_z);
 chunk_mesh* get_chunk_mesh(int x, int z);
 void invalidate_chunk_mesh_all_lods(int x, int z);
 void queue_chunk_for_sorting(chunk_mesh* packet, int px, int py);
-void sort_chunk();
+// Sort one queued chunk, returns 0 once the queue is empty
+int sort_chunk();
 void load_chunk(float player_x, float player_z);
 void wait_chunk_loading(void);
 block_data_t get_block_data(int x, int y, int z, chunk* c);
 short calculate_lod(int x, int z, float player_x, float player_z);
+// True once a neighbour's LOD differs from the one the mesh was stitched to
+int chunk_mesh_seams_stale(chunk_mesh* mesh, float player_x, float player_z);
 int is_chunk_in_foliage_distance(int chunk_x, int chunk_z, float player_x, float player_z);
 int is_chunk_in_transparent_distance(int chunk_x, int chunk_z, float player_x, float player_z);
-void process_chunk_work_item(chunk_work_item* work);
 chunk_mesh* create_chunk_mesh(int x, int z, float player_x, float player_z);
+void pack_chunk(chunk* c, chunk* adj_chunks[4], short lod_scale, const short adj_lod_scales[4],
+                int sections, mesh_scratch* out, int render_transparent, int render_foliage);
+void set_mesh_kernel_mode(mesh_kernel_mode mode);
 void get_mesh_player_pos(float* out_x, float* out_z);
+worker_pool* get_mesh_worker_pool(void);
+// Add or retire chunk workers at runtime, returns the new worker count
+int adjust_mesh_worker_threads(int delta);
 
 #endif
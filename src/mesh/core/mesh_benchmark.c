@@ -0,0 +1,103 @@
+#include "mesh_benchmark.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../../world/core/chunk.h"
+#include "../../world/core/chunk_lod.h"
+#include "mesh.h"
+#include "mesh_buffer.h"
+
+#define MESH_BENCHMARK_ITERATIONS 20
+#define MESH_BENCHMARK_CHUNK_X 3
+#define MESH_BENCHMARK_CHUNK_Z -2
+
+static double bench_now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+static chunk *generate_bench_chunk(int x, int z) {
+  chunk *c = malloc(sizeof(chunk));
+  if (c == NULL) {
+    return NULL;
+  }
+  chunk_create(c, x, z);
+  build_chunk_lod(c);
+  return c;
+}
+
+static int count_faces(mesh_scratch *scratch) {
+  return scratch->opaque.count + scratch->transparent.count +
+         scratch->liquid.count + scratch->foliage.count +
+         scratch->models.count;
+}
+
+// Best of several runs, faces_out gets the face count of the last run
+static double time_kernels(mesh_kernel_mode mode, chunk *c,
+                           chunk *adj_chunks[4], short lod_scale,
+                           int *faces_out) {
+  short adj_lod_scales[4] = {lod_scale, lod_scale, lod_scale, lod_scale};
+  set_mesh_kernel_mode(mode);
+
+  double best = -1.0;
+  for (int i = 0; i < MESH_BENCHMARK_ITERATIONS; i++) {
+    mesh_scratch *scratch = get_mesh_scratch();
+    double start = bench_now_ms();
+    pack_chunk(c, adj_chunks, lod_scale, adj_lod_scales, 1, scratch, 1, 1);
+    double elapsed = bench_now_ms() - start;
+
+    *faces_out = count_faces(scratch);
+    if (best < 0.0 || elapsed < best) {
+      best = elapsed;
+    }
+  }
+
+  set_mesh_kernel_mode(MESH_KERNELS_SPECIALIZED);
+  return best;
+}
+
+void run_mesh_benchmark(void) {
+  int x = MESH_BENCHMARK_CHUNK_X;
+  int z = MESH_BENCHMARK_CHUNK_Z;
+  chunk *c = generate_bench_chunk(x, z);
+  chunk *adj_chunks[4] = {
+      generate_bench_chunk(x, z - 1), generate_bench_chunk(x + 1, z),
+      generate_bench_chunk(x, z + 1), generate_bench_chunk(x - 1, z)};
+
+  if (c == NULL || adj_chunks[0] == NULL || adj_chunks[1] == NULL ||
+      adj_chunks[2] == NULL || adj_chunks[3] == NULL) {
+    printf("[benchmark] ERROR: failed to allocate chunks\n");
+    return;
+  }
+
+  printf("[benchmark] mesh one chunk, best of %d runs\n",
+         MESH_BENCHMARK_ITERATIONS);
+  printf("[benchmark]   %-4s %8s %12s %12s %8s\n", "lod", "faces", "generic",
+         "specialized", "speedup");
+
+  for (short lod_scale = 1; lod_scale <= CHUNK_LOD_MAX_SCALE; lod_scale *= 2) {
+    int generic_faces = 0;
+    int specialized_faces = 0;
+    double generic_ms = time_kernels(MESH_KERNELS_GENERIC, c, adj_chunks,
+                                     lod_scale, &generic_faces);
+    double specialized_ms = time_kernels(MESH_KERNELS_SPECIALIZED, c,
+                                         adj_chunks, lod_scale,
+                                         &specialized_faces);
+
+    if (generic_faces != specialized_faces) {
+      printf("[benchmark] ERROR: lod %d kernels disagree, %d vs %d faces\n",
+             lod_scale, generic_faces, specialized_faces);
+    }
+    printf("[benchmark]   %-4d %8d %9.3f ms %9.3f ms %7.2fx\n", lod_scale,
+           specialized_faces, generic_ms, specialized_ms,
+           specialized_ms > 0.0 ? generic_ms / specialized_ms : 0.0);
+  }
+
+  free(c);
+  for (int i = 0; i < 4; i++) {
+    free(adj_chunks[i]);
+  }
+}
@@ -0,0 +1,8 @@
+#ifndef MESH_BENCHMARK_H
+#define MESH_BENCHMARK_H
+
+// Time meshing a generated chunk at every LOD with the generic kernels and
+// with the per LOD kernels. Run with --benchmark-mesh.
+void run_mesh_benchmark(void);
+
+#endif
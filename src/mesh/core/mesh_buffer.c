@@ -0,0 +1,230 @@
+#include "mesh_buffer.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+static pthread_key_t mesh_scratch_key;
+static pthread_once_t mesh_scratch_key_once = PTHREAD_ONCE_INIT;
+
+typedef struct {
+  mesh_scratch *sections[MESH_MAX_SECTIONS];
+} mesh_section_scratch;
+
+static pthread_key_t mesh_section_scratch_key;
+static pthread_once_t mesh_section_scratch_key_once = PTHREAD_ONCE_INIT;
+
+static void free_mesh_scratch(void *ptr) {
+  mesh_scratch *scratch = (mesh_scratch *)ptr;
+  if (scratch == NULL) {
+    return;
+  }
+
+  free(scratch->opaque.sides);
+  free(scratch->transparent.sides);
+  free(scratch->liquid.sides);
+  free(scratch->foliage.sides);
+  free(scratch->models.instances);
+  free(scratch);
+}
+
+static void init_mesh_scratch_key(void) {
+  pthread_key_create(&mesh_scratch_key, free_mesh_scratch);
+}
+
+static mesh_scratch *new_mesh_scratch(void) {
+  mesh_scratch *scratch = calloc(1, sizeof(mesh_scratch));
+  assert(scratch != NULL && "Failed to allocate mesh scratch");
+
+  side_buffer_reserve(&scratch->opaque, MESH_SCRATCH_INITIAL_SIDES);
+  side_buffer_reserve(&scratch->transparent, MESH_SCRATCH_INITIAL_SIDES);
+  side_buffer_reserve(&scratch->liquid, MESH_SCRATCH_INITIAL_SIDES);
+  side_buffer_reserve(&scratch->foliage, MESH_SCRATCH_INITIAL_SIDES);
+  model_buffer_reserve(&scratch->models, MESH_SCRATCH_INITIAL_MODEL_INSTANCES);
+  return scratch;
+}
+
+static void reset_mesh_scratch(mesh_scratch *scratch) {
+  scratch->opaque.count = 0;
+  scratch->transparent.count = 0;
+  scratch->liquid.count = 0;
+  scratch->foliage.count = 0;
+  scratch->models.count = 0;
+}
+
+mesh_scratch *get_mesh_scratch(void) {
+  pthread_once(&mesh_scratch_key_once, init_mesh_scratch_key);
+
+  mesh_scratch *scratch = (mesh_scratch *)pthread_getspecific(mesh_scratch_key);
+  if (scratch == NULL) {
+    scratch = new_mesh_scratch();
+    pthread_setspecific(mesh_scratch_key, scratch);
+  }
+
+  reset_mesh_scratch(scratch);
+  return scratch;
+}
+
+static void free_mesh_section_scratch(void *ptr) {
+  mesh_section_scratch *scratch = (mesh_section_scratch *)ptr;
+  if (scratch == NULL) {
+    return;
+  }
+
+  for (int i = 0; i < MESH_MAX_SECTIONS; i++) {
+    free_mesh_scratch(scratch->sections[i]);
+  }
+  free(scratch);
+}
+
+static void init_mesh_section_scratch_key(void) {
+  pthread_key_create(&mesh_section_scratch_key, free_mesh_section_scratch);
+}
+
+mesh_scratch *get_mesh_section_scratch(int section) {
+  assert(section >= 0 && section < MESH_MAX_SECTIONS &&
+         "Mesh section out of range");
+  pthread_once(&mesh_section_scratch_key_once, init_mesh_section_scratch_key);
+
+  mesh_section_scratch *scratch =
+      (mesh_section_scratch *)pthread_getspecific(mesh_section_scratch_key);
+  if (scratch == NULL) {
+    scratch = calloc(1, sizeof(mesh_section_scratch));
+    assert(scratch != NULL && "Failed to allocate mesh section scratch");
+    pthread_setspecific(mesh_section_scratch_key, scratch);
+  }
+
+  if (scratch->sections[section] == NULL) {
+    scratch->sections[section] = new_mesh_scratch();
+  }
+
+  reset_mesh_scratch(scratch->sections[section]);
+  return scratch->sections[section];
+}
+
+static int grow_capacity(int capacity, int count) {
+  int new_capacity = capacity > 0 ? capacity : 1;
+  while (new_capacity < count) {
+    new_capacity *= 2;
+  }
+  return new_capacity;
+}
+
+void side_buffer_reserve(side_buffer *buffer, int count) {
+  if (count <= buffer->capacity) {
+    return;
+  }
+
+  int capacity = grow_capacity(buffer->capacity, count);
+  side_instance *tmp = realloc(buffer->sides, capacity * sizeof(side_instance));
+  assert(tmp != NULL && "Failed to allocate memory for side data");
+  buffer->sides = tmp;
+  buffer->capacity = capacity;
+}
+
+side_instance *side_buffer_push(side_buffer *buffer) {
+  side_buffer_reserve(buffer, buffer->count + 1);
+  return &buffer->sides[buffer->count++];
+}
+
+side_instance *side_buffer_copy(side_buffer *buffer) {
+  // always allocate at least one element so callers get a valid pointer
+  int count = buffer->count > 0 ? buffer->count : 1;
+  side_instance *out = malloc(count * sizeof(side_instance));
+  assert(out != NULL && "Failed to allocate memory for packet sides");
+  memcpy(out, buffer->sides, buffer->count * sizeof(side_instance));
+  return out;
+}
+
+static int get_side_bucket(const side_instance *side,
+                           const side_buckets *buckets) {
+  int direction = buckets->directions > 1 ? side->side : 0;
+  int section = 0;
+  if (buckets->sections > 1) {
+    section = side->y / VISIBILITY_SECTION_HEIGHT;
+    section = section < 0 ? 0
+              : section >= VISIBILITY_SECTIONS ? VISIBILITY_SECTIONS - 1
+                                               : section;
+  }
+  return direction * buckets->sections + section;
+}
+
+// Counts of each bucket turned into starts, returns 1 if the sides are
+// already in bucket order
+static int count_side_buckets(const side_instance *sides, int count,
+                              side_buckets *buckets) {
+  int num_buckets = buckets->directions * buckets->sections;
+  memset(buckets->starts, 0, sizeof(buckets->starts));
+  int ordered = 1;
+  int previous = 0;
+  for (int i = 0; i < count; i++) {
+    int bucket = get_side_bucket(&sides[i], buckets);
+    ordered &= bucket >= previous;
+    previous = bucket;
+    buckets->starts[bucket + 1]++;
+  }
+  for (int b = 0; b < num_buckets; b++) {
+    buckets->starts[b + 1] += buckets->starts[b];
+  }
+  return ordered;
+}
+
+static void scatter_sides(const side_instance *sides, int count,
+                          const side_buckets *buckets, side_instance *out) {
+  int next[MAX_SIDE_BUCKETS];
+  memcpy(next, buckets->starts, sizeof(next));
+  for (int i = 0; i < count; i++) {
+    out[next[get_side_bucket(&sides[i], buckets)]++] = sides[i];
+  }
+}
+
+side_instance *side_buffer_copy_bucketed(side_buffer *buffer,
+                                         side_buckets *buckets) {
+  if (count_side_buckets(buffer->sides, buffer->count, buckets)) {
+    return side_buffer_copy(buffer);
+  }
+
+  side_instance *out = malloc(buffer->count * sizeof(side_instance));
+  assert(out != NULL && "Failed to allocate memory for packet sides");
+  scatter_sides(buffer->sides, buffer->count, buckets, out);
+  return out;
+}
+
+void bucket_sides(side_instance *sides, int count, side_buckets *buckets) {
+  if (count_side_buckets(sides, count, buckets)) {
+    return;
+  }
+
+  side_instance *sorted = malloc(count * sizeof(side_instance));
+  assert(sorted != NULL && "Failed to allocate memory for bucketed sides");
+  scatter_sides(sides, count, buckets, sorted);
+  memcpy(sides, sorted, count * sizeof(side_instance));
+  free(sorted);
+}
+
+void model_buffer_reserve(model_buffer *buffer, int count) {
+  if (count <= buffer->capacity) {
+    return;
+  }
+
+  int capacity = grow_capacity(buffer->capacity, count);
+  model_instance *tmp =
+      realloc(buffer->instances, capacity * sizeof(model_instance));
+  assert(tmp != NULL && "Failed to allocate memory for model instances");
+  buffer->instances = tmp;
+  buffer->capacity = capacity;
+}
+
+model_instance *model_buffer_push(model_buffer *buffer) {
+  model_buffer_reserve(buffer, buffer->count + 1);
+  return &buffer->instances[buffer->count++];
+}
+
+model_instance *model_buffer_copy(model_buffer *buffer) {
+  int count = buffer->count > 0 ? buffer->count : 1;
+  model_instance *out = malloc(count * sizeof(model_instance));
+  assert(out != NULL && "Failed to allocate memory for model instances");
+  memcpy(out, buffer->instances, buffer->count * sizeof(model_instance));
+  return out;
+}
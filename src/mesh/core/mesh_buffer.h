@@ -0,0 +1,68 @@
+#ifndef MESH_BUFFER_H
+#define MESH_BUFFER_H
+
+#include <game_data.h>
+#include "../effects/ambient_occlusion.h"
+
+// Initial scratch capacity, buffers double in size whenever they fill up
+#define MESH_SCRATCH_INITIAL_SIDES 1024
+#define MESH_SCRATCH_INITIAL_MODEL_INSTANCES 64
+
+// Most vertical sections a single chunk is split into
+#define MESH_MAX_SECTIONS 16
+
+// Growable array of side instances
+typedef struct {
+  side_instance *sides;
+  int count;
+  int capacity;
+} side_buffer;
+
+// Growable array of custom model instances
+typedef struct {
+  model_instance *instances;
+  int count;
+  int capacity;
+} model_buffer;
+
+// Scratch space a chunk mesh is packed into. Each thread that builds meshes
+// owns one, and it is reused across chunks so packing never touches the
+// allocator once the buffers have grown to fit.
+typedef struct {
+  side_buffer opaque;
+  side_buffer transparent;
+  side_buffer liquid;
+  side_buffer foliage;
+  model_buffer models;
+  ao_grid ao;
+} mesh_scratch;
+
+// Returns the calling thread's scratch, emptied and ready for a new chunk
+mesh_scratch *get_mesh_scratch(void);
+
+// Returns the calling thread's scratch for one section of a chunk split
+// across workers, emptied. Only the side and model buffers are used.
+mesh_scratch *get_mesh_section_scratch(int section);
+
+void side_buffer_reserve(side_buffer *buffer, int count);
+side_instance *side_buffer_push(side_buffer *buffer);
+
+// Copy the packed sides into a new allocation sized to fit
+side_instance *side_buffer_copy(side_buffer *buffer);
+
+// Copy the packed sides sized to fit and grouped by the layout set in
+// buckets, filling in its starts
+side_instance *side_buffer_copy_bucketed(side_buffer *buffer,
+                                         side_buckets *buckets);
+
+// Group sides in place by the layout set in buckets and fill in its starts,
+// only moving them if they are not grouped already
+void bucket_sides(side_instance *sides, int count, side_buckets *buckets);
+
+void model_buffer_reserve(model_buffer *buffer, int count);
+model_instance *model_buffer_push(model_buffer *buffer);
+
+// Copy the packed instances into a new allocation sized to fit
+model_instance *model_buffer_copy(model_buffer *buffer);
+
+#endif
@@ -0,0 +1,470 @@
+#include "mesh_cache.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../../util/settings.h"
+
+#define MESH_CACHE_MAGIC 0x4843434Du // "MCCH"
+#define MESH_CACHE_PATH_SIZE 512
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t key;
+  int32_t x, z;
+  int32_t lod_scale;
+  int32_t num_opaque_sides;
+  int32_t num_transparent_sides;
+  int32_t num_liquid_sides;
+  int32_t num_foliage_sides;
+  int32_t num_model_instances;
+} mesh_cache_header;
+
+static int mesh_cache_ready = 0;
+static unsigned int mesh_cache_tmp_counter = 0;
+
+// Hash of the loaded block definitions, part of every key since atlas
+// coordinates and culling decisions are baked into the stored faces
+static uint64_t mesh_cache_block_hash = 0;
+
+// Bytes of cache files on disk, kept up to date by stores and evictions
+static int64_t mesh_cache_bytes = 0;
+static int mesh_cache_evicting = 0;
+
+typedef struct {
+  char name[256];
+  struct timespec mtime;
+  off_t size;
+} mesh_cache_entry;
+
+// Create every missing directory along path
+static int make_directories(const char *path) {
+  char buffer[MESH_CACHE_PATH_SIZE];
+  snprintf(buffer, sizeof(buffer), "%s", path);
+
+  for (char *p = buffer + 1; *p; p++) {
+    if (*p != '/') {
+      continue;
+    }
+    *p = '\0';
+    if (mkdir(buffer, 0755) == -1 && errno != EEXIST) {
+      return -1;
+    }
+    *p = '/';
+  }
+
+  if (mkdir(buffer, 0755) == -1 && errno != EEXIST) {
+    return -1;
+  }
+  return 0;
+}
+
+static inline uint64_t mix_word(uint64_t h, uint64_t w) {
+  h ^= w * 0x9E3779B97F4A7C15ull;
+  h = (h << 31) | (h >> 33);
+  return h * 0xBF58476D1CE4E5B9ull;
+}
+
+static uint64_t hash_bytes(uint64_t h, const void *data, size_t size) {
+  const unsigned char *bytes = (const unsigned char *)data;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t w;
+    memcpy(&w, bytes + i, sizeof(w));
+    h = mix_word(h, w);
+  }
+
+  uint64_t tail = 0;
+  for (; i < size; i++) {
+    tail = (tail << 8) | bytes[i];
+  }
+  return mix_word(h, tail ^ size);
+}
+
+static uint64_t hash_string(uint64_t h, const char *s) {
+  return s != NULL ? hash_bytes(h, s, strlen(s)) : mix_word(h, 0);
+}
+
+static uint64_t hash_block_types(void) {
+  uint64_t h = (uint64_t)BLOCK_COUNT;
+  for (int i = 0; i < BLOCK_COUNT; i++) {
+    block_type *type = &TYPES[i];
+    h = mix_word(h, type->id);
+    h = mix_word(h, (uint64_t)(type->transparent ? 1 : 0) |
+                        ((uint64_t)(type->liquid ? 1 : 0) << 1) |
+                        ((uint64_t)(type->is_foliage ? 1 : 0) << 2) |
+                        ((uint64_t)(type->is_custom_model ? 1 : 0) << 3) |
+                        ((uint64_t)(type->oriented ? 1 : 0) << 4));
+    h = hash_bytes(h, type->face_atlas_coords, sizeof(type->face_atlas_coords));
+    h = hash_string(h, type->name);
+    h = hash_string(h, type->model);
+    for (int side = 0; side < 6; side++) {
+      h = hash_string(h, type->models[side]);
+    }
+  }
+  return h;
+}
+
+static int64_t mesh_cache_limit(void) {
+  return (int64_t)MESH_CACHE_MAX_MB * 1024 * 1024;
+}
+
+static int is_mesh_cache_file(const char *name) {
+  size_t len = strlen(name);
+  return strncmp(name, "mesh_", 5) == 0 && len > 4 &&
+         strcmp(name + len - 4, ".bin") == 0;
+}
+
+static void get_entry_path(char *out, size_t size, const char *name) {
+  size_t dir_len = strlen(MESH_CACHE_DIR);
+  const char *separator = MESH_CACHE_DIR[dir_len - 1] == '/' ? "" : "/";
+  snprintf(out, size, "%s%s%s", MESH_CACHE_DIR, separator, name);
+}
+
+// List the cache files, returns how many there are or -1 on failure
+static int list_mesh_cache(mesh_cache_entry **out) {
+  DIR *dir = opendir(MESH_CACHE_DIR);
+  if (dir == NULL) {
+    return -1;
+  }
+
+  int count = 0;
+  int capacity = 256;
+  mesh_cache_entry *entries = malloc(capacity * sizeof(mesh_cache_entry));
+  if (entries == NULL) {
+    closedir(dir);
+    return -1;
+  }
+
+  struct dirent *ent;
+  while ((ent = readdir(dir)) != NULL) {
+    if (!is_mesh_cache_file(ent->d_name) ||
+        strlen(ent->d_name) >= sizeof(entries->name)) {
+      continue;
+    }
+
+    char path[MESH_CACHE_PATH_SIZE];
+    get_entry_path(path, sizeof(path), ent->d_name);
+    struct stat st;
+    if (stat(path, &st) == -1) {
+      continue;
+    }
+
+    if (count == capacity) {
+      capacity *= 2;
+      mesh_cache_entry *grown =
+          realloc(entries, capacity * sizeof(mesh_cache_entry));
+      if (grown == NULL) {
+        break;
+      }
+      entries = grown;
+    }
+    snprintf(entries[count].name, sizeof(entries[count].name), "%s",
+             ent->d_name);
+    entries[count].mtime = st.st_mtim;
+    entries[count].size = st.st_size;
+    count++;
+  }
+
+  closedir(dir);
+  *out = entries;
+  return count;
+}
+
+static int compare_entry_age(const void *a, const void *b) {
+  const mesh_cache_entry *ea = a;
+  const mesh_cache_entry *eb = b;
+  if (ea->mtime.tv_sec != eb->mtime.tv_sec) {
+    return ea->mtime.tv_sec < eb->mtime.tv_sec ? -1 : 1;
+  }
+  return (ea->mtime.tv_nsec > eb->mtime.tv_nsec) -
+         (ea->mtime.tv_nsec < eb->mtime.tv_nsec);
+}
+
+// Delete the least recently used files until the cache is back under three
+// quarters of its limit, so the next few stores do not evict again. Loads
+// touch the files they hit, so mtime is the last use.
+static void evict_mesh_cache(void) {
+  if (__atomic_exchange_n(&mesh_cache_evicting, 1, __ATOMIC_ACQUIRE)) {
+    return;
+  }
+
+  mesh_cache_entry *entries;
+  int count = list_mesh_cache(&entries);
+  if (count >= 0) {
+    int64_t total = 0;
+    for (int i = 0; i < count; i++) {
+      total += entries[i].size;
+    }
+
+    qsort(entries, count, sizeof(mesh_cache_entry), compare_entry_age);
+    int64_t target = mesh_cache_limit() / 4 * 3;
+    for (int i = 0; i < count && total > target; i++) {
+      char path[MESH_CACHE_PATH_SIZE];
+      get_entry_path(path, sizeof(path), entries[i].name);
+      if (unlink(path) == 0) {
+        total -= entries[i].size;
+      }
+    }
+
+    // Stores that finished during the scan may be counted twice or not at
+    // all, the next eviction corrects it
+    __atomic_store_n(&mesh_cache_bytes, total, __ATOMIC_RELAXED);
+    free(entries);
+  }
+
+  __atomic_store_n(&mesh_cache_evicting, 0, __ATOMIC_RELEASE);
+}
+
+void init_mesh_cache(void) {
+  mesh_cache_ready = 0;
+  if (!MESH_CACHE || MESH_CACHE_DIR == NULL || MESH_CACHE_DIR[0] == '\0') {
+    return;
+  }
+
+  if (make_directories(MESH_CACHE_DIR) == -1) {
+    fprintf(stderr, "ERROR: Failed to create mesh cache directory %s\n",
+            MESH_CACHE_DIR);
+    return;
+  }
+  mesh_cache_block_hash = hash_block_types();
+
+  // Count what earlier runs left behind, trimming it if the limit shrank
+  mesh_cache_entry *entries;
+  int count = list_mesh_cache(&entries);
+  int64_t total = 0;
+  for (int i = 0; i < count; i++) {
+    total += entries[i].size;
+  }
+  if (count >= 0) {
+    free(entries);
+  }
+  __atomic_store_n(&mesh_cache_bytes, total, __ATOMIC_RELAXED);
+  if (total > mesh_cache_limit()) {
+    evict_mesh_cache();
+  }
+
+  mesh_cache_ready = 1;
+}
+
+static void get_mesh_cache_path(char *out, size_t size, int x, int z,
+                                short lod_scale) {
+  size_t dir_len = strlen(MESH_CACHE_DIR);
+  const char *separator = MESH_CACHE_DIR[dir_len - 1] == '/' ? "" : "/";
+  snprintf(out, size, "%s%smesh_%d_%d_%d.bin", MESH_CACHE_DIR, separator, x,
+           z, lod_scale);
+}
+
+static uint64_t hash_chunk(uint64_t h, chunk *c) {
+  if (c == NULL) {
+    return mix_word(h, 0xFFFFFFFFFFFFFFFFull);
+  }
+  h = mix_word(h, ((uint64_t)(uint32_t)c->x << 32) | (uint32_t)c->z);
+  return hash_bytes(h, c->blocks, sizeof(c->blocks));
+}
+
+uint64_t mesh_cache_key(chunk *c, chunk *adj_chunks[4], short lod_scale,
+                        const short adj_lod_scales[4], int render_transparent,
+                        int render_foliage) {
+  uint64_t h = MESH_CACHE_VERSION;
+  h = mix_word(h, sizeof(side_instance) | ((uint64_t)sizeof(model_instance) << 16));
+  h = mix_word(h, (uint64_t)lod_scale);
+  h = mix_word(h, (uint64_t)(render_transparent ? 1 : 0) |
+                      ((uint64_t)(render_foliage ? 1 : 0) << 1));
+  h = mix_word(h, mesh_cache_block_hash);
+  for (int i = 0; i < 4; i++) {
+    h = mix_word(h, (uint64_t)(uint16_t)adj_lod_scales[i]);
+  }
+
+  h = hash_chunk(h, c);
+  for (int i = 0; i < 4; i++) {
+    h = hash_chunk(h, adj_chunks[i]);
+  }
+  return h;
+}
+
+// Copy a section of the mapped file into a new allocation. Always allocates
+// at least one element to match meshes built by the packer.
+static void *copy_section(const unsigned char **cursor, int count,
+                          size_t elem_size) {
+  size_t bytes = (size_t)count * elem_size;
+  void *dst = malloc(count > 0 ? bytes : elem_size);
+  if (dst == NULL) {
+    return NULL;
+  }
+  memcpy(dst, *cursor, bytes);
+  *cursor += bytes;
+  return dst;
+}
+
+int mesh_cache_load(int x, int z, short lod_scale, uint64_t key,
+                    chunk_mesh *out) {
+  if (!mesh_cache_ready) {
+    return 0;
+  }
+
+  char path[MESH_CACHE_PATH_SIZE];
+  get_mesh_cache_path(path, sizeof(path), x, z, lod_scale);
+
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    return 0;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(mesh_cache_header)) {
+    close(fd);
+    return 0;
+  }
+
+  size_t size = (size_t)st.st_size;
+  unsigned char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED) {
+    close(fd);
+    return 0;
+  }
+
+  mesh_cache_header header;
+  memcpy(&header, data, sizeof(header));
+
+  size_t expected = sizeof(header) +
+                    ((size_t)header.num_opaque_sides +
+                     header.num_transparent_sides + header.num_liquid_sides +
+                     header.num_foliage_sides) *
+                        sizeof(side_instance) +
+                    (size_t)header.num_model_instances * sizeof(model_instance);
+
+  int hit = header.magic == MESH_CACHE_MAGIC &&
+            header.version == MESH_CACHE_VERSION && header.key == key &&
+            header.x == x && header.z == z && header.lod_scale == lod_scale &&
+            header.num_opaque_sides >= 0 && header.num_transparent_sides >= 0 &&
+            header.num_liquid_sides >= 0 && header.num_foliage_sides >= 0 &&
+            header.num_model_instances >= 0 && expected == size;
+
+  if (hit) {
+    const unsigned char *cursor = data + sizeof(header);
+    out->x = x;
+    out->z = z;
+    out->lod_scale = lod_scale;
+    out->num_opaque_sides = header.num_opaque_sides;
+    out->num_transparent_sides = header.num_transparent_sides;
+    out->num_liquid_sides = header.num_liquid_sides;
+    out->num_foliage_sides = header.num_foliage_sides;
+    out->num_model_instances = header.num_model_instances;
+    out->opaque_sides =
+        copy_section(&cursor, header.num_opaque_sides, sizeof(side_instance));
+    out->transparent_sides = copy_section(
+        &cursor, header.num_transparent_sides, sizeof(side_instance));
+    out->liquid_sides =
+        copy_section(&cursor, header.num_liquid_sides, sizeof(side_instance));
+    out->foliage_sides =
+        copy_section(&cursor, header.num_foliage_sides, sizeof(side_instance));
+    out->model_instances = copy_section(&cursor, header.num_model_instances,
+                                        sizeof(model_instance));
+
+    if (out->opaque_sides == NULL || out->transparent_sides == NULL ||
+        out->liquid_sides == NULL || out->foliage_sides == NULL ||
+        out->model_instances == NULL) {
+      free(out->opaque_sides);
+      free(out->transparent_sides);
+      free(out->liquid_sides);
+      free(out->foliage_sides);
+      free(out->model_instances);
+      hit = 0;
+    }
+  }
+
+  // Mark it used so eviction keeps it
+  if (hit) {
+    futimens(fd, NULL);
+  }
+
+  munmap(data, size);
+  close(fd);
+  return hit;
+}
+
+static int write_section(FILE *file, const void *data, int count,
+                         size_t elem_size) {
+  if (count == 0) {
+    return 1;
+  }
+  return fwrite(data, elem_size, (size_t)count, file) == (size_t)count;
+}
+
+void mesh_cache_store(chunk_mesh *mesh, uint64_t key) {
+  if (!mesh_cache_ready || mesh == NULL) {
+    return;
+  }
+
+  char path[MESH_CACHE_PATH_SIZE];
+  char tmp_path[MESH_CACHE_PATH_SIZE + 32];
+  get_mesh_cache_path(path, sizeof(path), mesh->x, mesh->z, mesh->lod_scale);
+
+  // Write to a private temporary file and rename it into place so readers
+  // never map a partially written mesh
+  unsigned int id = __atomic_fetch_add(&mesh_cache_tmp_counter, 1,
+                                       __ATOMIC_RELAXED);
+  snprintf(tmp_path, sizeof(tmp_path), "%s.%d.%u.tmp", path, (int)getpid(), id);
+
+  FILE *file = fopen(tmp_path, "wb");
+  if (file == NULL) {
+    return;
+  }
+
+  mesh_cache_header header = {
+      .magic = MESH_CACHE_MAGIC,
+      .version = MESH_CACHE_VERSION,
+      .key = key,
+      .x = mesh->x,
+      .z = mesh->z,
+      .lod_scale = mesh->lod_scale,
+      .num_opaque_sides = mesh->num_opaque_sides,
+      .num_transparent_sides = mesh->num_transparent_sides,
+      .num_liquid_sides = mesh->num_liquid_sides,
+      .num_foliage_sides = mesh->num_foliage_sides,
+      .num_model_instances = mesh->num_model_instances,
+  };
+
+  int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+           write_section(file, mesh->opaque_sides, mesh->num_opaque_sides,
+                         sizeof(side_instance)) &&
+           write_section(file, mesh->transparent_sides,
+                         mesh->num_transparent_sides, sizeof(side_instance)) &&
+           write_section(file, mesh->liquid_sides, mesh->num_liquid_sides,
+                         sizeof(side_instance)) &&
+           write_section(file, mesh->foliage_sides, mesh->num_foliage_sides,
+                         sizeof(side_instance)) &&
+           write_section(file, mesh->model_instances,
+                         mesh->num_model_instances, sizeof(model_instance));
+
+  if (fclose(file) != 0) {
+    ok = 0;
+  }
+
+  // Count the file it replaces as freed
+  struct stat old_st;
+  off_t old_size = stat(path, &old_st) == 0 ? old_st.st_size : 0;
+
+  if (!ok || rename(tmp_path, path) == -1) {
+    unlink(tmp_path);
+    return;
+  }
+
+  struct stat st;
+  off_t new_size = stat(path, &st) == 0 ? st.st_size : 0;
+  int64_t total = __atomic_add_fetch(&mesh_cache_bytes,
+                                     (int64_t)(new_size - old_size),
+                                     __ATOMIC_RELAXED);
+  if (total > mesh_cache_limit()) {
+    evict_mesh_cache();
+  }
+}
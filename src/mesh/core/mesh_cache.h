@@ -0,0 +1,31 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <block_models.h>
+#include <game_data.h>
+#include <stdint.h>
+
+// Bump whenever the mesher output changes so stale cache files are ignored
+#define MESH_CACHE_VERSION 2
+
+// On-disk cache of finished chunk meshes, one file per chunk and LOD.
+// A file is only used when its key matches the key of the chunk being
+// meshed, so edits and neighbour changes simply miss and overwrite it.
+// Once the files pass MESH_CACHE_MAX_MB the least recently used are deleted.
+void init_mesh_cache(void);
+
+// Hash of everything a chunk mesh depends on: the chunk and its four
+// neighbours, its LOD and theirs, the render distance flags, the block
+// definitions loaded at init and the mesher version
+uint64_t mesh_cache_key(chunk *c, chunk *adj_chunks[4], short lod_scale,
+                        const short adj_lod_scales[4], int render_transparent,
+                        int render_foliage);
+
+// Fill out from the cache, returns 1 on a hit. The arrays are copied out of
+// the mapped file so out owns them exactly like a freshly packed mesh.
+int mesh_cache_load(int x, int z, short lod_scale, uint64_t key,
+                    chunk_mesh *out);
+
+void mesh_cache_store(chunk_mesh *mesh, uint64_t key);
+
+#endif
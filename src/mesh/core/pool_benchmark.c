@@ -0,0 +1,128 @@
+#include "pool_benchmark.h"
+#include "worker_pool.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define POOL_BENCHMARK_BATCH 255   // fits one worker deque next to its seed
+#define POOL_BENCHMARK_ROUNDS 64
+#define POOL_BENCHMARK_SPIN 2048   // a few microseconds, about one small section
+
+typedef enum {
+    BENCH_JOB_SPIN = 0,
+    BENCH_JOB_FAN_OUT
+} bench_job_kind;
+
+typedef struct {
+    bench_job_kind kind;
+    uint64_t result;
+} bench_job;
+
+static worker_pool* bench_pool = NULL;
+static bench_job bench_jobs[POOL_BENCHMARK_BATCH];
+static bench_job bench_seed;
+
+static double bench_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+// Urgent and unkeyed, the same way mesh sections are submitted
+static void submit_bench_job(bench_job* job);
+
+static void init_bench_job(bench_job* job, bench_job_kind kind) {
+    job->kind = kind;
+    job->result = 0;
+}
+
+static void* run_bench_job(void* ctx) {
+    bench_job* job = (bench_job*)ctx;
+    if (job->kind == BENCH_JOB_FAN_OUT) {
+        for (int i = 0; i < POOL_BENCHMARK_BATCH; i++) {
+            submit_bench_job(&bench_jobs[i]);
+        }
+        return NULL;
+    }
+
+    uint64_t h = (uint64_t)(uintptr_t)job;
+    for (int i = 0; i < POOL_BENCHMARK_SPIN; i++) {
+        h ^= h >> 29;
+        h *= 0xBF58476D1CE4E5B9ull;
+    }
+    job->result = h;
+    return NULL;
+}
+
+static void submit_bench_job(bench_job* job) {
+    pool_run(bench_pool, &(pool_task){.run = run_bench_job, .ctx = job, .urgent = 1});
+}
+
+typedef enum {
+    BENCH_SUBMIT_EXTERNAL = 0, // every job through the shared queue
+    BENCH_SUBMIT_FAN_OUT,      // one job per batch, which pushes the rest to its deque
+    BENCH_SUBMIT_COUNT
+} bench_submit;
+
+// Jobs per millisecond over every round
+static double time_pool(bench_submit submit) {
+    double start = bench_now_ms();
+    for (int round = 0; round < POOL_BENCHMARK_ROUNDS; round++) {
+        for (int i = 0; i < POOL_BENCHMARK_BATCH; i++) {
+            init_bench_job(&bench_jobs[i], BENCH_JOB_SPIN);
+        }
+
+        if (submit == BENCH_SUBMIT_EXTERNAL) {
+            for (int i = 0; i < POOL_BENCHMARK_BATCH; i++) {
+                submit_bench_job(&bench_jobs[i]);
+            }
+        } else {
+            init_bench_job(&bench_seed, BENCH_JOB_FAN_OUT);
+            submit_bench_job(&bench_seed);
+        }
+        pool_wait_completion(bench_pool);
+    }
+    double elapsed = bench_now_ms() - start;
+    return (double)POOL_BENCHMARK_ROUNDS * POOL_BENCHMARK_BATCH / elapsed;
+}
+
+void run_pool_benchmark(void) {
+    const int thread_counts[] = {1, 2, 4, 8, 16, 32};
+    const int num_counts = sizeof(thread_counts) / sizeof(thread_counts[0]);
+
+    printf("[benchmark] worker pool, %d rounds of %d jobs, auto size %d threads\n",
+           POOL_BENCHMARK_ROUNDS, POOL_BENCHMARK_BATCH, pool_auto_thread_count());
+    printf("[benchmark]   %-8s %16s %8s %16s %8s\n", "threads", "external", "speedup", "fan-out", "speedup");
+
+    // One pool resized between rows, the same way the game grows it live
+    bench_pool = pool_init(thread_counts[0]);
+    if (bench_pool == NULL) {
+        printf("[benchmark] ERROR: failed to create worker pool\n");
+        return;
+    }
+
+    double base[BENCH_SUBMIT_COUNT] = {0.0};
+    for (int t = 0; t < num_counts; t++) {
+        if (pool_resize(bench_pool, thread_counts[t]) != thread_counts[t]) {
+            printf("[benchmark] ERROR: failed to resize pool to %d threads\n", thread_counts[t]);
+            break;
+        }
+
+        double rate[BENCH_SUBMIT_COUNT];
+        for (int submit = 0; submit < BENCH_SUBMIT_COUNT; submit++) {
+            rate[submit] = time_pool(submit);
+            if (t == 0) {
+                base[submit] = rate[submit];
+            }
+        }
+        printf("[benchmark]   %-8d %10.0f job/ms %7.2fx %10.0f job/ms %7.2fx\n",
+               thread_counts[t],
+               rate[BENCH_SUBMIT_EXTERNAL], rate[BENCH_SUBMIT_EXTERNAL] / base[BENCH_SUBMIT_EXTERNAL],
+               rate[BENCH_SUBMIT_FAN_OUT], rate[BENCH_SUBMIT_FAN_OUT] / base[BENCH_SUBMIT_FAN_OUT]);
+    }
+
+    pool_shutdown(bench_pool);
+    bench_pool = NULL;
+}
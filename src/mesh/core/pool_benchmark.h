@@ -0,0 +1,9 @@
+#ifndef POOL_BENCHMARK_H
+#define POOL_BENCHMARK_H
+
+// Throughput of the worker pool on small jobs from 1 to 32 threads, both
+// submitted from outside the pool and fanned out by a worker onto its own
+// deque. Run with --benchmark-pool.
+void run_pool_benchmark(void);
+
+#endif
@@ -0,0 +1,141 @@
+#include "section_visibility.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../../world/core/block.h"
+
+#define MAX_BLOCK_IDS 1024
+#define SECTION_CELLS (CHUNK_SIZE * VISIBILITY_SECTION_HEIGHT * CHUNK_SIZE)
+
+static bool occludes[MAX_BLOCK_IDS];
+static pthread_once_t occludes_once = PTHREAD_ONCE_INIT;
+
+// Only full opaque cubes block the view, anything else may be looked through
+static void build_occludes(void) {
+  short air_id = get_block_id("air");
+  for (int i = 0; i < BLOCK_COUNT; i++) {
+    block_type block = TYPES[i];
+    if (block.id >= MAX_BLOCK_IDS || (short)block.id == air_id) {
+      continue;
+    }
+    occludes[block.id] = !block.transparent && !block.liquid &&
+                         !block.is_foliage && !block.is_custom_model;
+  }
+}
+
+static inline int cell_index(int x, int y, int z) {
+  return (y * CHUNK_SIZE + z) * CHUNK_SIZE + x;
+}
+
+// Sides of the section the cell lies on, as a mask of block sides
+static inline int cell_faces(int x, int y, int z) {
+  int faces = 0;
+  if (z == 0) faces |= 1 << (int)NORTH;
+  if (x == CHUNK_SIZE - 1) faces |= 1 << (int)WEST;
+  if (z == CHUNK_SIZE - 1) faces |= 1 << (int)SOUTH;
+  if (x == 0) faces |= 1 << (int)EAST;
+  if (y == VISIBILITY_SECTION_HEIGHT - 1) faces |= 1 << (int)UP;
+  if (y == 0) faces |= 1 << (int)DOWN;
+  return faces;
+}
+
+static section_visibility connect_faces(section_visibility visibility,
+                                        int faces) {
+  for (int a = 0; a < 6; a++) {
+    if (!(faces & (1 << a))) {
+      continue;
+    }
+    for (int b = a + 1; b < 6; b++) {
+      if (faces & (1 << b)) {
+        visibility |= (section_visibility)(1 << section_face_pair_bit(a, b));
+      }
+    }
+  }
+  return visibility;
+}
+
+static section_visibility build_section(chunk *c, int y_min) {
+  uint8_t open[SECTION_CELLS];
+  int num_open = 0;
+  for (int y = 0; y < VISIBILITY_SECTION_HEIGHT; y++) {
+    for (int z = 0; z < CHUNK_SIZE; z++) {
+      for (int x = 0; x < CHUNK_SIZE; x++) {
+        short id = 0;
+        get_block_info(c->blocks[x][y_min + y][z], &id, NULL, NULL, NULL);
+        int is_open = !occludes[id];
+        open[cell_index(x, y, z)] = (uint8_t)is_open;
+        num_open += is_open;
+      }
+    }
+  }
+
+  // Most sections are all air or all stone
+  if (num_open == SECTION_CELLS) {
+    return SECTION_OPEN;
+  }
+  if (num_open == 0) {
+    return SECTION_CLOSED;
+  }
+
+  section_visibility visibility = SECTION_CLOSED;
+  uint16_t stack[SECTION_CELLS];
+  for (int start = 0; start < SECTION_CELLS; start++) {
+    if (!open[start]) {
+      continue;
+    }
+
+    // Visited cells are closed so each is only filled once
+    int faces = 0;
+    int top = 0;
+    stack[top++] = (uint16_t)start;
+    open[start] = 0;
+    while (top > 0) {
+      int cell = stack[--top];
+      int x = cell % CHUNK_SIZE;
+      int z = (cell / CHUNK_SIZE) % CHUNK_SIZE;
+      int y = cell / (CHUNK_SIZE * CHUNK_SIZE);
+      faces |= cell_faces(x, y, z);
+
+      int neighbours[6];
+      int count = 0;
+      if (x > 0) neighbours[count++] = cell - 1;
+      if (x < CHUNK_SIZE - 1) neighbours[count++] = cell + 1;
+      if (z > 0) neighbours[count++] = cell - CHUNK_SIZE;
+      if (z < CHUNK_SIZE - 1) neighbours[count++] = cell + CHUNK_SIZE;
+      if (y > 0) neighbours[count++] = cell - CHUNK_SIZE * CHUNK_SIZE;
+      if (y < VISIBILITY_SECTION_HEIGHT - 1)
+        neighbours[count++] = cell + CHUNK_SIZE * CHUNK_SIZE;
+
+      for (int i = 0; i < count; i++) {
+        if (open[neighbours[i]]) {
+          open[neighbours[i]] = 0;
+          stack[top++] = (uint16_t)neighbours[i];
+        }
+      }
+    }
+
+    visibility = connect_faces(visibility, faces);
+    if (visibility == SECTION_OPEN) {
+      break;
+    }
+  }
+  return visibility;
+}
+
+void build_section_visibility(chunk *c,
+                              section_visibility out[VISIBILITY_SECTIONS]) {
+  if (c == NULL) {
+    for (int s = 0; s < VISIBILITY_SECTIONS; s++) {
+      out[s] = SECTION_OPEN;
+    }
+    return;
+  }
+  pthread_once(&occludes_once, build_occludes);
+
+  for (int s = 0; s < VISIBILITY_SECTIONS; s++) {
+    out[s] = build_section(c, s * VISIBILITY_SECTION_HEIGHT);
+  }
+}
@@ -0,0 +1,12 @@
+#ifndef SECTION_VISIBILITY_H
+#define SECTION_VISIBILITY_H
+
+#include <chunk.h>
+#include <game_data.h>
+
+// Flood fill every section of c through the blocks light passes and record
+// which of its faces those open regions connect. NULL chunks are open.
+void build_section_visibility(chunk *c,
+                              section_visibility out[VISIBILITY_SECTIONS]);
+
+#endif
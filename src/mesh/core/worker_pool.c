@@ -1,86 +1,543 @@
+#ifdef __linux__
+#define _GNU_SOURCE  // sched_getaffinity, pthread_setaffinity_np
+#include <sched.h>
+#endif
+
 #include "worker_pool.h"
-#include "../../util/queue.h"
-#include "../generation/chunk_mesh.h"
+#include "../../util/dedupe_queue.h"
+#include "../../util/thread_event.h"
+#include <float.h>
+#include <stdatomic.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
 #include <unistd.h>
 
+#define POOL_DEQUE_CAPACITY 256  // power of two
+#define POOL_MAX_CPUS 1024
+
+typedef enum {
+    TASK_PENDING = 0,
+    TASK_DONE,
+    TASK_CANCELLED
+} task_state;
+
+typedef struct task_continuation {
+    task_continuation_fn fn;
+    void* ctx;
+    struct task_continuation* next;
+} task_continuation;
+
+// A queued or running task and its result. The pool holds one reference
+// until the task finished, pool_submit hands a second one to the caller.
+struct pool_future {
+    pool_task task;
+    worker_pool* pool;
+    atomic_int refs;
+    int heap_index;  // slot in work_heap, -1 once taken off it
+    
+    pthread_mutex_t mutex;
+    pthread_cond_t done_signal;
+    task_state state;
+    void* result;
+    task_continuation* continuations;
+    task_continuation* last_continuation;
+};
+
+// Chase-Lev deque. Only the owning worker pushes and takes at the bottom,
+// any other worker steals from the top.
+typedef struct {
+    atomic_long top;
+    atomic_long bottom;
+    _Atomic(pool_future*) items[POOL_DEQUE_CAPACITY];
+} work_deque;
+
 typedef struct {
     pthread_t thread_id;
     int worker_id;
-    int is_active;
+    int is_active;     // thread created and not joined yet
+    atomic_int retire; // set by pool_resize, the worker drains its deque and exits
     void* pool_ref;  // Back-reference to pool
+    work_deque deque;
 } worker_thread;
 
+// Queued task. The heap is ordered by priority, then submission order.
+typedef struct {
+    pool_future* task;
+    float priority;
+    int urgent;  // ahead of everything, never reprioritized
+    unsigned long order;
+} pool_entry;
+
 struct worker_pool {
-    worker_thread* threads;
-    int num_threads;
+    worker_thread* threads;     // POOL_MAX_THREADS slots so resizing never moves them
+    atomic_int num_threads;     // slots other workers steal from
+    pthread_mutex_t resize_mutex;
+    
+    // CPUs workers are spread over, none when they are not pinned
+    int worker_cpus[POOL_MAX_CPUS];
+    int num_worker_cpus;
+    int reserved_cpu;           // kept free of workers, -1 when not pinned
     
-    queue_node* work_queue;
-    work_processor_fn process_fn;  // Function to process work items
+    pool_entry* work_heap;
+    int work_count;
+    int work_capacity;
+    unsigned long next_order;
+    key_index queued_keys;  // key of every keyed task on the heap -> its future
     
     pthread_mutex_t work_queue_mutex;
     pthread_cond_t work_available_signal;
     
-    int shutdown_flag;
-    int pending_work_count;
+    atomic_int deque_items;     // tasks across all worker deques
+    atomic_int sleeping_count;  // workers waiting on work_available_signal
+    
+    atomic_int shutdown_flag;
+    atomic_int pending_work_count;
     pthread_mutex_t pending_work_mutex;
     pthread_cond_t all_work_done_signal;
+    
+    atomic_ulong submitted_count;
+    atomic_ulong merged_count;
+    atomic_ulong completed_count;
+    atomic_ulong cancelled_count;
+    
+    thread_usage usage;  // shared by every worker
 };
 
+// Worker running on the calling thread, NULL for threads outside any pool
+static _Thread_local worker_thread* current_worker = NULL;
+
+static int entry_before(pool_entry* a, pool_entry* b) {
+    if (a->urgent != b->urgent) {
+        return a->urgent;
+    }
+    if (a->priority != b->priority) {
+        return a->priority < b->priority;
+    }
+    return a->order < b->order;
+}
+
+static void set_entry(worker_pool* pool, int index, pool_entry entry) {
+    pool->work_heap[index] = entry;
+    entry.task->heap_index = index;
+}
+
+static void swap_entries(worker_pool* pool, int a, int b) {
+    pool_entry tmp = pool->work_heap[a];
+    set_entry(pool, a, pool->work_heap[b]);
+    set_entry(pool, b, tmp);
+}
+
+static void sift_up(worker_pool* pool, int index) {
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (!entry_before(&pool->work_heap[index], &pool->work_heap[parent])) {
+            break;
+        }
+        swap_entries(pool, index, parent);
+        index = parent;
+    }
+}
+
+static void sift_down(worker_pool* pool, int index) {
+    for (;;) {
+        int left = 2 * index + 1;
+        int right = left + 1;
+        int first = index;
+        if (left < pool->work_count && entry_before(&pool->work_heap[left], &pool->work_heap[first])) {
+            first = left;
+        }
+        if (right < pool->work_count && entry_before(&pool->work_heap[right], &pool->work_heap[first])) {
+            first = right;
+        }
+        if (first == index) {
+            break;
+        }
+        swap_entries(pool, index, first);
+        index = first;
+    }
+}
+
+// Forget a keyed task leaving the heap, caller holds the queue lock
+static void unindex_task(worker_pool* pool, pool_future* task) {
+    if (task->task.has_key) {
+        key_index_remove(&pool->queued_keys, task->task.key);
+    }
+}
+
+static void remove_entry(worker_pool* pool, int index) {
+    unindex_task(pool, pool->work_heap[index].task);
+    pool->work_heap[index].task->heap_index = -1;
+    pool->work_count--;
+    if (index == pool->work_count) {
+        return;
+    }
+    set_entry(pool, index, pool->work_heap[pool->work_count]);
+    sift_up(pool, index);
+    sift_down(pool, index);
+}
+
+static int find_key(worker_pool* pool, uint64_t key) {
+    uint64_t found;
+    if (!key_index_get(&pool->queued_keys, key, &found)) {
+        return -1;
+    }
+    return ((pool_future*)(uintptr_t)found)->heap_index;
+}
+
+static float get_priority(pool_future* task) {
+    return task->task.priority != NULL ? task->task.priority(task->task.ctx) : 0.0f;
+}
+
+// Queue a task, caller holds the queue lock
+static void push_entry(worker_pool* pool, pool_future* task) {
+    if (pool->work_count == pool->work_capacity) {
+        int capacity = pool->work_capacity > 0 ? pool->work_capacity * 2 : 64;
+        pool_entry* heap = realloc(pool->work_heap, capacity * sizeof(pool_entry));
+        assert(heap != NULL && "Failed to grow worker pool queue");
+        pool->work_heap = heap;
+        pool->work_capacity = capacity;
+    }
+
+    pool_entry entry = {
+        .task = task,
+        .priority = task->task.urgent ? -FLT_MAX : get_priority(task),
+        .urgent = task->task.urgent,
+        .order = pool->next_order++
+    };
+    set_entry(pool, pool->work_count++, entry);
+    sift_up(pool, pool->work_count - 1);
+    if (task->task.has_key) {
+        key_index_put(&pool->queued_keys, task->task.key, (uint64_t)(uintptr_t)task);
+    }
+}
+
+// Fold a new submission into an equal queued task, which takes the more
+// urgent of the two priorities. Caller holds the queue lock.
+static void merge_entry(worker_pool* pool, int index, const pool_task* task) {
+    pool_entry* entry = &pool->work_heap[index];
+    float priority = task->urgent ? -FLT_MAX
+        : (task->priority != NULL ? task->priority(task->ctx) : 0.0f);
+    entry->urgent = entry->urgent || task->urgent;
+    entry->task->task.urgent = entry->urgent;
+    entry->priority = priority < entry->priority ? priority : entry->priority;
+    sift_up(pool, index);
+}
+
+static int deque_push(work_deque* deque, pool_future* task) {
+    long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    if (b - t >= POOL_DEQUE_CAPACITY) {
+        return 0;
+    }
+    atomic_store_explicit(&deque->items[b & (POOL_DEQUE_CAPACITY - 1)], task, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+    return 1;
+}
+
+static pool_future* deque_take(work_deque* deque) {
+    long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&deque->top, memory_order_relaxed);
+    
+    if (t > b) {
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+        return NULL;
+    }
+    
+    pool_future* task = atomic_load_explicit(&deque->items[b & (POOL_DEQUE_CAPACITY - 1)], memory_order_relaxed);
+    if (t == b) {
+        // Last item, race any thief for it
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1,
+                memory_order_seq_cst, memory_order_relaxed)) {
+            task = NULL;
+        }
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+static pool_future* deque_steal(work_deque* deque) {
+    long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (t >= b) {
+        return NULL;
+    }
+    
+    pool_future* task = atomic_load_explicit(&deque->items[t & (POOL_DEQUE_CAPACITY - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1,
+            memory_order_seq_cst, memory_order_relaxed)) {
+        return NULL;
+    }
+    return task;
+}
+
+static pool_future* steal_work(worker_pool* pool, worker_thread* self) {
+    int num_threads = atomic_load(&pool->num_threads);
+    for (int i = 1; i <= num_threads; i++) {
+        worker_thread* victim = &pool->threads[(self->worker_id + i) % num_threads];
+        if (victim == self) {
+            continue;
+        }
+        pool_future* task = deque_steal(&victim->deque);
+        if (task != NULL) {
+            return task;
+        }
+    }
+    return NULL;
+}
+
+// Wake one sleeping worker. Pairs with the sleeping_count check in
+// worker_thread_main so the lock is only taken when someone is asleep.
+static void wake_worker(worker_pool* pool) {
+    if (atomic_load(&pool->sleeping_count) == 0) {
+        return;
+    }
+    pthread_mutex_lock(&pool->work_queue_mutex);
+    pthread_cond_signal(&pool->work_available_signal);
+    pthread_mutex_unlock(&pool->work_queue_mutex);
+}
+
+static void finish_work(worker_pool* pool) {
+    if (atomic_fetch_sub(&pool->pending_work_count, 1) == 1) {
+        pthread_mutex_lock(&pool->pending_work_mutex);
+        pthread_cond_broadcast(&pool->all_work_done_signal);
+        pthread_mutex_unlock(&pool->pending_work_mutex);
+    }
+}
+
+static pool_future* new_future(worker_pool* pool, const pool_task* task, int refs) {
+    pool_future* future = (pool_future*)malloc(sizeof(pool_future));
+    assert(future != NULL && "Failed to allocate task");
+    
+    future->task = *task;
+    future->pool = pool;
+    atomic_init(&future->refs, refs);
+    future->heap_index = -1;
+    pthread_mutex_init(&future->mutex, NULL);
+    pthread_cond_init(&future->done_signal, NULL);
+    future->state = TASK_PENDING;
+    future->result = NULL;
+    future->continuations = NULL;
+    future->last_continuation = NULL;
+    return future;
+}
+
+void pool_future_release(pool_future* future) {
+    if (future == NULL || atomic_fetch_sub(&future->refs, 1) != 1) {
+        return;
+    }
+    
+    pthread_mutex_destroy(&future->mutex);
+    pthread_cond_destroy(&future->done_signal);
+    free(future);
+}
+
+// Publish the result, run continuations and drop the pool's reference
+static void complete_task(worker_pool* pool, pool_future* future, void* result, task_state state) {
+    pthread_mutex_lock(&future->mutex);
+    future->result = result;
+    future->state = state;
+    task_continuation* continuation = future->continuations;
+    future->continuations = NULL;
+    future->last_continuation = NULL;
+    pthread_cond_broadcast(&future->done_signal);
+    pthread_mutex_unlock(&future->mutex);
+    
+    while (continuation != NULL) {
+        task_continuation* next = continuation->next;
+        continuation->fn(result, continuation->ctx);
+        free(continuation);
+        continuation = next;
+    }
+    
+    pool_future_release(future);
+    finish_work(pool);
+}
+
+static void run_task(worker_pool* pool, pool_future* future) {
+    void* result = future->task.run(future->task.ctx);
+    atomic_fetch_add_explicit(&pool->completed_count, 1, memory_order_relaxed);
+    complete_task(pool, future, result, TASK_DONE);
+}
+
+static void cancel_task(worker_pool* pool, pool_future* future) {
+    if (future->task.discard != NULL) {
+        future->task.discard(future->task.ctx);
+    }
+    atomic_fetch_add_explicit(&pool->cancelled_count, 1, memory_order_relaxed);
+    complete_task(pool, future, NULL, TASK_CANCELLED);
+}
+
+static int is_stale(pool_future* future) {
+    return !future->task.urgent && future->task.validate != NULL
+        && !future->task.validate(future->task.ctx);
+}
+
 /**
  * Worker thread main loop
  */
 void* worker_thread_main(void* arg) {
     worker_thread* self = (worker_thread*)arg;
     worker_pool* pool = (worker_pool*)self->pool_ref;
+    current_worker = self;
+    thread_usage_begin(&pool->usage);
     
-    while (!pool->shutdown_flag) {
-        pthread_mutex_lock(&pool->work_queue_mutex);
-        
-        // Wait for work or shutdown signal
-        while (pool->work_queue == NULL && !pool->shutdown_flag) {
-            pthread_cond_wait(&pool->work_available_signal, &pool->work_queue_mutex);
+    while (!atomic_load(&pool->shutdown_flag) && !atomic_load(&self->retire)) {
+        // Own deque first, newest task while it is still in cache
+        pool_future* task = deque_take(&self->deque);
+        if (task == NULL) {
+            task = steal_work(pool, self);
+        }
+        if (task != NULL) {
+            atomic_fetch_sub(&pool->deque_items, 1);
+            run_task(pool, task);
+            continue;
         }
         
-        if (pool->shutdown_flag) {
+        pthread_mutex_lock(&pool->work_queue_mutex);
+        if (pool->work_count > 0) {
+            // Pop the most important queued task
+            task = pool->work_heap[0].task;
+            remove_entry(pool, 0);
             pthread_mutex_unlock(&pool->work_queue_mutex);
-            break;
+            
+            // Last chance to skip work the submitter no longer wants
+            if (is_stale(task)) {
+                cancel_task(pool, task);
+            } else {
+                run_task(pool, task);
+            }
+            continue;
         }
         
-        // Pop work from queue
-        void* work_item = queue_pop(&pool->work_queue);
+        // Announce we are going to sleep before the last look at the deques,
+        // so a pusher either sees us asleep or we see its task
+        atomic_fetch_add(&pool->sleeping_count, 1);
+        if (atomic_load(&pool->deque_items) <= 0 && !atomic_load(&pool->shutdown_flag)
+                && !atomic_load(&self->retire)) {
+            thread_usage_idle(&pool->usage);
+            pthread_cond_wait(&pool->work_available_signal, &pool->work_queue_mutex);
+            thread_usage_wake(&pool->usage);
+        }
+        atomic_fetch_sub(&pool->sleeping_count, 1);
         pthread_mutex_unlock(&pool->work_queue_mutex);
-        
-        if (work_item == NULL) {
-            continue;
+    }
+    
+    // Retiring, nobody else runs what this worker pushed once it is gone
+    if (!atomic_load(&pool->shutdown_flag)) {
+        pool_help(pool);
+    }
+    
+    thread_usage_end(&pool->usage);
+    current_worker = NULL;
+    return NULL;
+}
+
+#ifdef __linux__
+// Rounded up CPUs allowed by a cgroup v2 or v1 quota, 0 when unlimited
+static int cgroup_cpu_limit(void) {
+    long long quota = -1;
+    long long period = 0;
+    
+    FILE* file = fopen("/sys/fs/cgroup/cpu.max", "r");
+    if (file != NULL) {
+        char max[32];
+        if (fscanf(file, "%31s %lld", max, &period) == 2 && strcmp(max, "max") != 0) {
+            quota = atoll(max);
         }
-        
-        // Process work item using the processor function
-        if (pool->process_fn != NULL) {
-            pool->process_fn(work_item);
+        fclose(file);
+    } else {
+        file = fopen("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", "r");
+        if (file != NULL) {
+            if (fscanf(file, "%lld", &quota) != 1) {
+                quota = -1;
+            }
+            fclose(file);
         }
-        
-        // Decrement pending work counter
-        pthread_mutex_lock(&pool->pending_work_mutex);
-        pool->pending_work_count--;
-        if (pool->pending_work_count == 0) {
-            pthread_cond_signal(&pool->all_work_done_signal);
+        file = fopen("/sys/fs/cgroup/cpu/cpu.cfs_period_us", "r");
+        if (file != NULL) {
+            if (fscanf(file, "%lld", &period) != 1) {
+                period = 0;
+            }
+            fclose(file);
         }
-        pthread_mutex_unlock(&pool->pending_work_mutex);
     }
     
-    self->is_active = 0;
-    return NULL;
+    if (quota <= 0 || period <= 0) {
+        return 0;
+    }
+    return (int)((quota + period - 1) / period);
 }
+#endif
 
-worker_pool* pool_init(int num_threads, work_processor_fn process_fn) {
-    if (num_threads < 1 || num_threads > 16) {
-        return NULL;
+int pool_auto_thread_count(void) {
+    int cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#ifdef __linux__
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        int count = CPU_COUNT(&allowed);
+        if (count > 0 && (cpus < 1 || count < cpus)) {
+            cpus = count;
+        }
     }
+    int limit = cgroup_cpu_limit();
+    if (limit > 0 && (cpus < 1 || limit < cpus)) {
+        cpus = limit;
+    }
+#endif
     
-    if (process_fn == NULL) {
+    // Leave a core to the render thread
+    int threads = cpus - 1;
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > POOL_MAX_THREADS) {
+        threads = POOL_MAX_THREADS;
+    }
+    return threads;
+}
+
+// Pin a worker to its share of the worker CPUs, caller holds resize_mutex
+static void pin_worker(worker_pool* pool, worker_thread* worker) {
+#ifdef __linux__
+    if (pool->num_worker_cpus == 0) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(pool->worker_cpus[worker->worker_id % pool->num_worker_cpus], &set);
+    pthread_setaffinity_np(worker->thread_id, sizeof(set), &set);
+#else
+    (void)pool;
+    (void)worker;
+#endif
+}
+
+// Start workers in slots [from, to), returns how many were started.
+// Caller holds resize_mutex.
+static int start_workers(worker_pool* pool, int from, int to) {
+    for (int i = from; i < to; i++) {
+        worker_thread* worker = &pool->threads[i];
+        worker->worker_id = i;
+        worker->pool_ref = pool;
+        atomic_store(&worker->retire, 0);
+        
+        if (pthread_create(&worker->thread_id, NULL, worker_thread_main, worker) != 0) {
+            return i - from;
+        }
+        worker->is_active = 1;
+        pin_worker(pool, worker);
+    }
+    return to - from;
+}
+
+worker_pool* pool_init(int num_threads) {
+    if (num_threads < 1 || num_threads > POOL_MAX_THREADS) {
         return NULL;
     }
     
@@ -89,72 +546,423 @@ worker_pool* pool_init(int num_threads, work_processor_fn process_fn) {
         return NULL;
     }
     
-    pool->num_threads = num_threads;
-    pool->process_fn = process_fn;
-    pool->threads = (worker_thread*)malloc(sizeof(worker_thread) * num_threads);
+    pool->threads = (worker_thread*)calloc(POOL_MAX_THREADS, sizeof(worker_thread));
     if (pool->threads == NULL) {
         free(pool);
         return NULL;
     }
     
-    pool->work_queue = NULL;
-    pool->shutdown_flag = 0;
-    pool->pending_work_count = 0;
-    
-    queue_init(&pool->work_queue);
+    atomic_init(&pool->num_threads, num_threads);
+    pool->num_worker_cpus = 0;
+    pool->reserved_cpu = -1;
+    pool->work_heap = NULL;
+    pool->work_count = 0;
+    pool->work_capacity = 0;
+    pool->next_order = 0;
+    key_index_init(&pool->queued_keys);
+    atomic_init(&pool->deque_items, 0);
+    atomic_init(&pool->sleeping_count, 0);
+    atomic_init(&pool->shutdown_flag, 0);
+    atomic_init(&pool->pending_work_count, 0);
+    atomic_init(&pool->submitted_count, 0);
+    atomic_init(&pool->merged_count, 0);
+    atomic_init(&pool->completed_count, 0);
+    atomic_init(&pool->cancelled_count, 0);
+    pool->usage = (thread_usage)THREAD_USAGE_INITIALIZER("workers");
     
     pthread_mutex_init(&pool->work_queue_mutex, NULL);
     pthread_mutex_init(&pool->pending_work_mutex, NULL);
+    pthread_mutex_init(&pool->resize_mutex, NULL);
     pthread_cond_init(&pool->work_available_signal, NULL);
     pthread_cond_init(&pool->all_work_done_signal, NULL);
     
+    // Every deque must be ready before the first worker goes stealing. They
+    // are never reset, a retired worker leaves its deque empty.
+    for (int i = 0; i < POOL_MAX_THREADS; i++) {
+        atomic_init(&pool->threads[i].deque.top, 0);
+        atomic_init(&pool->threads[i].deque.bottom, 0);
+        atomic_init(&pool->threads[i].retire, 0);
+    }
+    
     // Create worker threads
-    for (int i = 0; i < num_threads; i++) {
-        pool->threads[i].worker_id = i;
-        pool->threads[i].is_active = 1;
-        pool->threads[i].pool_ref = pool;
+    pthread_mutex_lock(&pool->resize_mutex);
+    int started = start_workers(pool, 0, num_threads);
+    pthread_mutex_unlock(&pool->resize_mutex);
+    if (started < num_threads) {
+        // Failed to create thread, cleanup
+        pthread_mutex_lock(&pool->work_queue_mutex);
+        atomic_store(&pool->shutdown_flag, 1);
+        pthread_cond_broadcast(&pool->work_available_signal);
+        pthread_mutex_unlock(&pool->work_queue_mutex);
         
-        if (pthread_create(&pool->threads[i].thread_id, NULL, worker_thread_main, &pool->threads[i]) != 0) {
-            // Failed to create thread, cleanup
-            pool->shutdown_flag = 1;
-            pthread_cond_broadcast(&pool->work_available_signal);
-            
-            for (int j = 0; j < i; j++) {
-                pthread_join(pool->threads[j].thread_id, NULL);
-            }
-            
-            pthread_mutex_destroy(&pool->work_queue_mutex);
-            pthread_mutex_destroy(&pool->pending_work_mutex);
-            pthread_cond_destroy(&pool->work_available_signal);
-            pthread_cond_destroy(&pool->all_work_done_signal);
-            
-            queue_cleanup(&pool->work_queue);
-            
-            free(pool->threads);
-            free(pool);
-            return NULL;
+        for (int j = 0; j < started; j++) {
+            pthread_join(pool->threads[j].thread_id, NULL);
         }
+        
+        pthread_mutex_destroy(&pool->work_queue_mutex);
+        pthread_mutex_destroy(&pool->pending_work_mutex);
+        pthread_mutex_destroy(&pool->resize_mutex);
+        pthread_cond_destroy(&pool->work_available_signal);
+        pthread_cond_destroy(&pool->all_work_done_signal);
+        
+        free(pool->work_heap);
+        key_index_free(&pool->queued_keys);
+        
+        free(pool->threads);
+        free(pool);
+        return NULL;
     }
     
+    thread_usage_register(&pool->usage);
     return pool;
 }
 
-int pool_submit_work(worker_pool* pool, void* work_item) {
-    if (pool == NULL || work_item == NULL) {
+int pool_resize(worker_pool* pool, int num_threads) {
+    if (pool == NULL || num_threads < 1 || num_threads > POOL_MAX_THREADS) {
         return -1;
     }
+    assert((current_worker == NULL || current_worker->pool_ref != pool)
+        && "pool_resize called from one of the pool's workers");
     
-    pthread_mutex_lock(&pool->work_queue_mutex);
-    queue_push(&pool->work_queue, work_item, chunk_work_item_equals);
+    pthread_mutex_lock(&pool->resize_mutex);
+    int current = atomic_load(&pool->num_threads);
     
-    pthread_mutex_lock(&pool->pending_work_mutex);
-    pool->pending_work_count++;
-    pthread_mutex_unlock(&pool->pending_work_mutex);
+    if (num_threads > current) {
+        // Publish the new slots only once their threads exist
+        num_threads = current + start_workers(pool, current, num_threads);
+        atomic_store(&pool->num_threads, num_threads);
+    } else if (num_threads < current) {
+        pthread_mutex_lock(&pool->work_queue_mutex);
+        for (int i = num_threads; i < current; i++) {
+            atomic_store(&pool->threads[i].retire, 1);
+        }
+        pthread_cond_broadcast(&pool->work_available_signal);
+        pthread_mutex_unlock(&pool->work_queue_mutex);
+        
+        // Retiring workers finish their current task and empty their deque,
+        // which the others can still steal from until they are gone
+        for (int i = num_threads; i < current; i++) {
+            pthread_join(pool->threads[i].thread_id, NULL);
+            pool->threads[i].is_active = 0;
+        }
+        atomic_store(&pool->num_threads, num_threads);
+    }
+    
+    pthread_mutex_unlock(&pool->resize_mutex);
+    return num_threads;
+}
+
+int pool_thread_count(worker_pool* pool) {
+    return pool != NULL ? atomic_load(&pool->num_threads) : 0;
+}
+
+int pool_pin_workers(worker_pool* pool) {
+#ifdef __linux__
+    if (pool == NULL) {
+        return -1;
+    }
+    
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) < 2) {
+        return -1;
+    }
+    
+    // Keep the CPU the calling thread runs on now free of workers. Its own
+    // mask is left alone so threads it starts later can use every CPU.
+    int reserved = sched_getcpu();
+    if (reserved < 0 || !CPU_ISSET(reserved, &allowed)) {
+        reserved = -1;
+        for (int cpu = 0; cpu < POOL_MAX_CPUS && cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &allowed)) {
+                reserved = cpu;
+                break;
+            }
+        }
+    }
     
+    pthread_mutex_lock(&pool->resize_mutex);
+    pool->reserved_cpu = reserved;
+    pool->num_worker_cpus = 0;
+    for (int cpu = 0; cpu < POOL_MAX_CPUS && cpu < CPU_SETSIZE; cpu++) {
+        if (cpu != reserved && CPU_ISSET(cpu, &allowed)) {
+            pool->worker_cpus[pool->num_worker_cpus++] = cpu;
+        }
+    }
+    int num_threads = atomic_load(&pool->num_threads);
+    for (int i = 0; i < num_threads; i++) {
+        pin_worker(pool, &pool->threads[i]);
+    }
+    pthread_mutex_unlock(&pool->resize_mutex);
+    return 0;
+#else
+    (void)pool;
+    return -1;
+#endif
+}
+
+int pool_pin_reserved_cpu(worker_pool* pool) {
+#ifdef __linux__
+    if (pool == NULL) {
+        return -1;
+    }
+    
+    pthread_mutex_lock(&pool->resize_mutex);
+    int reserved = pool->reserved_cpu;
+    pthread_mutex_unlock(&pool->resize_mutex);
+    if (reserved < 0) {
+        return -1;
+    }
+    
+    cpu_set_t own;
+    CPU_ZERO(&own);
+    CPU_SET(reserved, &own);
+    return pthread_setaffinity_np(pthread_self(), sizeof(own), &own) == 0 ? 0 : -1;
+#else
+    (void)pool;
+    return -1;
+#endif
+}
+
+// Push onto the calling worker's own deque without taking any lock
+static pool_future* submit_local(worker_pool* pool, const pool_task* task, int refs) {
+    worker_thread* self = current_worker;
+    if (self == NULL || self->pool_ref != pool) {
+        return NULL;
+    }
+    
+    pool_future* future = new_future(pool, task, refs);
+    atomic_fetch_add(&pool->pending_work_count, 1);
+    if (!deque_push(&self->deque, future)) {
+        atomic_fetch_sub(&pool->pending_work_count, 1);
+        pool_future_release(future);
+        return NULL;
+    }
+    atomic_fetch_add(&pool->deque_items, 1);
+    atomic_fetch_add_explicit(&pool->submitted_count, 1, memory_order_relaxed);
+    wake_worker(pool);
+    return future;
+}
+
+// Queue a task, or merge it into a queued task with the same key. refs is 2
+// when the caller keeps the future. Sets merged when the task was folded
+// into another and its context discarded.
+static pool_future* submit_task(worker_pool* pool, const pool_task* task, int refs, int* merged) {
+    *merged = 0;
+    
+    // Keyed tasks stay on the shared queue where duplicates can be found
+    if (task->urgent && !task->has_key) {
+        pool_future* future = submit_local(pool, task, refs);
+        if (future != NULL) {
+            return future;
+        }
+    }
+    
+    pthread_mutex_lock(&pool->work_queue_mutex);
+    int existing = task->has_key ? find_key(pool, task->key) : -1;
+    if (existing >= 0) {
+        pool_future* queued = pool->work_heap[existing].task;
+        merge_entry(pool, existing, task);
+        if (refs > 1) {
+            atomic_fetch_add(&queued->refs, 1);
+        }
+        pthread_mutex_unlock(&pool->work_queue_mutex);
+        
+        if (task->discard != NULL) {
+            task->discard(task->ctx);
+        }
+        atomic_fetch_add_explicit(&pool->merged_count, 1, memory_order_relaxed);
+        *merged = 1;
+        return queued;
+    }
+    
+    pool_future* future = new_future(pool, task, refs);
+    push_entry(pool, future);
+    atomic_fetch_add(&pool->pending_work_count, 1);
     pthread_cond_signal(&pool->work_available_signal);
     pthread_mutex_unlock(&pool->work_queue_mutex);
     
-    return 0;
+    atomic_fetch_add_explicit(&pool->submitted_count, 1, memory_order_relaxed);
+    return future;
+}
+
+pool_future* pool_submit(worker_pool* pool, const pool_task* task) {
+    if (pool == NULL || task == NULL || task->run == NULL) {
+        return NULL;
+    }
+    
+    int merged;
+    return submit_task(pool, task, 2, &merged);
+}
+
+int pool_run(worker_pool* pool, const pool_task* task) {
+    if (pool == NULL || task == NULL || task->run == NULL) {
+        return -1;
+    }
+    
+    int merged;
+    submit_task(pool, task, 1, &merged);
+    return merged;
+}
+
+void* pool_future_wait(pool_future* future) {
+    if (future == NULL) {
+        return NULL;
+    }
+    worker_pool* pool = future->pool;
+    
+    // Nobody started it yet, run it here rather than block a thread on it
+    pthread_mutex_lock(&pool->work_queue_mutex);
+    int queued = future->heap_index >= 0;
+    if (queued) {
+        remove_entry(pool, future->heap_index);
+    }
+    pthread_mutex_unlock(&pool->work_queue_mutex);
+    
+    if (queued) {
+        run_task(pool, future);
+    } else {
+        // It may still sit on this worker's deque
+        pool_help(pool);
+    }
+    
+    pthread_mutex_lock(&future->mutex);
+    while (future->state == TASK_PENDING) {
+        pthread_cond_wait(&future->done_signal, &future->mutex);
+    }
+    void* result = future->result;
+    pthread_mutex_unlock(&future->mutex);
+    return result;
+}
+
+int pool_future_done(pool_future* future) {
+    if (future == NULL) {
+        return 1;
+    }
+    
+    pthread_mutex_lock(&future->mutex);
+    int done = future->state != TASK_PENDING;
+    pthread_mutex_unlock(&future->mutex);
+    return done;
+}
+
+void pool_future_then(pool_future* future, task_continuation_fn fn, void* ctx) {
+    if (future == NULL || fn == NULL) {
+        return;
+    }
+    
+    pthread_mutex_lock(&future->mutex);
+    if (future->state == TASK_PENDING) {
+        task_continuation* continuation = (task_continuation*)malloc(sizeof(task_continuation));
+        assert(continuation != NULL && "Failed to allocate continuation");
+        continuation->fn = fn;
+        continuation->ctx = ctx;
+        continuation->next = NULL;
+        if (future->last_continuation != NULL) {
+            future->last_continuation->next = continuation;
+        } else {
+            future->continuations = continuation;
+        }
+        future->last_continuation = continuation;
+        pthread_mutex_unlock(&future->mutex);
+        return;
+    }
+    void* result = future->result;
+    pthread_mutex_unlock(&future->mutex);
+    
+    fn(result, ctx);
+}
+
+int pool_future_cancel(pool_future* future) {
+    if (future == NULL) {
+        return 0;
+    }
+    worker_pool* pool = future->pool;
+    
+    pthread_mutex_lock(&pool->work_queue_mutex);
+    int queued = future->heap_index >= 0;
+    if (queued) {
+        remove_entry(pool, future->heap_index);
+    }
+    pthread_mutex_unlock(&pool->work_queue_mutex);
+    
+    if (queued) {
+        cancel_task(pool, future);
+    }
+    return queued;
+}
+
+int pool_reprioritize(worker_pool* pool) {
+    if (pool == NULL) {
+        return 0;
+    }
+    
+    pool_future** stale = NULL;
+    int dropped = 0;
+    
+    pthread_mutex_lock(&pool->work_queue_mutex);
+    for (int i = 0; i < pool->work_count;) {
+        pool_entry* entry = &pool->work_heap[i];
+        if (is_stale(entry->task)) {
+            if (stale == NULL) {
+                stale = (pool_future**)malloc(sizeof(pool_future*) * pool->work_count);
+                assert(stale != NULL && "Failed to allocate stale task list");
+            }
+            stale[dropped++] = entry->task;
+            unindex_task(pool, entry->task);
+            entry->task->heap_index = -1;
+            // Fill the hole from the end, the heap is rebuilt below
+            if (i != --pool->work_count) {
+                set_entry(pool, i, pool->work_heap[pool->work_count]);
+            }
+            continue;
+        }
+        if (!entry->urgent) {
+            entry->priority = get_priority(entry->task);
+        }
+        i++;
+    }
+    for (int i = pool->work_count / 2 - 1; i >= 0; i--) {
+        sift_down(pool, i);
+    }
+    pthread_mutex_unlock(&pool->work_queue_mutex);
+    
+    // Continuations may submit more work, so cancel outside the lock
+    for (int i = 0; i < dropped; i++) {
+        cancel_task(pool, stale[i]);
+    }
+    free(stale);
+    return dropped;
+}
+
+int pool_help(worker_pool* pool) {
+    worker_thread* self = current_worker;
+    if (pool == NULL || self == NULL || self->pool_ref != pool) {
+        return 0;
+    }
+    
+    int count = 0;
+    pool_future* task;
+    while ((task = deque_take(&self->deque)) != NULL) {
+        atomic_fetch_sub(&pool->deque_items, 1);
+        run_task(pool, task);
+        count++;
+    }
+    return count;
+}
+
+void pool_get_stats(worker_pool* pool, pool_stats* out) {
+    if (out == NULL) {
+        return;
+    }
+    memset(out, 0, sizeof(*out));
+    if (pool == NULL) {
+        return;
+    }
+    
+    out->submitted = atomic_load_explicit(&pool->submitted_count, memory_order_relaxed);
+    out->merged = atomic_load_explicit(&pool->merged_count, memory_order_relaxed);
+    out->completed = atomic_load_explicit(&pool->completed_count, memory_order_relaxed);
+    out->cancelled = atomic_load_explicit(&pool->cancelled_count, memory_order_relaxed);
 }
 
 int pool_is_idle(worker_pool* pool) {
@@ -162,11 +970,7 @@ int pool_is_idle(worker_pool* pool) {
         return 1;
     }
     
-    pthread_mutex_lock(&pool->pending_work_mutex);
-    int idle = (pool->pending_work_count == 0);
-    pthread_mutex_unlock(&pool->pending_work_mutex);
-    
-    return idle;
+    return atomic_load(&pool->pending_work_count) == 0;
 }
 
 void pool_wait_completion(worker_pool* pool) {
@@ -175,7 +979,7 @@ void pool_wait_completion(worker_pool* pool) {
     }
     
     pthread_mutex_lock(&pool->pending_work_mutex);
-    while (pool->pending_work_count > 0) {
+    while (atomic_load(&pool->pending_work_count) > 0) {
         pthread_cond_wait(&pool->all_work_done_signal, &pool->pending_work_mutex);
     }
     pthread_mutex_unlock(&pool->pending_work_mutex);
@@ -188,24 +992,46 @@ void pool_shutdown(worker_pool* pool) {
     
     // Signal all threads to shutdown
     pthread_mutex_lock(&pool->work_queue_mutex);
-    pool->shutdown_flag = 1;
+    atomic_store(&pool->shutdown_flag, 1);
     pthread_cond_broadcast(&pool->work_available_signal);
     pthread_mutex_unlock(&pool->work_queue_mutex);
     
     // Wait for all threads to finish
-    for (int i = 0; i < pool->num_threads; i++) {
+    pthread_mutex_lock(&pool->resize_mutex);
+    int num_threads = atomic_load(&pool->num_threads);
+    for (int i = 0; i < num_threads; i++) {
         if (pool->threads[i].is_active) {
             pthread_join(pool->threads[i].thread_id, NULL);
+            pool->threads[i].is_active = 0;
         }
     }
+    pthread_mutex_unlock(&pool->resize_mutex);
+    thread_usage_unregister(&pool->usage);
+    
+    // Cancel whatever never ran so contexts are freed and waiters wake up
+    for (int i = 0; i < num_threads; i++) {
+        pool_future* task;
+        while ((task = deque_steal(&pool->threads[i].deque)) != NULL) {
+            cancel_task(pool, task);
+        }
+    }
+    while (pool->work_count > 0) {
+        pool_future* task = pool->work_heap[pool->work_count - 1].task;
+        unindex_task(pool, task);
+        task->heap_index = -1;
+        pool->work_count--;
+        cancel_task(pool, task);
+    }
     
     // Clean up resources
     pthread_mutex_destroy(&pool->work_queue_mutex);
     pthread_mutex_destroy(&pool->pending_work_mutex);
+    pthread_mutex_destroy(&pool->resize_mutex);
     pthread_cond_destroy(&pool->work_available_signal);
     pthread_cond_destroy(&pool->all_work_done_signal);
     
-    queue_cleanup(&pool->work_queue);
+    free(pool->work_heap);
+    key_index_free(&pool->queued_keys);
     
     free(pool->threads);
     free(pool);
@@ -2,27 +2,178 @@
 #define WORKER_POOL_H
 
 #include <pthread.h>
+#include <stdint.h>
+
+#define POOL_MAX_THREADS 64
 
 typedef struct worker_pool worker_pool;
+typedef struct pool_future pool_future;
+
+// Runs a task, the return value becomes the result of its future
+typedef void* (*task_fn)(void* ctx);
+
+// Returns the priority of a queued task, lower runs first
+typedef float (*task_priority_fn)(void* ctx);
+
+// Checks a queued task is still wanted. It may refresh ctx to match the
+// current state, returning 0 drops the task.
+typedef int (*task_validate_fn)(void* ctx);
 
-// Callback function type for processing work items
-typedef void (*work_processor_fn)(void* work_item);
+// Releases the context of a task that will never run
+typedef void (*task_discard_fn)(void* ctx);
+
+// Called once a task finished, result is NULL if it was cancelled
+typedef void (*task_continuation_fn)(void* result, void* ctx);
+
+// A unit of work. Only run is required, e.g.
+// pool_run(pool, &(pool_task){.run = fn, .ctx = data});
+typedef struct {
+    task_fn run;
+    void* ctx;
+    task_priority_fn priority;  // NULL runs in submission order
+    task_validate_fn validate;  // NULL always runs
+    task_discard_fn discard;    // frees ctx when merged or cancelled
+    int has_key;                // queued tasks with equal keys are merged
+    uint64_t key;
+    int urgent;                 // ahead of everything, never dropped as stale
+} pool_task;
+
+// Running totals since pool_init
+typedef struct {
+    unsigned long submitted;  // tasks queued
+    unsigned long merged;     // submissions folded into an equal queued task
+    unsigned long completed;  // tasks run
+    unsigned long cancelled;  // tasks dropped before they started
+} pool_stats;
 
 /**
  * Initialize a worker pool with a specified number of threads
- * @param num_threads Number of worker threads to create (1-16 recommended)
- * @param process_fn Callback function to process each work item
+ * @param num_threads Number of worker threads to create (1-64)
  * @return Pointer to allocated worker pool, or NULL on failure
  */
-worker_pool* pool_init(int num_threads, work_processor_fn process_fn);
+worker_pool* pool_init(int num_threads);
+
+/**
+ * Pick a worker count for this machine: the CPUs the process may run on,
+ * capped by any cgroup CPU quota, less one for the render thread
+ * @return Number of workers (1-64)
+ */
+int pool_auto_thread_count(void);
+
+/**
+ * Add or retire workers while the pool is in use. Retired workers finish
+ * their current task first, so shrinking may block briefly. Must not be
+ * called from one of the pool's own workers.
+ * @param pool Pointer to worker pool
+ * @param num_threads New number of workers (1-64)
+ * @return Number of workers now running, or -1 on invalid arguments
+ */
+int pool_resize(worker_pool* pool, int num_threads);
+
+/**
+ * Get the current number of workers
+ * @param pool Pointer to worker pool
+ * @return Number of workers
+ */
+int pool_thread_count(worker_pool* pool);
+
+/**
+ * Reserve the CPU the calling thread runs on and spread the workers, and
+ * any added later, over the remaining CPUs. The calling thread itself is not
+ * pinned, see pool_pin_reserved_cpu. Linux only.
+ * @param pool Pointer to worker pool
+ * @return 0 on success, -1 if unsupported or fewer than two CPUs are usable
+ */
+int pool_pin_workers(worker_pool* pool);
+
+/**
+ * Pin the calling thread to the CPU pool_pin_workers reserved. Threads it
+ * creates afterwards inherit the single CPU mask, so call it once every
+ * other thread has been started.
+ * @param pool Pointer to worker pool
+ * @return 0 on success, -1 if unsupported or no CPU was reserved
+ */
+int pool_pin_reserved_cpu(worker_pool* pool);
+
+/**
+ * Queue a task and get a future for its result. Urgent tasks without a key
+ * submitted from a worker go lock-free onto that worker's own deque where
+ * idle workers can steal them.
+ * @param pool Pointer to worker pool
+ * @param task Task to queue, copied
+ * @return Future the caller must release, or NULL on failure. If the task
+ *         was merged this is the future of the task already queued and the
+ *         new context has been discarded.
+ */
+pool_future* pool_submit(worker_pool* pool, const pool_task* task);
+
+/**
+ * Queue a task nobody waits on
+ * @param pool Pointer to worker pool
+ * @param task Task to queue, copied
+ * @return 0 on success, 1 if merged into an equal queued task, -1 on failure
+ */
+int pool_run(worker_pool* pool, const pool_task* task);
+
+/**
+ * Block until a task finished. A task no worker has started yet is taken
+ * back and run on the calling thread, so this is safe to call from a worker.
+ * @param future Future returned by pool_submit
+ * @return The task's result, NULL if it was cancelled
+ */
+void* pool_future_wait(pool_future* future);
+
+/**
+ * Check if a task has finished or was cancelled
+ * @param future Future returned by pool_submit
+ * @return 1 if finished, 0 if still queued or running
+ */
+int pool_future_done(pool_future* future);
+
+/**
+ * Run fn once the task finished, on the thread that finished it. Runs
+ * straight away on the calling thread if it already has.
+ * @param future Future returned by pool_submit
+ * @param fn Continuation to run
+ * @param ctx Passed to fn with the result
+ */
+void pool_future_then(pool_future* future, task_continuation_fn fn, void* ctx);
+
+/**
+ * Take back a task no worker has started yet. Its context is discarded and
+ * its continuations run with a NULL result.
+ * @param future Future returned by pool_submit
+ * @return 1 if the task was cancelled, 0 if it already started
+ */
+int pool_future_cancel(pool_future* future);
+
+/**
+ * Drop the caller's reference to a future, the task itself keeps running
+ * @param future Future returned by pool_submit
+ */
+void pool_future_release(pool_future* future);
+
+/**
+ * Drop stale queued tasks and recompute the priority of the rest, e.g.
+ * after the player moved
+ * @param pool Pointer to worker pool
+ * @return Number of tasks dropped
+ */
+int pool_reprioritize(worker_pool* pool);
+
+/**
+ * Run the tasks the calling worker pushed that nobody has stolen yet
+ * @param pool Pointer to worker pool
+ * @return Number of tasks run, always 0 outside the pool's workers
+ */
+int pool_help(worker_pool* pool);
 
 /**
- * Submit work to the worker pool
+ * Read the pool's work counters
  * @param pool Pointer to worker pool
- * @param work_item Pointer to work item to process
- * @return 0 on success, -1 on failure
+ * @param out Filled with the current totals
  */
-int pool_submit_work(worker_pool* pool, void* work_item);
+void pool_get_stats(worker_pool* pool, pool_stats* out);
 
 /**
  * Check if work pool has any pending work
@@ -1,204 +1,175 @@
 #include "ambient_occlusion.h"
 
+#include <pthread.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "../../world/core/block.h"
 
-static bool is_ao_solid(int x, int y, int z, chunk* c, chunk* adj_chunks[4]) {
-    if (y < 0 || y >= CHUNK_HEIGHT) {
-        return false;
-    }
-
-    // Handle cross-chunk boundaries
-    chunk* target_chunk = c;
-    int local_x = x;
-    int local_z = z;
-
-    if (x < 0) {
-        target_chunk = adj_chunks[3]; // EAST (-X)
-        local_x = CHUNK_SIZE + x;
-    } else if (x >= CHUNK_SIZE) {
-        target_chunk = adj_chunks[1]; // WEST (+X)
-        local_x = x - CHUNK_SIZE;
-    }
+#define MAX_BLOCK_IDS 1024
+
+static bool ao_opaque[MAX_BLOCK_IDS];
+
+// Packed AO for the 4 vertices of a face, indexed by the 8 neighbour mask
+static uint8_t ao_mask_table[256];
+
+static pthread_once_t ao_tables_once = PTHREAD_ONCE_INIT;
+
+// Neighbours in the plane in front of a face, in mask bit order.
+// (u, v) are the face's in-plane axes, see face_axes below.
+static const int mask_offsets[8][2] = {
+    {-1, -1}, {0, -1}, {1, -1},
+    {-1,  0},          {1,  0},
+    {-1,  1}, {0,  1}, {1,  1}
+};
+
+// Per vertex: side1, side2 and corner mask bits.
+// Vertex order matches the quad rendering order in the shader: v0 (-u,-v),
+// v1 (+u,-v), v2 (+u,+v), v3 (-u,+v)
+static const int vertex_bits[4][3] = {
+    {3, 1, 0},
+    {4, 1, 2},
+    {4, 6, 7},
+    {3, 6, 5}
+};
+
+// Per face: normal offset, then u and v axes as unit offsets (x, y, z)
+static const int face_axes[6][3][3] = {
+    {{0, 0, -1}, {1, 0, 0}, {0, 1, 0}}, // NORTH (-Z)
+    {{1, 0, 0},  {0, 0, 1}, {0, 1, 0}}, // WEST (+X)
+    {{0, 0, 1},  {1, 0, 0}, {0, 1, 0}}, // SOUTH (+Z)
+    {{-1, 0, 0}, {0, 0, 1}, {0, 1, 0}}, // EAST (-X)
+    {{0, 1, 0},  {1, 0, 0}, {0, 0, 1}}, // UP (+Y)
+    {{0, -1, 0}, {1, 0, 0}, {0, 0, 1}}  // DOWN (-Y)
+};
 
-    if (z < 0) {
-        target_chunk = adj_chunks[0]; // NORTH (-Z)
-        local_z = CHUNK_SIZE + z;
-    } else if (z >= CHUNK_SIZE) {
-        target_chunk = adj_chunks[2]; // SOUTH (+Z)
-        local_z = z - CHUNK_SIZE;
+// Calculate vertex AO value (0-3) based on edge and corner neighbors
+static int vertex_ao(int side1, int side2, int corner) {
+    if (side1 && side2) {
+        return 0;  // Fully occluded
     }
+    return 3 - (side1 + side2 + corner);
+}
 
-    if (target_chunk == NULL) {
-        return false;
+static void build_ao_tables(void) {
+    short air_id = get_block_id("air");
+    for (int i = 0; i < BLOCK_COUNT; i++) {
+        block_type block = TYPES[i];
+        if (block.id >= MAX_BLOCK_IDS || (short)block.id == air_id) {
+            continue;
+        }
+
+        // Model blocks don't contribute to AO
+        ao_opaque[block.id] = !block.is_custom_model
+            && !block.transparent
+            && !block.liquid;
     }
 
-    if (local_x < 0
-            || local_x >= CHUNK_SIZE
-            || local_z < 0
-            || local_z >= CHUNK_SIZE) {
-        return false;
+    for (int mask = 0; mask < 256; mask++) {
+        int packed = 0;
+        for (int v = 0; v < 4; v++) {
+            int ao = vertex_ao(
+                (mask >> vertex_bits[v][0]) & 1,
+                (mask >> vertex_bits[v][1]) & 1,
+                (mask >> vertex_bits[v][2]) & 1);
+            packed |= ao << (2 * v);
+        }
+        ao_mask_table[mask] = (uint8_t)packed;
     }
+}
 
-    short block_id = 0;
-    get_block_info(target_chunk->blocks[local_x][y][local_z], &block_id, NULL, NULL, NULL);
+static inline int grid_index(int x, int y, int z) {
+    return ((x + 1) * AO_GRID_HEIGHT + (y + 1)) * AO_GRID_WIDTH + (z + 1);
+}
 
-    if (block_id == get_block_id("air")) {
-        return false;
-    }
+static inline int grid_solid(const ao_grid* grid, int x, int y, int z) {
+    int i = grid_index(x, y, z);
+    return (grid->bits[i >> 3] >> (i & 7)) & 1;
+}
 
-    block_type block = get_block_type(block_id);
+// Chunk holding column (x, z) of the padded neighbourhood. Diagonal columns
+// fall outside every neighbour and are treated as open.
+static chunk* get_column_chunk(int x, int z, chunk* c, chunk* adj_chunks[4], int* local_x, int* local_z) {
+    *local_x = x;
+    *local_z = z;
 
-    // Model blocks don't contribute to AO
-    if (block.id == -1
-            || block.is_custom_model
-            || block.transparent
-            || block.liquid) {
-        return false;
+    if ((x < 0 || x >= CHUNK_SIZE) && (z < 0 || z >= CHUNK_SIZE)) {
+        return NULL;
     }
 
-    return true;
+    if (x < 0) {
+        *local_x = CHUNK_SIZE + x;
+        return adj_chunks[3]; // EAST (-X)
+    }
+    if (x >= CHUNK_SIZE) {
+        *local_x = x - CHUNK_SIZE;
+        return adj_chunks[1]; // WEST (+X)
+    }
+    if (z < 0) {
+        *local_z = CHUNK_SIZE + z;
+        return adj_chunks[0]; // NORTH (-Z)
+    }
+    if (z >= CHUNK_SIZE) {
+        *local_z = z - CHUNK_SIZE;
+        return adj_chunks[2]; // SOUTH (+Z)
+    }
+    return c;
 }
 
-// Calculate vertex AO value (0-3) based on edge and corner neighbors
-static int vertex_ao(int side1, int side2, int corner) {
-    if (side1 && side2) {
-        return 0;  // Fully occluded
+void build_ao_grid(ao_grid* grid, chunk* c, chunk* adj_chunks[4]) {
+    pthread_once(&ao_tables_once, build_ao_tables);
+    memset(grid->bits, 0, sizeof(grid->bits));
+
+    if (c == NULL) {
+        return;
+    }
+
+    for (int x = -1; x <= CHUNK_SIZE; x++) {
+        for (int z = -1; z <= CHUNK_SIZE; z++) {
+            int local_x = 0;
+            int local_z = 0;
+            chunk* target = get_column_chunk(x, z, c, adj_chunks, &local_x, &local_z);
+            if (target == NULL) {
+                continue;
+            }
+
+            // rows above and below the chunk are left open
+            for (int y = 0; y < CHUNK_HEIGHT; y++) {
+                short block_id = 0;
+                get_block_info(target->blocks[local_x][y][local_z], &block_id, NULL, NULL, NULL);
+                if (ao_opaque[block_id]) {
+                    int i = grid_index(x, y, z);
+                    grid->bits[i >> 3] |= (uint8_t)(1 << (i & 7));
+                }
+            }
+        }
     }
-    return 3 - (side1 + side2 + corner);
 }
 
 // Calculate AO for all 4 vertices of a face
 // Returns packed int with 4 AO values (2 bits each): v0 | (v1 << 2) | (v2 << 4) | (v3 << 6)
-int calculate_face_ao(int x, int y, int z, int face, chunk* c, chunk* adj_chunks[4]) {
-    int ao[4];
-
-    // Neighbor offsets for each face's 4 vertices
-    // For each vertex, we need side1, side2, and corner neighbors
-    // The vertex order matches the quad rendering order in the shader
-
-    switch (face) {
-        case 4: // UP (+Y)
-            // Vertex 0 (0,0), Vertex 1 (1,0), Vertex 2 (1,1), Vertex 3 (0,1)
-            ao[0] = vertex_ao(
-                is_ao_solid(x-1, y+1, z, c, adj_chunks),
-                is_ao_solid(x, y+1, z-1, c, adj_chunks),
-                is_ao_solid(x-1, y+1, z-1, c, adj_chunks));
-            ao[1] = vertex_ao(
-                is_ao_solid(x+1, y+1, z, c, adj_chunks),
-                is_ao_solid(x, y+1, z-1, c, adj_chunks),
-                is_ao_solid(x+1, y+1, z-1, c, adj_chunks));
-            ao[2] = vertex_ao(
-                is_ao_solid(x+1, y+1, z, c, adj_chunks),
-                is_ao_solid(x, y+1, z+1, c, adj_chunks),
-                is_ao_solid(x+1, y+1, z+1, c, adj_chunks));
-            ao[3] = vertex_ao(
-                is_ao_solid(x-1, y+1, z, c, adj_chunks),
-                is_ao_solid(x, y+1, z+1, c, adj_chunks),
-                is_ao_solid(x-1, y+1, z+1, c, adj_chunks));
-            break;
-
-        case 5: // DOWN (-Y)
-            ao[0] = vertex_ao(
-                is_ao_solid(x-1, y-1, z, c, adj_chunks),
-                is_ao_solid(x, y-1, z-1, c, adj_chunks),
-                is_ao_solid(x-1, y-1, z-1, c, adj_chunks));
-            ao[1] = vertex_ao(
-                is_ao_solid(x+1, y-1, z, c, adj_chunks),
-                is_ao_solid(x, y-1, z-1, c, adj_chunks),
-                is_ao_solid(x+1, y-1, z-1, c, adj_chunks));
-            ao[2] = vertex_ao(
-                is_ao_solid(x+1, y-1, z, c, adj_chunks),
-                is_ao_solid(x, y-1, z+1, c, adj_chunks),
-                is_ao_solid(x+1, y-1, z+1, c, adj_chunks));
-            ao[3] = vertex_ao(
-                is_ao_solid(x-1, y-1, z, c, adj_chunks),
-                is_ao_solid(x, y-1, z+1, c, adj_chunks),
-                is_ao_solid(x-1, y-1, z+1, c, adj_chunks));
-            break;
-
-        case 0: // NORTH (-Z)
-            ao[0] = vertex_ao(
-                is_ao_solid(x-1, y, z-1, c, adj_chunks),
-                is_ao_solid(x, y-1, z-1, c, adj_chunks),
-                is_ao_solid(x-1, y-1, z-1, c, adj_chunks));
-            ao[1] = vertex_ao(
-                is_ao_solid(x+1, y, z-1, c, adj_chunks),
-                is_ao_solid(x, y-1, z-1, c, adj_chunks),
-                is_ao_solid(x+1, y-1, z-1, c, adj_chunks));
-            ao[2] = vertex_ao(
-                is_ao_solid(x+1, y, z-1, c, adj_chunks),
-                is_ao_solid(x, y+1, z-1, c, adj_chunks),
-                is_ao_solid(x+1, y+1, z-1, c, adj_chunks));
-            ao[3] = vertex_ao(
-                is_ao_solid(x-1, y, z-1, c, adj_chunks),
-                is_ao_solid(x, y+1, z-1, c, adj_chunks),
-                is_ao_solid(x-1, y+1, z-1, c, adj_chunks));
-            break;
-
-        case 2: // SOUTH (+Z)
-            ao[0] = vertex_ao(
-                is_ao_solid(x-1, y, z+1, c, adj_chunks),
-                is_ao_solid(x, y-1, z+1, c, adj_chunks),
-                is_ao_solid(x-1, y-1, z+1, c, adj_chunks));
-            ao[1] = vertex_ao(
-                is_ao_solid(x+1, y, z+1, c, adj_chunks),
-                is_ao_solid(x, y-1, z+1, c, adj_chunks),
-                is_ao_solid(x+1, y-1, z+1, c, adj_chunks));
-            ao[2] = vertex_ao(
-                is_ao_solid(x+1, y, z+1, c, adj_chunks),
-                is_ao_solid(x, y+1, z+1, c, adj_chunks),
-                is_ao_solid(x+1, y+1, z+1, c, adj_chunks));
-            ao[3] = vertex_ao(
-                is_ao_solid(x-1, y, z+1, c, adj_chunks),
-                is_ao_solid(x, y+1, z+1, c, adj_chunks),
-                is_ao_solid(x-1, y+1, z+1, c, adj_chunks));
-            break;
-
-        case 1: // WEST (+X)
-            ao[0] = vertex_ao(
-                is_ao_solid(x+1, y, z-1, c, adj_chunks),
-                is_ao_solid(x+1, y-1, z, c, adj_chunks),
-                is_ao_solid(x+1, y-1, z-1, c, adj_chunks));
-            ao[1] = vertex_ao(
-                is_ao_solid(x+1, y, z+1, c, adj_chunks),
-                is_ao_solid(x+1, y-1, z, c, adj_chunks),
-                is_ao_solid(x+1, y-1, z+1, c, adj_chunks));
-            ao[2] = vertex_ao(
-                is_ao_solid(x+1, y, z+1, c, adj_chunks),
-                is_ao_solid(x+1, y+1, z, c, adj_chunks),
-                is_ao_solid(x+1, y+1, z+1, c, adj_chunks));
-            ao[3] = vertex_ao(
-                is_ao_solid(x+1, y, z-1, c, adj_chunks),
-                is_ao_solid(x+1, y+1, z, c, adj_chunks),
-                is_ao_solid(x+1, y+1, z-1, c, adj_chunks));
-            break;
-
-        case 3: // EAST (-X)
-            ao[0] = vertex_ao(
-                is_ao_solid(x-1, y, z-1, c, adj_chunks),
-                is_ao_solid(x-1, y-1, z, c, adj_chunks),
-                is_ao_solid(x-1, y-1, z-1, c, adj_chunks));
-            ao[1] = vertex_ao(
-                is_ao_solid(x-1, y, z+1, c, adj_chunks),
-                is_ao_solid(x-1, y-1, z, c, adj_chunks),
-                is_ao_solid(x-1, y-1, z+1, c, adj_chunks));
-            ao[2] = vertex_ao(
-                is_ao_solid(x-1, y, z+1, c, adj_chunks),
-                is_ao_solid(x-1, y+1, z, c, adj_chunks),
-                is_ao_solid(x-1, y+1, z+1, c, adj_chunks));
-            ao[3] = vertex_ao(
-                is_ao_solid(x-1, y, z-1, c, adj_chunks),
-                is_ao_solid(x-1, y+1, z, c, adj_chunks),
-                is_ao_solid(x-1, y+1, z-1, c, adj_chunks));
-            break;
-
-        default:
-            ao[0] = ao[1] = ao[2] = ao[3] = 3;  // No occlusion
-            break;
+int calculate_face_ao(int x, int y, int z, int face, const ao_grid* grid) {
+    if (grid == NULL || face < 0 || face >= 6) {
+        return AO_NONE;  // No occlusion
+    }
+
+    const int* normal = face_axes[face][0];
+    const int* u = face_axes[face][1];
+    const int* v = face_axes[face][2];
+
+    int px = x + normal[0];
+    int py = y + normal[1];
+    int pz = z + normal[2];
+
+    int mask = 0;
+    for (int b = 0; b < 8; b++) {
+        int du = mask_offsets[b][0];
+        int dv = mask_offsets[b][1];
+        int nx = px + du * u[0] + dv * v[0];
+        int ny = py + du * u[1] + dv * v[1];
+        int nz = pz + du * u[2] + dv * v[2];
+        mask |= grid_solid(grid, nx, ny, nz) << b;
     }
 
-    // Pack 4 AO values into single int (2 bits each)
-    return ao[0] | (ao[1] << 2) | (ao[2] << 4) | (ao[3] << 6);
+    return ao_mask_table[mask];
 }
@@ -2,9 +2,25 @@
 #define AMBIENT_OCCLUSION_H
 
 #include <chunk.h>
+#include <stdint.h>
+
+// AO packed with every vertex fully lit
+#define AO_NONE 0xFF
+
+#define AO_GRID_WIDTH (CHUNK_SIZE + 2)
+#define AO_GRID_HEIGHT (CHUNK_HEIGHT + 2)
+#define AO_GRID_BITS (AO_GRID_WIDTH * AO_GRID_HEIGHT * AO_GRID_WIDTH)
+
+// One bit per block of a chunk padded by one block on every side, set when
+// the block occludes light. Built once per mesh so AO never touches block data.
+typedef struct {
+    uint8_t bits[(AO_GRID_BITS + 7) / 8];
+} ao_grid;
+
+void build_ao_grid(ao_grid* grid, chunk* c, chunk* adj_chunks[4]);
 
 // Calculate AO for all 4 vertices of a face.
 // Returns packed int with 4 AO values (2 bits each): v0 | (v1 << 2) | (v2 << 4) | (v3 << 6)
-int calculate_face_ao(int x, int y, int z, int face, chunk* c, chunk* adj_chunks[4]);
+int calculate_face_ao(int x, int y, int z, int face, const ao_grid* grid);
 
 #endif
@@ -2,19 +2,31 @@
 #include "../../world/core/block.h"
 #include "util/sort.h"
 #include "../../world/core/chunk.h"
+#include "../../world/core/chunk_lod.h"
 #include "mesh.h"
 #include "util/settings.h"
 #include <assert.h>
 #include <pthread.h>
-#include <unistd.h>
+#include <stdatomic.h>
 
-pthread_mutex_t cm_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Recursive, meshes built while it is held publish under it again
+pthread_mutex_t cm_mutex;
+static pthread_once_t cm_mutex_once = PTHREAD_ONCE_INIT;
 
-pthread_t cm_updater_thread = 0;
+static atomic_uint cm_mesh_version = 0;
 
 static camera_cache cm_camera_cache = {0, 0, 0, 0, 0};
 
+static void init_cm_mutex(void) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&cm_mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
 void lock_mesh() {
+    pthread_once(&cm_mutex_once, init_cm_mutex);
     pthread_mutex_lock(&cm_mutex);
 }
 
@@ -30,26 +42,22 @@ void init_chunk_mesh(camera* camera) {
     cm_camera_cache.pitch = camera->pitch;
 }
 
-int chunk_coord_equals(void* a, void* b) {
-    chunk_coord* c1 = (chunk_coord*)a;
-    chunk_coord* c2 = (chunk_coord*)b;
+uint64_t chunk_work_key(int x, int z) {
+    return ((uint64_t)(uint32_t)x << 32) | (uint32_t)z;
+}
 
-    return c1->x == c2->x && c1->z == c2->z;
+uint64_t chunk_coord_queue_key(const void* item) {
+    const chunk_coord* coord = (const chunk_coord*)item;
+    return chunk_work_key(coord->x, coord->z);
 }
 
-int chunk_mesh_equals(void* a, void* b) {
-    if (a == NULL || b == NULL) {
-        return a == NULL && b == NULL;
-    }
-    chunk_mesh* c1 = (chunk_mesh*)a;
-    chunk_mesh* c2 = (chunk_mesh*)b;
-    return c1->x == c2->x && c1->z == c2->z;
+uint64_t chunk_mesh_queue_key(const void* item) {
+    const chunk_mesh* mesh = *(chunk_mesh* const*)item;
+    return chunk_work_key(mesh->x, mesh->z);
 }
 
-int chunk_work_item_equals(void* a, void* b) {
-    chunk_work_item* w1 = (chunk_work_item*)a;
-    chunk_work_item* w2 = (chunk_work_item*)b;
-    return w1->x == w2->x && w1->z == w2->z;
+unsigned int next_chunk_mesh_version(void) {
+    return atomic_fetch_add_explicit(&cm_mesh_version, 1, memory_order_relaxed) + 1;
 }
 
 // Hash function for LOD-aware cache key
@@ -71,22 +79,21 @@ int chunk_mesh_key_equals(chunk_mesh_key a, chunk_mesh_key b) {
 float distance_to_camera(const void* item) {
     side_instance* side = (side_instance*)item;
 
-    // multiply by -1 to sort in descending order (back-to-front)
-    return -1.0f * sqrt(
-        pow((float)(side->x) - cm_camera_cache.x, 2) +
-        pow((float)(side->y) - cm_camera_cache.y, 2) +
-        pow((float)(side->z) - cm_camera_cache.z, 2)
-    );
+    float dx = (float)(side->x) - cm_camera_cache.x;
+    float dy = (float)(side->y) - cm_camera_cache.y;
+    float dz = (float)(side->z) - cm_camera_cache.z;
+
+    // squared distance sorts the same, multiply by -1 to sort in descending order (back-to-front)
+    return -1.0f * (dx * dx + dy * dy + dz * dz);
 }
 
 float liquid_distance_to_camera(const void* item) {
     side_instance* side = (side_instance*)item;
 
-    float dist = sqrt(
-        pow((float)(side->x) - cm_camera_cache.x, 2) +
-        pow((float)(side->y) - cm_camera_cache.y, 2) +
-        pow((float)(side->z) - cm_camera_cache.z, 2)
-    );
+    float dx = (float)(side->x) - cm_camera_cache.x;
+    float dy = (float)(side->y) - cm_camera_cache.y;
+    float dz = (float)(side->z) - cm_camera_cache.z;
+    float dist = dx * dx + dy * dy + dz * dz;
 
     // Above water: sort front-to-back (positive) so closer water renders first
     // Below water: sort back-to-front (negative) so distant water renders first
@@ -105,11 +112,11 @@ float chunk_distance_to_camera(const void* item) {
     float chunk_center_x = CHUNK_POS_TO_WORLD_CENTER_POS(mesh->x);
     float chunk_center_z = CHUNK_POS_TO_WORLD_CENTER_POS(mesh->z);
 
+    float dx = chunk_center_x - cm_camera_cache.x;
+    float dz = chunk_center_z - cm_camera_cache.z;
+
     // multiply by -1 to sort in descending order (back-to-front)
-    return -1.0f * sqrt(
-        pow(chunk_center_x - cm_camera_cache.x, 2) +
-        pow(chunk_center_z - cm_camera_cache.z, 2)
-    );
+    return -1.0f * (dx * dx + dz * dz);
 }
 
 void chunk_mesh_to_buffer(int* head, side_instance* sides, int num_sides, int lod_scale) {
@@ -132,32 +139,33 @@ void chunk_mesh_to_buffer(int* head, side_instance* sides, int num_sides, int lo
     }
 }
 
-void custom_vert_to_buffer(float* head, float* custom_verts, int num_custom_verts) {
-    for (int i = 0; i < num_custom_verts; i++) {
-        int index = i * FLOATS_PER_MODEL_VERT;
-
-        for (int j = 0; j < FLOATS_PER_MODEL_VERT; j++) {
-            head[index + j] = custom_verts[index + j];
-        }
-    }
-}
-
 void sort_transparent_sides(chunk_mesh* packet) {
-    quicksort(packet->transparent_sides, packet->num_transparent_sides, sizeof(side_instance), distance_to_camera);
+    // Faces stay sorted between ticks, only the camera moved
+    sort_incremental(packet->transparent_sides, packet->num_transparent_sides, sizeof(side_instance), distance_to_camera);
 }
 
 void sort_liquid_sides(chunk_mesh* packet) {
-    quicksort(packet->liquid_sides, packet->num_liquid_sides, sizeof(side_instance), liquid_distance_to_camera);
+    sort_incremental(packet->liquid_sides, packet->num_liquid_sides, sizeof(side_instance), liquid_distance_to_camera);
 }
 
-void get_chunk_meshes(game_data* args) {
+// Chunk the player was in when the current tick started
+static int cm_tick_chunk_x = 0;
+static int cm_tick_chunk_z = 0;
+static int cm_tick_moved_blocks = 0;
+
+void update_chunk_lods(game_data* args) {
     int x = args->x;
     int z = args->z;
 
-    int player_chunk_x = WORLD_POS_TO_CHUNK_POS(x);
-    int player_chunk_z = WORLD_POS_TO_CHUNK_POS(z);
+    int moved_chunks = WORLD_POS_TO_CHUNK_POS(x) != cm_tick_chunk_x || WORLD_POS_TO_CHUNK_POS(z) != cm_tick_chunk_z;
+    cm_tick_chunk_x = WORLD_POS_TO_CHUNK_POS(x);
+    cm_tick_chunk_z = WORLD_POS_TO_CHUNK_POS(z);
 
-    int movedBlocks = ((int)x == (int)(cm_camera_cache.x) && (int)z == (int)(cm_camera_cache.z)) ? 0 : 1;
+    // Seam lookups read pyramids one chunk past render distance
+    if (moved_chunks) {
+        evict_chunk_lods(cm_tick_chunk_x, cm_tick_chunk_z, CHUNK_RENDER_DISTANCE + 1);
+    }
+    cm_tick_moved_blocks = ((int)x == (int)(cm_camera_cache.x) && (int)z == (int)(cm_camera_cache.z)) ? 0 : 1;
 
     // Update camera cache for sorting
     cm_camera_cache.x = args->x;
@@ -169,10 +177,10 @@ void get_chunk_meshes(game_data* args) {
         return;
     }
 
-    chunk_mesh** packet = NULL;
-    int count = 0;
+    int player_chunk_x = cm_tick_chunk_x;
+    int player_chunk_z = cm_tick_chunk_z;
 
-    // First pass: handle LOD updates (expensive, done without holding lock)
+    // Handle LOD updates (expensive, done without holding lock)
     for (int i = 0; i < 2 * CHUNK_RENDER_DISTANCE; i++) {
         for (int j = 0; j < 2 * CHUNK_RENDER_DISTANCE; j++) {
             int cx = player_chunk_x - CHUNK_RENDER_DISTANCE + i;
@@ -188,7 +196,7 @@ void get_chunk_meshes(game_data* args) {
                 short current_lod = mesh->lod_scale;
                 short new_lod = calculate_lod(cx, cz, args->x, args->z);
 
-                if (new_lod != current_lod) {
+                if (new_lod != current_lod || chunk_mesh_seams_stale(mesh, args->x, args->z)) {
                     update_chunk_mesh(cx, cz, args->player.position[0], args->player.position[2]);
                     args->mesh_requires_update = TRUE;
                 }
@@ -196,8 +204,20 @@ void get_chunk_meshes(game_data* args) {
             unlock_mesh();
         }
     }
+}
 
-    // Second pass: collect meshes into packet array while holding lock
+void collect_chunk_meshes(game_data* args) {
+    if (args->mesh_refresh_paused) {
+        return;
+    }
+
+    int player_chunk_x = cm_tick_chunk_x;
+    int player_chunk_z = cm_tick_chunk_z;
+
+    chunk_mesh** packet = NULL;
+    int count = 0;
+
+    // Collect meshes into packet array while holding lock
     lock_mesh();
 
     for (int i = 0; i < 2 * CHUNK_RENDER_DISTANCE; i++) {
@@ -223,47 +243,20 @@ void get_chunk_meshes(game_data* args) {
                 && cx <= player_chunk_x + 1
                 && cz >= player_chunk_z - 1
                 && cz <= player_chunk_z + 1
-                && movedBlocks) {
+                && cm_tick_moved_blocks) {
                 queue_chunk_for_sorting(mesh, player_chunk_x, player_chunk_z);
             }
         }
     }
 
-    quicksort(packet, count, sizeof(chunk_mesh*), chunk_distance_to_camera);
+    radix_sort(packet, count, sizeof(chunk_mesh*), chunk_distance_to_camera);
 
     if (args->num_packets == NULL) {
         args->num_packets = malloc(sizeof(int));
     }
     *args->num_packets = count;
+    free(args->packet);
     args->packet = packet;
 
     unlock_mesh();
-
-    sort_chunk();
-    load_chunk(args->player.position[0], args->player.position[2]);
-}
-
-void update_chunk_meshes(game_data* data) {
-    if (data == NULL) {
-        assert(false && "game_data pointer is NULL\n");
-    }
-
-    while(data->is_running) {
-        get_chunk_meshes(data);
-        usleep(TICK_RATE);
-    }
-
-    return;
-}
-
-void start_chunk_mesh_updater(game_data* data) {
-    if (data == NULL) {
-        assert(false && "game_data pointer is NULL\n");
-    }
-    pthread_create(&cm_updater_thread, NULL, (void* (*)(void*))update_chunk_meshes, data);
-}
-
-void kill_chunk_mesh_updater(void) {
-    pthread_join(cm_updater_thread, NULL);
-    pthread_mutex_destroy(&cm_mutex);
 }
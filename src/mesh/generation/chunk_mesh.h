@@ -5,6 +5,7 @@
 #include <player/core/player.h>
 #include <game_data.h>
 #include <util.h>
+#include <stdint.h>
 
 
 // Cache key that includes both chunk coordinate and LOD level
@@ -14,12 +15,10 @@ typedef struct {
     short lod;
 } chunk_mesh_key;
 
-// Work item for chunk mesh generation in worker pool
+// Work item for chunk mesh generation in worker pool. It is meshed for
+// wherever the player is when it runs.
 typedef struct {
     int x, z;
-    float player_x, player_z;
-    chunk_mesh* result_mesh;
-    int work_complete;
 } chunk_work_item;
 
 // Hash and equality functions for LOD-aware cache key
@@ -27,15 +26,19 @@ uint chunk_mesh_key_hash(chunk_mesh_key k);
 int chunk_mesh_key_equals(chunk_mesh_key a, chunk_mesh_key b);
 
 void init_chunk_mesh(camera* camera);
-int chunk_mesh_equals(void* a, void* b);
-int chunk_work_item_equals(void* a, void* b);
+// Dedupe key for queued mesh work on chunk x, z
+uint64_t chunk_work_key(int x, int z);
+// Queue keys for a queued chunk_coord and a queued chunk_mesh pointer
+uint64_t chunk_coord_queue_key(const void* item);
+uint64_t chunk_mesh_queue_key(const void* item);
+// Fresh value for chunk_mesh.layer_versions, never repeats
+unsigned int next_chunk_mesh_version(void);
 void chunk_mesh_to_buffer(int* head, side_instance* sides, int num_sides, int lod_scale);
-void custom_vert_to_buffer(float* head, float* custom_verts, int num_custom_verts);
 void sort_transparent_sides(chunk_mesh* packet);
 void sort_liquid_sides(chunk_mesh* packet);
-void get_chunk_meshes(game_data* args);
-void start_chunk_mesh_updater(game_data* args);
-void kill_chunk_mesh_updater(void);
+// Tick stages, see mesh_pipeline.c
+void update_chunk_lods(game_data* args);
+void collect_chunk_meshes(game_data* args);
 
 void lock_mesh();
 void unlock_mesh();
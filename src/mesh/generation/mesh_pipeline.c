@@ -0,0 +1,116 @@
+#include "mesh_pipeline.h"
+#include "chunk_mesh.h"
+#include "world_mesh.h"
+#include "mesh.h"
+#include "../core/job_graph.h"
+#include "util/settings.h"
+#include "util/thread_event.h"
+#include <assert.h>
+#include <pthread.h>
+
+// Safety net, a tick still runs this often when nothing notified
+#define MESH_PIPELINE_IDLE_TIMEOUT_MS 500
+
+static pthread_t pipeline_thread = 0;
+static job_graph* tick_graph = NULL;
+
+static thread_event pipeline_event = THREAD_EVENT_INITIALIZER;
+static thread_usage pipeline_usage = THREAD_USAGE_INITIALIZER("mesh_pipeline");
+
+// Camera as of the last notify_mesh_camera, only touched by the render thread
+static camera_cache notified_camera = {0, 0, 0, 0, 0};
+
+static void lod_stage(void* ctx) {
+    update_chunk_lods((game_data*)ctx);
+}
+
+static void visibility_stage(void* ctx) {
+    collect_chunk_meshes((game_data*)ctx);
+}
+
+static void sort_stage(void* ctx) {
+    game_data* data = (game_data*)ctx;
+    if (!data->mesh_refresh_paused) {
+        while (sort_chunk()) {
+        }
+    }
+}
+
+static void mesh_jobs_stage(void* ctx) {
+    game_data* data = (game_data*)ctx;
+    if (!data->mesh_refresh_paused) {
+        load_chunk(data->player.position[0], data->player.position[2]);
+    }
+}
+
+static void assembly_stage(void* ctx) {
+    game_data* data = (game_data*)ctx;
+    // Skip update if no chunks are available yet
+    if (data->packet != NULL) {
+        get_world_mesh(data);
+    }
+}
+
+static void* run_mesh_pipeline(void* arg) {
+    game_data* data = (game_data*)arg;
+
+    thread_usage_begin(&pipeline_usage);
+    while (data->is_running) {
+        graph_run(tick_graph);
+        event_wait(&pipeline_event, MESH_PIPELINE_IDLE_TIMEOUT_MS, &pipeline_usage);
+    }
+    thread_usage_end(&pipeline_usage);
+
+    return NULL;
+}
+
+void start_mesh_pipeline(game_data* data) {
+    if (data == NULL) {
+        assert(false && "game_data pointer is NULL\n");
+    }
+
+    tick_graph = graph_create(get_mesh_worker_pool());
+    assert(tick_graph != NULL && "Failed to create mesh tick graph");
+
+    int lod = graph_add(tick_graph, "lod", lod_stage, data);
+    int visibility = graph_add(tick_graph, "visibility", visibility_stage, data);
+    int sort = graph_add(tick_graph, "sort", sort_stage, data);
+    int mesh_jobs = graph_add(tick_graph, "mesh_jobs", mesh_jobs_stage, data);
+    int assembly = graph_add(tick_graph, "assembly", assembly_stage, data);
+
+    graph_depends(tick_graph, visibility, lod);
+    graph_depends(tick_graph, sort, visibility);
+    graph_depends(tick_graph, mesh_jobs, visibility);
+    // Sorting reorders faces in place, assembly copies them
+    graph_depends(tick_graph, assembly, sort);
+
+    thread_usage_register(&pipeline_usage);
+    pthread_create(&pipeline_thread, NULL, run_mesh_pipeline, data);
+}
+
+void kill_mesh_pipeline(void) {
+    // is_running is already cleared, wake the thread so it sees it
+    notify_mesh_pipeline();
+    pthread_join(pipeline_thread, NULL);
+    graph_free(tick_graph);
+    tick_graph = NULL;
+}
+
+void notify_mesh_pipeline(void) {
+    event_notify(&pipeline_event);
+}
+
+void notify_mesh_camera(camera* cam) {
+    int moved = (int)cam->position[0] != (int)notified_camera.x
+        || (int)cam->position[1] != (int)notified_camera.y
+        || (int)cam->position[2] != (int)notified_camera.z;
+    // Turning only changes what the render thread culls, nothing to mesh
+    if (!moved) {
+        return;
+    }
+
+    notified_camera.x = cam->position[0];
+    notified_camera.y = cam->position[1];
+    notified_camera.z = cam->position[2];
+    notify_mesh_pipeline();
+}
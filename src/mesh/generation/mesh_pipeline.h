@@ -0,0 +1,20 @@
+#ifndef MESH_PIPELINE_H
+#define MESH_PIPELINE_H
+
+#include <game_data.h>
+#include <player/core/camera.h>
+
+// Runs a mesh tick as a graph of dependent stages on the chunk worker pool:
+// LOD updates, collecting the visible chunks, then sorting and queueing
+// missing chunks in parallel, then assembling the world mesh.
+void start_mesh_pipeline(game_data* data);
+void kill_mesh_pipeline(void);
+
+// Ticks only run when something changed. Call after edits, finished chunk
+// meshes, chunks from the network or anything else the meshes depend on.
+void notify_mesh_pipeline(void);
+
+// Notifies the pipeline if the camera moved to another block since the last call
+void notify_mesh_camera(camera* cam);
+
+#endif
@@ -4,131 +4,141 @@
 #include <math.h>
 #include <string.h>
 #include "util/sort.h"
+#include "util/dedupe_queue.h"
 #include <util.h>
 #include "mesh.h"
-#include <pthread.h>
-#include <unistd.h>
-
-static pthread_mutex_t wm_mutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_t wm_updater_thread = 0;
+#include "../geometry/blockbench_loader.h"
 
 static camera_cache wm_camera_cache = {0, 0, 0, 0, 0};
 
-#define WORLD_MESH_ROTATION_EPSILON 0.01f
-#define WORLD_MESH_CULL_PADDING 2.0f
-#define WORLD_MESH_NEARBY_CHUNK_BYPASS 1
-
 static int world_mesh_camera_changed(camera* camera, int x, int z) {
+    // Turning is handled by culling on the render thread
     int moved_blocks = ((int)x == (int)wm_camera_cache.x && (int)z == (int)wm_camera_cache.z) ? 0 : 1;
     int moved_vertical = ((int)camera->position[1] == (int)wm_camera_cache.y) ? 0 : 1;
-    int rotated = fabsf(camera->yaw - wm_camera_cache.yaw) > WORLD_MESH_ROTATION_EPSILON
-        || fabsf(camera->pitch - wm_camera_cache.pitch) > WORLD_MESH_ROTATION_EPSILON;
 
-    if (moved_blocks || moved_vertical || rotated) {
+    if (moved_blocks || moved_vertical) {
         wm_camera_cache.x = camera->position[0];
         wm_camera_cache.y = camera->position[1];
         wm_camera_cache.z = camera->position[2];
-        wm_camera_cache.yaw = camera->yaw;
-        wm_camera_cache.pitch = camera->pitch;
         return 1;
     }
 
     return 0;
 }
 
-static int is_chunk_near_camera(int chunk_x, int chunk_z, int player_chunk_x, int player_chunk_z) {
-    return abs(chunk_x - player_chunk_x) <= WORLD_MESH_NEARBY_CHUNK_BYPASS
-        && abs(chunk_z - player_chunk_z) <= WORLD_MESH_NEARBY_CHUNK_BYPASS;
+// Packed layers of a chunk, kept between world meshes so a layer is only
+// packed again after the mesher or the sorter changed it
+typedef struct {
+    int x, z;
+    packed_sides* layers[MESH_LAYER_COUNT];
+    unsigned int tick;  // last world mesh the chunk was part of
+} packed_chunk;
+
+static packed_chunk* packed_chunks = NULL;
+static int num_packed_chunks = 0;
+static int packed_chunk_capacity = 0;
+static key_index packed_chunk_index;  // chunk_work_key -> index into packed_chunks
+static unsigned int packed_tick = 0;
+
+static int get_chunk_mesh_layer(chunk_mesh* mesh, mesh_layer layer, side_instance** sides) {
+    switch (layer) {
+        case MESH_LAYER_OPAQUE:
+            *sides = mesh->opaque_sides;
+            return mesh->num_opaque_sides;
+        case MESH_LAYER_TRANSPARENT:
+            *sides = mesh->transparent_sides;
+            return mesh->num_transparent_sides;
+        case MESH_LAYER_LIQUID:
+            *sides = mesh->liquid_sides;
+            return mesh->num_liquid_sides;
+        case MESH_LAYER_FOLIAGE:
+            *sides = mesh->foliage_sides;
+            return mesh->num_foliage_sides;
+        default:
+            *sides = NULL;
+            return 0;
+    }
 }
 
-static int chunk_intersects_camera_frustum(camera* camera, int chunk_x, int chunk_z) {
-    mat4 view;
-    mat4 proj;
-    mat4 view_proj;
-    vec4 planes[6];
-
-    vec3 box[2] = {
-        {
-            (float)(chunk_x * CHUNK_SIZE) - WORLD_MESH_CULL_PADDING,
-            0.0f - WORLD_MESH_CULL_PADDING,
-            (float)(chunk_z * CHUNK_SIZE) - WORLD_MESH_CULL_PADDING
-        },
-        {
-            (float)((chunk_x + 1) * CHUNK_SIZE) + WORLD_MESH_CULL_PADDING,
-            (float)CHUNK_HEIGHT + WORLD_MESH_CULL_PADDING,
-            (float)((chunk_z + 1) * CHUNK_SIZE) + WORLD_MESH_CULL_PADDING
-        }
-    };
-
-    get_view_matrix(*camera, &view);
-    get_projection_matrix(&proj, RADS(FOV), (float)WIDTH / (float)HEIGHT, 0.1f, RENDER_DISTANCE);
-    glm_mat4_mul(proj, view, view_proj);
-    glm_frustum_planes(view_proj, planes);
+static packed_sides* pack_sides(side_instance* sides, int num_sides, int lod_scale, unsigned int version,
+    side_buckets* buckets) {
+    if (sides == NULL || num_sides <= 0) {
+        return NULL;
+    }
 
-    return glm_aabb_frustum(box, planes);
+    packed_sides* packed = malloc(sizeof(packed_sides) + (size_t)num_sides * VBO_WIDTH * sizeof(int));
+    assert(packed != NULL && "ERROR: Could not allocate memory for packed sides.\n");
+    atomic_init(&packed->refs, 1);
+    packed->version = version;
+    packed->num_sides = num_sides;
+    packed->buckets = *buckets;
+    chunk_mesh_to_buffer(packed->data, sides, num_sides, lod_scale);
+    return packed;
 }
 
-// Deep copy a chunk_mesh and all its dynamically allocated data
-static chunk_mesh* copy_chunk_mesh(chunk_mesh* src) {
-    if (src == NULL) {
-        return NULL;
-    }
-    
-    chunk_mesh* dst = malloc(sizeof(chunk_mesh));
-    assert(dst != NULL && "ERROR: Could not allocate memory for chunk_mesh copy.\n");
-    
-    // Copy structure fields
-    dst->x = src->x;
-    dst->z = src->z;
-    dst->num_opaque_sides = src->num_opaque_sides;
-    dst->num_transparent_sides = src->num_transparent_sides;
-    dst->num_liquid_sides = src->num_liquid_sides;
-    dst->num_foliage_sides = src->num_foliage_sides;
-    dst->num_custom_verts = src->num_custom_verts;
-    dst->lod_scale = src->lod_scale;
-    
-    // Deep copy dynamic arrays
-    if (src->opaque_sides != NULL && src->num_opaque_sides > 0) {
-        dst->opaque_sides = malloc(src->num_opaque_sides * sizeof(side_instance));
-        assert(dst->opaque_sides != NULL && "ERROR: Could not allocate memory for opaque_sides copy.\n");
-        memcpy(dst->opaque_sides, src->opaque_sides, src->num_opaque_sides * sizeof(side_instance));
-    } else {
-        dst->opaque_sides = NULL;
-    }
-    
-    if (src->transparent_sides != NULL && src->num_transparent_sides > 0) {
-        dst->transparent_sides = malloc(src->num_transparent_sides * sizeof(side_instance));
-        assert(dst->transparent_sides != NULL && "ERROR: Could not allocate memory for transparent_sides copy.\n");
-        memcpy(dst->transparent_sides, src->transparent_sides, src->num_transparent_sides * sizeof(side_instance));
-    } else {
-        dst->transparent_sides = NULL;
-    }
-    
-    if (src->liquid_sides != NULL && src->num_liquid_sides > 0) {
-        dst->liquid_sides = malloc(src->num_liquid_sides * sizeof(side_instance));
-        assert(dst->liquid_sides != NULL && "ERROR: Could not allocate memory for liquid_sides copy.\n");
-        memcpy(dst->liquid_sides, src->liquid_sides, src->num_liquid_sides * sizeof(side_instance));
+// Bring the packed copy of mesh up to date, packing only the layers whose
+// version moved. Called with the mesh lock held.
+static packed_chunk* update_packed_chunk(chunk_mesh* mesh) {
+    uint64_t key = chunk_work_key(mesh->x, mesh->z);
+    uint64_t index;
+    packed_chunk* packed;
+
+    if (key_index_get(&packed_chunk_index, key, &index)) {
+        packed = &packed_chunks[index];
     } else {
-        dst->liquid_sides = NULL;
+        if (num_packed_chunks == packed_chunk_capacity) {
+            packed_chunk_capacity = packed_chunk_capacity > 0 ? packed_chunk_capacity * 2 : 256;
+            packed_chunks = realloc(packed_chunks, packed_chunk_capacity * sizeof(packed_chunk));
+            assert(packed_chunks != NULL && "ERROR: Could not grow packed chunk cache.\n");
+        }
+        key_index_put(&packed_chunk_index, key, (uint64_t)num_packed_chunks);
+        packed = &packed_chunks[num_packed_chunks++];
+        memset(packed, 0, sizeof(packed_chunk));
+        packed->x = mesh->x;
+        packed->z = mesh->z;
     }
-    
-    if (src->foliage_sides != NULL && src->num_foliage_sides > 0) {
-        dst->foliage_sides = malloc(src->num_foliage_sides * sizeof(side_instance));
-        assert(dst->foliage_sides != NULL && "ERROR: Could not allocate memory for foliage_sides copy.\n");
-        memcpy(dst->foliage_sides, src->foliage_sides, src->num_foliage_sides * sizeof(side_instance));
-    } else {
-        dst->foliage_sides = NULL;
+
+    for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+        side_instance* sides;
+        int num_sides = get_chunk_mesh_layer(mesh, (mesh_layer)layer, &sides);
+        packed_sides* current = packed->layers[layer];
+        int up_to_date = current != NULL
+            ? current->version == mesh->layer_versions[layer]
+            : num_sides == 0;
+        if (up_to_date) {
+            continue;
+        }
+        release_packed_sides(current);
+        packed->layers[layer] = pack_sides(sides, num_sides, mesh->lod_scale, mesh->layer_versions[layer],
+            &mesh->buckets[layer]);
     }
-    
-    if (src->custom_model_data != NULL && src->num_custom_verts > 0) {
-        dst->custom_model_data = malloc(src->num_custom_verts * FLOATS_PER_MODEL_VERT * sizeof(float));
-        assert(dst->custom_model_data != NULL && "ERROR: Could not allocate memory for custom_model_data copy.\n");
-        memcpy(dst->custom_model_data, src->custom_model_data, src->num_custom_verts * FLOATS_PER_MODEL_VERT * sizeof(float));
-    } else {
-        dst->custom_model_data = NULL;
+
+    packed->tick = packed_tick;
+    return packed;
+}
+
+// Drop chunks that left render distance, world meshes still holding their
+// layers keep them alive
+static void evict_packed_chunks(void) {
+    int i = 0;
+    while (i < num_packed_chunks) {
+        packed_chunk* packed = &packed_chunks[i];
+        if (packed->tick == packed_tick) {
+            i++;
+            continue;
+        }
+
+        for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+            release_packed_sides(packed->layers[layer]);
+        }
+        key_index_remove(&packed_chunk_index, chunk_work_key(packed->x, packed->z));
+
+        num_packed_chunks--;
+        if (i < num_packed_chunks) {
+            *packed = packed_chunks[num_packed_chunks];
+            key_index_put(&packed_chunk_index, chunk_work_key(packed->x, packed->z), (uint64_t)i);
+        }
     }
-    
-    return dst;
 }
 
 void init_world_mesh(camera* camera) {
@@ -137,156 +147,46 @@ void init_world_mesh(camera* camera) {
     wm_camera_cache.z = camera->position[2];
     wm_camera_cache.yaw = camera->yaw;
     wm_camera_cache.pitch = camera->pitch;
+    key_index_init(&packed_chunk_index);
     init_chunk_mesh(camera);
 }
 
-world_mesh* create_world_mesh(chunk_mesh** packet, int count) {
-    assert(count >= 0 && "Count cannot be negative\n");
-    assert(packet != NULL || count == 0);
-
-    // First pass: Calculate total memory needed
-    int total_transparent_sides = 0;
-    int total_foliage_sides = 0;
-    int total_opaque_sides = 0;
-    int total_liquid_sides = 0;
-    int total_custom_verts = 0;
+// Copy the model instances of the chunks, grouped by model so each model is
+// one instanced draw
+static void gather_model_instances(world_mesh* world, chunk_mesh** meshes, int count) {
+    int total_model_instances = 0;
     for (int i = 0; i < count; i++) {
-        chunk_mesh* mesh = packet[i];
-        if (mesh == NULL) {
-            continue;
-        }
-        if (mesh->num_custom_verts > 786432)
-            printf("sus!\n");
-        total_transparent_sides += mesh->num_transparent_sides;
-        total_opaque_sides += mesh->num_opaque_sides;
-        total_liquid_sides += mesh->num_liquid_sides;
-        total_foliage_sides += mesh->num_foliage_sides;
-        total_custom_verts += mesh->num_custom_verts;
+        total_model_instances += meshes[i]->num_model_instances;
     }
-
-    // Allocate all memory at once
-    int* transparent_data = total_transparent_sides > 0
-        ? malloc(total_transparent_sides * VBO_WIDTH * sizeof(int))
-        : NULL;
-    int* opaque_data = total_opaque_sides > 0
-        ? malloc(total_opaque_sides * VBO_WIDTH * sizeof(int))
-        : NULL;
-    int* liquid_data = total_liquid_sides > 0
-        ? malloc(total_liquid_sides * VBO_WIDTH * sizeof(int))
-        : NULL;
-    int* foliage_data = total_foliage_sides > 0
-        ? malloc(total_foliage_sides * VBO_WIDTH * sizeof(int))
-        : NULL;
-    float* custom_model_data = total_custom_verts > 0
-        ? malloc(total_custom_verts * sizeof(float) * FLOATS_PER_MODEL_VERT)
-        : NULL;
-
-    // Check for allocation failure
-    if ((total_transparent_sides > 0 && !transparent_data)
-        || (total_opaque_sides > 0 && !opaque_data)
-        || (total_liquid_sides > 0 && !liquid_data)
-        || (total_foliage_sides > 0 && !foliage_data)
-        || (total_custom_verts > 0 && !custom_model_data)) {
-        free(transparent_data);
-        free(opaque_data);
-        free(liquid_data);
-        free(foliage_data);
-        free(custom_model_data);
-        assert(false && "Failed to allocate memory for world mesh data\n");
+    if (total_model_instances == 0) {
+        return;
     }
 
-    // Second pass: Copy data
-    int transparent_offset = 0;
-    int opaque_offset = 0;
-    int liquid_offset = 0;
-    int foliage_offset = 0;
-    int custom_model_offset = 0;
-    for (int i = 0; i < count; i++) {
-        chunk_mesh* mesh = packet[i];
+    int model_count = get_blockbench_model_count();
+    model_instance* model_instances = malloc(total_model_instances * sizeof(model_instance));
+    int* model_offsets = calloc(model_count + 1, sizeof(int));
+    assert(model_instances != NULL && model_offsets != NULL
+        && "Failed to allocate memory for world mesh model instances\n");
 
-        if (mesh == NULL) {
-            continue;
+    // Counting sort of the model instances by model id
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < meshes[i]->num_model_instances; j++) {
+            model_offsets[meshes[i]->model_instances[j].model_id + 1]++;
         }
-
-        chunk_mesh_to_buffer(transparent_data + transparent_offset, 
-            mesh->transparent_sides, 
-            mesh->num_transparent_sides,
-            mesh->lod_scale);
-        transparent_offset += mesh->num_transparent_sides * VBO_WIDTH;
-    
-        chunk_mesh_to_buffer(opaque_data + opaque_offset, 
-            mesh->opaque_sides, 
-            mesh->num_opaque_sides,
-            mesh->lod_scale);
-        opaque_offset += mesh->num_opaque_sides * VBO_WIDTH;
-    
-        chunk_mesh_to_buffer(liquid_data + liquid_offset, 
-            mesh->liquid_sides, 
-            mesh->num_liquid_sides,
-            mesh->lod_scale);
-        liquid_offset += mesh->num_liquid_sides * VBO_WIDTH;
-
-        chunk_mesh_to_buffer(foliage_data + foliage_offset,
-            mesh->foliage_sides,
-            mesh->num_foliage_sides,
-            mesh->lod_scale);
-        foliage_offset += mesh->num_foliage_sides * VBO_WIDTH;
-
-        custom_vert_to_buffer(custom_model_data + custom_model_offset, 
-            mesh->custom_model_data, 
-            mesh->num_custom_verts);
-        custom_model_offset += mesh->num_custom_verts * FLOATS_PER_MODEL_VERT;
     }
-
-    // Create the world mesh structure
-    world_mesh* world = malloc(sizeof(world_mesh));
-    if (!world) {
-        free(transparent_data);
-        free(opaque_data);
-        free(liquid_data);
-        free(foliage_data);
-        free(custom_model_data);
-        assert(false && "Failed to allocate memory for world mesh structure\n");
+    for (int m = 0; m < model_count; m++) {
+        model_offsets[m + 1] += model_offsets[m];
     }
-
-    // Assign the data and counts to the world mesh
-    world->transparent_data = transparent_data;
-    world->opaque_data = opaque_data;
-    world->liquid_data = liquid_data;
-    world->foliage_data = foliage_data;
-    world->num_transparent_sides = transparent_offset / VBO_WIDTH;
-    world->num_opaque_sides = opaque_offset / VBO_WIDTH;
-    world->num_liquid_sides = liquid_offset / VBO_WIDTH;
-    world->num_foliage_sides = foliage_offset / VBO_WIDTH;
-    world->custom_model_data = custom_model_data;
-    world->num_custom_verts = custom_model_offset / FLOATS_PER_MODEL_VERT;
-
-    return world;
-}
-
-void free_packets(chunk_mesh** packet, int packet_count) {
-    if (packet == NULL) {
-        printf("ERROR: Cannot free NULL world mesh packet.");
-        return;
-    }
-    for (int i = 0; i < packet_count; i++) {
-        if (packet[i] != NULL) {
-            chunk_mesh* p = packet[i];
-            if (p->opaque_sides)
-                free(p->opaque_sides);
-            if (p->transparent_sides)
-                free(p->transparent_sides);
-            if (p->liquid_sides)
-                free(p->liquid_sides);
-            if (p->foliage_sides)
-                free(p->foliage_sides);
-            if (p->custom_model_data)
-                free(p->custom_model_data);
-            free(p);
-            packet[i] = NULL;
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < meshes[i]->num_model_instances; j++) {
+            model_instance instance = meshes[i]->model_instances[j];
+            model_instances[model_offsets[instance.model_id]++] = instance;
         }
     }
-    free(packet);
+    free(model_offsets);
+
+    world->model_instances = model_instances;
+    world->num_model_instances = total_model_instances;
 }
 
 void get_world_mesh(game_data* args) {
@@ -320,68 +220,49 @@ void get_world_mesh(game_data* args) {
         return;
     }
 
-    chunk_mesh** packet = malloc(packet_count * sizeof(chunk_mesh*));
-    assert(packet != NULL && "ERROR: Could not allocate memory for chunk_mesh double buffer in world_mesh generation.\n");
-
-    int player_chunk_x = WORLD_POS_TO_CHUNK_POS(camera->position[0]);
-    int player_chunk_z = WORLD_POS_TO_CHUNK_POS(camera->position[2]);
-    int visible_count = 0;
-
-    // Deep copy only visible chunks while holding lock to avoid data races
+    world_mesh* world = calloc(1, sizeof(world_mesh));
+    world_mesh_chunk* chunks = malloc(packet_count * sizeof(world_mesh_chunk));
+    chunk_mesh** meshes = malloc(packet_count * sizeof(chunk_mesh*));
+    assert(world != NULL && chunks != NULL && meshes != NULL
+        && "ERROR: Could not allocate memory for world mesh generation.\n");
+    world->chunks = chunks;
+    packed_tick++;
+    world->version = packed_tick;
+
+    // Every chunk in range goes in, the renderer keeps their faces resident
+    // and culls them itself. Only layers that changed since the last world
+    // mesh are packed.
     for (int i = 0; i < packet_count; i++) {
         chunk_mesh* mesh = args->packet[i];
         if (mesh == NULL) {
             continue;
         }
 
-        if (!is_chunk_near_camera(mesh->x, mesh->z, player_chunk_x, player_chunk_z)
-            && !chunk_intersects_camera_frustum(camera, mesh->x, mesh->z)) {
-            continue;
+        packed_chunk* packed = update_packed_chunk(mesh);
+        world_mesh_chunk* chunk = &chunks[world->num_chunks];
+        chunk->x = mesh->x;
+        chunk->z = mesh->z;
+        memcpy(chunk->visibility, mesh->visibility, sizeof(chunk->visibility));
+        for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+            chunk->layers[layer] = retain_packed_sides(packed->layers[layer]);
+            if (packed->layers[layer] != NULL) {
+                world->num_sides[layer] += packed->layers[layer]->num_sides;
+            }
         }
-
-        packet[visible_count] = copy_chunk_mesh(mesh);
-        visible_count++;
+        meshes[world->num_chunks++] = mesh;
     }
 
+    gather_model_instances(world, meshes, world->num_chunks);
+
     unlock_mesh();
 
-    // Create world mesh outside lock with copied packet data
-    world_mesh* world = create_world_mesh(packet, visible_count);
-
-    if (!world) {
-        assert(false && "Failed to create world mesh\n");
-    }
+    free(meshes);
+    evict_packed_chunks();
 
     if (args->world_mesh != NULL) {
-        write_double_buffer(args->world_mesh, world);
+        publish_world_mesh(args->world_mesh, world);
         args->mesh_requires_update = true;
+    } else {
+        free_world_mesh(world);
     }
-    free_packets(packet, visible_count);
-}
-
-void update_world_mesh(game_data* data) {
-    if (data == NULL) {
-        assert(false && "game_data pointer is NULL\n");
-    }
-
-    while (data->is_running) {
-        // Skip update if no chunks are available yet
-        if (data->packet != NULL) {
-            get_world_mesh(data);
-        }
-        usleep(TICK_RATE);
-    }
-
-    return;
-}
-
-void start_world_mesh_updater(game_data* data) {
-    pthread_create(&wm_updater_thread, NULL, (void* (*)(void*))update_world_mesh, data);
-}
-
-void kill_world_mesh_updater(void) {
-    pthread_join(wm_updater_thread, NULL);
-    pthread_join(wm_updater_thread, NULL);
-    pthread_mutex_destroy(&wm_mutex);
-
 }
@@ -5,9 +5,6 @@
 #include <pthread.h>
 
 void init_world_mesh(camera* camera);
-world_mesh* create_world_mesh(chunk_mesh** packet, int count);
 void get_world_mesh(game_data* args);
-void start_world_mesh_updater(game_data* args);
-void kill_world_mesh_updater(void);
 
 #endif
@@ -36,6 +36,10 @@ DEFINE_HASHMAP(model_cache, char*, blockbench_model*, string_hash, string_equals
 static model_cache_hashmap model_cache_map;
 static bool cache_initialized = false;
 
+// Loaded models indexed by id
+static blockbench_model** model_registry = NULL;
+static int model_registry_count = 0;
+
 // Internal structures for parsing
 typedef struct {
     float from[3];
@@ -417,6 +421,7 @@ blockbench_model* load_blockbench_model_from_file(const char* filepath) {
     }
     
     // Copy basic info
+    model->id = -1; // assigned when the model is registered
     model->filepath = strdup(filepath);
     model->name = strdup(filepath); // Use filepath as name for now
     model->texture_size[0] = parsed->texture_size[0];
@@ -495,6 +500,16 @@ blockbench_model* get_blockbench_model(const char* filepath) {
     // Load and process new model
     blockbench_model* model = load_blockbench_model_from_file(filepath);
     if (model) {
+        blockbench_model** registry = realloc(model_registry,
+            sizeof(blockbench_model*) * (model_registry_count + 1));
+        if (!registry) {
+            fprintf(stderr, "Failed to register Blockbench model: %s\n", filepath);
+            return model;
+        }
+        model_registry = registry;
+        model->id = model_registry_count;
+        model_registry[model_registry_count++] = model;
+
         // Store in cache
         char* path_copy = strdup(filepath);
         model_cache_insert(&model_cache_map, path_copy, model);
@@ -503,10 +518,26 @@ blockbench_model* get_blockbench_model(const char* filepath) {
     return model;
 }
 
+blockbench_model* get_blockbench_model_by_id(int id) {
+    if (id < 0 || id >= model_registry_count) {
+        return NULL;
+    }
+    return model_registry[id];
+}
+
+int get_blockbench_model_count(void) {
+    return model_registry_count;
+}
+
 void blockbench_cleanup() {
     if (cache_initialized) {
         // TODO: Free all cached models and their data
         model_cache_free(&model_cache_map);
         cache_initialized = false;
     }
+    if (model_registry) {
+        free(model_registry);
+        model_registry = NULL;
+        model_registry_count = 0;
+    }
 }
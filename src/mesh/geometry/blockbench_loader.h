@@ -13,6 +13,7 @@ typedef struct {
 
 // Complete model ready for rendering
 typedef struct {
+    int id;  // index in the model registry, used by model instances
     char* name;
     char* filepath;
     
@@ -32,6 +33,8 @@ typedef struct {
 
 // Public API
 blockbench_model* get_blockbench_model(const char* filepath);
+blockbench_model* get_blockbench_model_by_id(int id);
+int get_blockbench_model_count(void);
 void blockbench_cleanup();
 
 #endif
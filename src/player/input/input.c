@@ -5,6 +5,8 @@
 #include "world/core/world.h"
 #include <player/core/camera.h>
 #include <chunk_mesh.h>
+#include <mesh_pipeline.h>
+#include <mesh.h>
 #include "util/settings.h"
 #include <cglm/cglm.h>
 
@@ -112,6 +114,7 @@ void update_camera(float delta_seconds) {
     (void)delta_seconds;
     update_position();
     update_orientation(&(g_data->player.cam));
+    notify_mesh_camera(&(g_data->player.cam));
 }
 
 
@@ -133,6 +136,13 @@ void handle_keypress(int key) {
     /* Toggle mesh refresh pause with F2 key */
     if (key == GLFW_KEY_F2) {
         g_data->mesh_refresh_paused = !g_data->mesh_refresh_paused;
+        notify_mesh_pipeline();
+        return;
+    }
+
+    /* Retire or add a chunk worker with F3 / F4, the F1 overlay shows the count */
+    if (key == GLFW_KEY_F3 || key == GLFW_KEY_F4) {
+        adjust_mesh_worker_threads(key == GLFW_KEY_F3 ? -1 : 1);
         return;
     }
 
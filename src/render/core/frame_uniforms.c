@@ -0,0 +1,96 @@
+#include "frame_uniforms.h"
+
+#include <stddef.h>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "util/settings.h"
+
+_Static_assert(offsetof(camera_block, camera_pos) == 128, "Camera block does not match std140");
+_Static_assert(offsetof(sun_block, ambient_light) == 32, "Sun block does not match std140");
+_Static_assert(offsetof(shadow_block, shadow_softness) == 64 * MAX_SHADOW_CASCADES, "Shadow block does not match std140");
+
+static const char* uniform_block_names[UNIFORM_BLOCK_COUNT] = {
+    "Camera",
+    "Sun",
+    "Fog",
+    "Shadow"
+};
+
+static const size_t uniform_block_sizes[UNIFORM_BLOCK_COUNT] = {
+    sizeof(camera_block),
+    sizeof(sun_block),
+    sizeof(fog_block),
+    sizeof(shadow_block)
+};
+
+static void upload_block(frame_uniforms* uniforms, uniform_block block, const void* data) {
+    glBindBuffer(GL_UNIFORM_BUFFER, uniforms->buffers[block]);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, uniform_block_sizes[block], data);
+}
+
+frame_uniforms create_frame_uniforms(void) {
+    frame_uniforms uniforms;
+    glGenBuffers(UNIFORM_BLOCK_COUNT, uniforms.buffers);
+    for (int block = 0; block < UNIFORM_BLOCK_COUNT; block++) {
+        glBindBuffer(GL_UNIFORM_BUFFER, uniforms.buffers[block]);
+        glBufferData(GL_UNIFORM_BUFFER, uniform_block_sizes[block], NULL, GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, block, uniforms.buffers[block]);
+    }
+
+    // Fog only depends on settings
+    fog_block fog = {.fog_distance = RENDER_DISTANCE};
+    upload_block(&uniforms, UNIFORM_BLOCK_FOG, &fog);
+
+    // No cascades until the shadow map is first drawn
+    shadow_block shadow = {
+        .shadow_softness = SHADOW_SOFTNESS,
+        .shadow_bias = SHADOW_BIAS,
+        .shadow_samples = SHADOW_SAMPLES,
+        .shadow_cascades = 0
+    };
+    upload_block(&uniforms, UNIFORM_BLOCK_SHADOW, &shadow);
+
+    return uniforms;
+}
+
+void destroy_frame_uniforms(frame_uniforms* uniforms) {
+    glDeleteBuffers(UNIFORM_BLOCK_COUNT, uniforms->buffers);
+}
+
+void update_frame_uniforms(frame_uniforms* uniforms, camera* cam, sun* s) {
+    camera_block camera_data;
+    get_view_matrix(*cam, &camera_data.view);
+    get_projection_matrix(&camera_data.proj, RADS(FOV), (float)WIDTH / (float)HEIGHT, 0.1f, RENDER_DISTANCE);
+    glm_vec3_copy(cam->position, camera_data.camera_pos);
+    camera_data.time = (float)glfwGetTime();
+    upload_block(uniforms, UNIFORM_BLOCK_CAMERA, &camera_data);
+
+    sun_block sun_data = {
+        .sun_pos = {s->x, s->y, s->z},
+        .sun_intensity = SUN_INTENSITY,
+        .sun_color = {s->r, s->g, s->b},
+        .sun_specular_strength = SUN_SPECULAR_STRENGTH,
+        .ambient_light = {AMBIENT_R_INTENSITY, AMBIENT_G_INTENSITY, AMBIENT_B_INTENSITY},
+        .water_shininess = WATER_SHININESS
+    };
+    upload_block(uniforms, UNIFORM_BLOCK_SUN, &sun_data);
+}
+
+void update_shadow_uniforms(frame_uniforms* uniforms, shadow_map* map) {
+    shadow_block shadow_data = {
+        .shadow_softness = SHADOW_SOFTNESS,
+        .shadow_bias = SHADOW_BIAS,
+        .shadow_samples = SHADOW_SAMPLES
+    };
+    shadow_data.shadow_cascades = get_shadow_cascades(map, shadow_data.sun_cascades);
+    upload_block(uniforms, UNIFORM_BLOCK_SHADOW, &shadow_data);
+}
+
+void bind_frame_uniform_blocks(uint program) {
+    for (int block = 0; block < UNIFORM_BLOCK_COUNT; block++) {
+        uint index = glGetUniformBlockIndex(program, uniform_block_names[block]);
+        if (index != GL_INVALID_INDEX) {
+            glUniformBlockBinding(program, index, block);
+        }
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <util.h>
+#include <cglm/cglm.h>
+#include <camera.h>
+#include <sun.h>
+#include <shadow_map.h>
+
+// Binding points of the uniform blocks shared by the world shaders, declared
+// as the Camera, Sun, Fog and Shadow blocks in res/shaders
+typedef enum {
+    UNIFORM_BLOCK_CAMERA = 0,
+    UNIFORM_BLOCK_SUN,
+    UNIFORM_BLOCK_FOG,
+    UNIFORM_BLOCK_SHADOW,
+    UNIFORM_BLOCK_COUNT
+} uniform_block;
+
+// The blocks in std140 layout, a vec3 followed by a float shares 16 bytes
+typedef struct {
+    mat4 view;
+    mat4 proj;
+    float camera_pos[3];
+    float time;  // seconds, animates water and foliage
+} camera_block;
+
+typedef struct {
+    float sun_pos[3];
+    float sun_intensity;
+    float sun_color[3];
+    float sun_specular_strength;
+    float ambient_light[3];
+    float water_shininess;
+} sun_block;
+
+typedef struct {
+    float fog_distance;
+    float padding[3];
+} fog_block;
+
+typedef struct {
+    mat4 sun_cascades[MAX_SHADOW_CASCADES];  // light space of each cascade
+    float shadow_softness;
+    float shadow_bias;
+    int shadow_samples;
+    int shadow_cascades;
+} shadow_block;
+
+// One uniform buffer per block, bound to its binding point for good
+typedef struct {
+    uint buffers[UNIFORM_BLOCK_COUNT];
+} frame_uniforms;
+
+frame_uniforms create_frame_uniforms(void);
+void destroy_frame_uniforms(frame_uniforms* uniforms);
+
+// Upload the blocks that change, once a frame after the sun has moved
+void update_frame_uniforms(frame_uniforms* uniforms, camera* cam, sun* s);
+
+// Upload the cascades of the shadow map, after it is drawn
+void update_shadow_uniforms(frame_uniforms* uniforms, shadow_map* map);
+
+// Point the shared blocks a program declares at their binding points
+void bind_frame_uniform_blocks(uint program);
+
+#endif
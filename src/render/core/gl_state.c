@@ -0,0 +1,71 @@
+#include "gl_state.h"
+
+#include <assert.h>
+#include <glad/glad.h>
+
+static uint current_program = 0;
+static uint current_vao = 0;
+static uint active_unit = 0;
+static uint bound_textures[GL_STATE_TEXTURE_UNITS] = {0};
+
+void gl_state_use_program(uint program) {
+    if (program == current_program) {
+        return;
+    }
+    glUseProgram(program);
+    current_program = program;
+}
+
+void gl_state_bind_vao(uint vao) {
+    if (vao == current_vao) {
+        return;
+    }
+    glBindVertexArray(vao);
+    current_vao = vao;
+}
+
+// Texture ids are unique across targets, so one id per unit is enough
+static void bind_texture(uint unit, GLenum target, uint texture) {
+    assert(unit < GL_STATE_TEXTURE_UNITS && "Texture unit out of range");
+    if (bound_textures[unit] == texture) {
+        return;
+    }
+    if (unit != active_unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        active_unit = unit;
+    }
+    glBindTexture(target, texture);
+    bound_textures[unit] = texture;
+}
+
+void gl_state_bind_texture(uint unit, uint texture) {
+    bind_texture(unit, GL_TEXTURE_2D, texture);
+}
+
+void gl_state_bind_texture_array(uint unit, uint texture) {
+    bind_texture(unit, GL_TEXTURE_2D_ARRAY, texture);
+}
+
+void gl_state_forget_program(uint program) {
+    // A deleted program stays in use until another is, so stop using it
+    if (program == current_program) {
+        current_program = 0;
+        glUseProgram(0);
+    }
+}
+
+void gl_state_forget_vao(uint vao) {
+    // Deleting the bound VAO binds 0
+    if (vao == current_vao) {
+        current_vao = 0;
+    }
+}
+
+void gl_state_forget_texture(uint texture) {
+    // Deleting a texture unbinds it from every unit
+    for (int unit = 0; unit < GL_STATE_TEXTURE_UNITS; unit++) {
+        if (bound_textures[unit] == texture) {
+            bound_textures[unit] = 0;
+        }
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <util.h>
+
+#define GL_STATE_TEXTURE_UNITS 32
+
+// Last program, VAO and textures handed to GL, so binds that would not
+// change anything are skipped. Everything on the render thread binds through
+// these, a raw glUseProgram, glBindVertexArray or glBindTexture would leave
+// the tracker out of date.
+void gl_state_use_program(uint program);
+void gl_state_bind_vao(uint vao);
+void gl_state_bind_texture(uint unit, uint texture);
+void gl_state_bind_texture_array(uint unit, uint texture);
+
+// Call before deleting, GL may hand the id out again
+void gl_state_forget_program(uint program);
+void gl_state_forget_vao(uint vao);
+void gl_state_forget_texture(uint texture);
+
+#endif
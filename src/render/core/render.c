@@ -8,6 +8,7 @@
 #include "../effects/fbo.h"
 #include "../effects/shadow_map.h"
 #include "../effects/reflection_map.h"
+#include "../effects/oit.h"
 
 #include "../world/foliage_renderer.h"
 #include "../world/liquid_renderer.h"
@@ -49,8 +50,12 @@ renderer create_renderer(game_data* data) {
 
     skybox sky = create_skybox(camera);
     sun s = create_sun(camera, 1.0f, 1.0f, 1.0f);
-    FBO shadow_map = create_shadow_map(SHADOW_MAP_WIDTH, SHADOW_MAP_HEIGHT);
+    shadow_map shadows = create_shadow_map(SHADOW_MAP_WIDTH, SHADOW_MAP_HEIGHT);
     FBO reflection_map = create_reflection_map(WIDTH, HEIGHT);
+    oit_buffer oit = {0};
+    if (ORDER_INDEPENDENT_TRANSPARENCY) {
+        oit = create_oit_buffer(WIDTH, HEIGHT);
+    }
 
     renderer r = {
         .wr = wr,
@@ -66,8 +71,11 @@ renderer create_renderer(game_data* data) {
             .z = camera->position[2],
         },
         .cam = camera,
-        .shadow_map = shadow_map,
+        .shadow_map = shadows,
         .reflection_map = reflection_map,
+        .oit = oit,
+        .arena = create_chunk_arena(),
+        .uniforms = create_frame_uniforms(),
     };
 
     return r;
@@ -79,7 +87,33 @@ void destroy_renderer(renderer* r) {
     destroy_blockbench_renderer(r->br);
     destroy_outline_renderer(r->or);
     destroy_ui_renderer(&r->ui);
+    if (ORDER_INDEPENDENT_TRANSPARENCY) {
+        destroy_oit_buffer(&r->oit);
+    }
     skybox_cleanup(&(r->sky));
+    destroy_shadow_map(&r->shadow_map);
+    destroy_chunk_arena(&r->arena);
+    destroy_frame_uniforms(&r->uniforms);
+}
+
+// Foliage and transparent blocks. With OIT their opaque texels are drawn
+// first so they still write depth, then the translucent texels are
+// accumulated in any order and composited once.
+static void render_see_through(renderer* r) {
+    chunk_arena* arena = &(r->arena);
+    if (!ORDER_INDEPENDENT_TRANSPARENCY) {
+        render_foliage(&(r->fr), &(r->shadow_map.depth), arena, TRANSPARENCY_PASS_BLENDED);
+        render_transparent(&(r->wr), &(r->shadow_map.depth), arena, TRANSPARENCY_PASS_BLENDED);
+        return;
+    }
+
+    render_foliage(&(r->fr), &(r->shadow_map.depth), arena, TRANSPARENCY_PASS_OPAQUE);
+    render_transparent(&(r->wr), &(r->shadow_map.depth), arena, TRANSPARENCY_PASS_OPAQUE);
+
+    begin_oit_pass(&(r->oit));
+    render_foliage(&(r->fr), &(r->shadow_map.depth), arena, TRANSPARENCY_PASS_ACCUMULATE);
+    render_transparent(&(r->wr), &(r->shadow_map.depth), arena, TRANSPARENCY_PASS_ACCUMULATE);
+    end_oit_pass(&(r->oit));
 }
 
 void render(game_data* args, renderer* r, world_mesh* packet, int num_packets) {
@@ -99,37 +133,41 @@ void render(game_data* args, renderer* r, world_mesh* packet, int num_packets) {
     render_sun(&(r->s), args->tick);
     profile_end_section(PROFILE_SECTION_RENDER_SUN);
 
+    // Every pass after this reads the camera and sun from these
+    update_frame_uniforms(&(r->uniforms), r->cam, &(r->s));
+
     if (packet != NULL && num_packets > 0) {
-        profile_begin_section(PROFILE_SECTION_RENDER_SHADOW_MAP);
-        if ((int)args->tick % TICK_RATE == 0) {
-            render_shadow_map(&(r->shadow_map), &(r->s), packet);
-        }        
+        // Only chunks that changed since the last frame are uploaded
+        profile_begin_section(PROFILE_SECTION_UPLOAD_CHUNKS);
+        sync_chunk_arena(&(r->arena), packet);
+        profile_end_section(PROFILE_SECTION_UPLOAD_CHUNKS);
+
+        // Turning the camera only costs this, the world mesh stays as is
+        profile_begin_section(PROFILE_SECTION_CULL_CHUNKS);
+        cull_chunk_arena(&(r->arena), packet, r->cam);
+        profile_end_section(PROFILE_SECTION_CULL_CHUNKS);
 
+        // The near cascade is redrawn every frame, the far ones when stale
+        profile_begin_section(PROFILE_SECTION_RENDER_SHADOW_MAP);
+        render_shadow_map(&(r->shadow_map), &(r->s), r->cam, &(r->arena));
+        update_shadow_uniforms(&(r->uniforms), &(r->shadow_map));
         profile_end_section(PROFILE_SECTION_RENDER_SHADOW_MAP);
 
         // profile_begin_section(PROFILE_SECTION_RENDER_REFLECTION_MAP);
-        // render_reflection_map(&(r->reflection_map), r->cam, (float)WORLDGEN_WATER_LEVEL, packet);
+        // render_reflection_map(&(r->reflection_map), r->cam, (float)WORLDGEN_WATER_LEVEL, &(r->arena));
         // profile_end_section(PROFILE_SECTION_RENDER_REFLECTION_MAP);
 
-        glActiveTexture(GL_TEXTURE0 + SHADOW_MAP_TEXTURE_INDEX);
-        glBindTexture(GL_TEXTURE_2D, r->shadow_map.texture);
-
-        glActiveTexture(GL_TEXTURE0 + REFLECTION_MAP_TEXTURE_INDEX);
-        glBindTexture(GL_TEXTURE_2D, r->reflection_map.texture);
-
         glClear(GL_DEPTH_BUFFER_BIT);
 
         profile_begin_section(PROFILE_SECTION_RENDER_WORLD);
-        render_solids(&(r->wr), &(r->s), &(r->shadow_map), packet);
-        render_blockbench_models(&(r->br), &(r->s), &(r->shadow_map), packet);
+        render_solids(&(r->wr), &(r->shadow_map.depth), &(r->arena));
+        render_blockbench_models(&(r->br), &(r->shadow_map.depth), packet, &(r->arena));
         if (args->player.is_underwater) {
-            render_foliage(&(r->fr), &(r->s), &(r->shadow_map), packet);
-            render_transparent(&(r->wr), &(r->s), &(r->shadow_map), packet);
-            render_liquids(&(r->lr), &(r->s), &(r->shadow_map), &(r->reflection_map), packet);
+            render_see_through(r);
+            render_liquids(&(r->lr), &(r->shadow_map.depth), &(r->reflection_map), &(r->arena));
         } else {
-            render_liquids(&(r->lr), &(r->s), &(r->shadow_map), &(r->reflection_map), packet);
-            render_foliage(&(r->fr), &(r->s), &(r->shadow_map), packet);
-            render_transparent(&(r->wr), &(r->s), &(r->shadow_map), packet);
+            render_liquids(&(r->lr), &(r->shadow_map.depth), &(r->reflection_map), &(r->arena));
+            render_see_through(r);
         }
 
         if (args->player.has_selected_block) {
@@ -145,7 +183,10 @@ void render(game_data* args, renderer* r, world_mesh* packet, int num_packets) {
         render_debug(&(r->ui), (int)get_fps(),
                      args->player.cam.position[0],
                      args->player.cam.position[1],
-                     args->player.cam.position[2]);
+                     args->player.cam.position[2],
+                     r->arena.drawn_sides,
+                     r->arena.culled_sides,
+                     pool_thread_count(get_mesh_worker_pool()));
     }
     glEnable(GL_DEPTH_TEST);
     profile_end_section(PROFILE_SECTION_RENDER_UI);
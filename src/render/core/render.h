@@ -9,9 +9,13 @@
 #include <skybox.h>
 #include <sun.h>
 #include <fbo.h>
+#include <shadow_map.h>
 #include <reflection_map.h>
+#include <oit.h>
 #include <game_data.h>
 #include <ui_renderer.h>
+#include <chunk_arena.h>
+#include <frame_uniforms.h>
 
 typedef struct {
     block_renderer wr; // world renderer
@@ -22,8 +26,11 @@ typedef struct {
     ui_renderer ui; // ui renderer
     skybox sky;
     sun s;
-    FBO shadow_map;
+    shadow_map shadow_map;
     FBO reflection_map;
+    oit_buffer oit;
+    chunk_arena arena;  // faces of the chunks in render distance
+    frame_uniforms uniforms;
 
     camera_cache cam_cache;
     camera* cam;
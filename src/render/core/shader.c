@@ -2,6 +2,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <glad/glad.h>
+#include "gl_state.h"
+#include "frame_uniforms.h"
 
 char* read_file(const char* path) {
     FILE* file = fopen(path, "r");
@@ -76,17 +78,20 @@ shader_program create_program(shader vert_shader, shader frag_shader) {
         printf("ERROR::PROGRAM::LINKING_FAILED\n%s\n", infoLog);
     }
 
+    bind_frame_uniform_blocks(program.id);
+
     return program;
 }
 
 void delete_program(shader_program program) {
+    gl_state_forget_program(program.id);
     glDeleteProgram(program.id);
 }
 
 void use_program(shader_program program) {
-    glUseProgram(program.id);
+    gl_state_use_program(program.id);
 }
 
 void stop_program() {
-    glUseProgram(0);
+    gl_state_use_program(0);
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 #include <glad/glad.h>
+#include "gl_state.h"
 
 // atlas texture_atlas;
 
@@ -19,7 +20,7 @@ texture t_init(char* path, uint tex_index) {
     uint texture_id;
     glGenTextures(1, &texture_id);
 
-    glBindTexture(GL_TEXTURE_2D, texture_id);
+    gl_state_bind_texture(tex_index, texture_id);
 
     #ifdef USE_MIPMAP
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -52,6 +53,11 @@ texture t_init(char* path, uint tex_index) {
     return tex;
 }
 
+void t_bind(texture* tex) {
+    gl_state_bind_texture(tex->tex_index, tex->id);
+}
+
 void t_cleanup(texture* tex) {
+    gl_state_forget_texture(tex->id);
     glDeleteTextures(1, &tex->id);
 }
\ No newline at end of file
@@ -16,4 +16,7 @@ typedef struct {
 texture t_init(char* path, uint tex_index);
 void t_cleanup(texture* tex);
 
+// Bind to the texture unit it was loaded for
+void t_bind(texture* tex);
+
 #endif
\ No newline at end of file
@@ -37,15 +37,21 @@ GLFWwindow* create_window(char* title, int width, int height) {
         return NULL;
     }
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     #ifdef __APPLE__
         glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
     #endif
 
+    // 4.3 brings multi-draw indirect for the chunk draws, 3.3 is enough
+    // for everything else
+    static const int context_versions[][2] = {{4, 3}, {3, 3}};
     GLFWmonitor* monitor = FULLSCREEN ? glfwGetPrimaryMonitor() : NULL;
-    GLFWwindow* window = glfwCreateWindow(width, height, title, monitor, NULL);
+    GLFWwindow* window = NULL;
+    for (int i = 0; i < 2 && !window; i++) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, context_versions[i][0]);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, context_versions[i][1]);
+        window = glfwCreateWindow(width, height, title, monitor, NULL);
+    }
     if (!window) {
         printf("Window creation failed\n");
         return NULL;
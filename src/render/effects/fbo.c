@@ -6,8 +6,10 @@
 #include "vao.h"
 #include "vbo.h"
 #include "block.h"
+#include <gl_state.h>
 
 void FBO_cleanup(FBO* map) {
+    gl_state_forget_texture(map->texture);
     glDeleteFramebuffers(1, &map->fbo);
     glDeleteTextures(1, &map->texture);
 }
@@ -30,32 +32,16 @@ void get_sun_view_matrix(vec3 pos, vec3 player_pos, mat4* view) {
     glm_look_anyup(sun_pos, light_dir, *view);
 }
 
-void get_sun_proj_matrix(mat4* proj, sun* s) {
-    (void)s;
+void get_sun_proj_matrix(mat4* proj, float radius) {
     float near_plane = fmaxf(SHADOW_NEAR_CLIP, SHADOW_LIGHT_DISTANCE - SHADOW_RENDER_DIST);
     float far_plane = SHADOW_LIGHT_DISTANCE + SHADOW_RENDER_DIST;
 
-    glm_ortho(-SHADOW_RENDER_DIST, SHADOW_RENDER_DIST, 
-        -SHADOW_RENDER_DIST, SHADOW_RENDER_DIST, 
+    glm_ortho(-radius, radius, 
+        -radius, radius, 
         near_plane, far_plane,
         *proj);
 }
 
-void send_sun_matrices(shader_program* program, sun* sun) {
-    mat4 view;
-    get_sun_view_matrix(
-        (vec3){sun->x, sun->y, sun->z}, 
-        (vec3){sun->cam->position[0], sun->cam->position[1], sun->cam->position[2]},
-        &view);
-    uint view_loc = glGetUniformLocation(program->id, "sunView");
-    glUniformMatrix4fv(view_loc, 1, GL_FALSE, (float*)view);
-
-    mat4 proj;
-    get_sun_proj_matrix(&proj, sun);
-    uint proj_loc = glGetUniformLocation(program->id, "sunProj");
-    glUniformMatrix4fv(proj_loc, 1, GL_FALSE, (float*)proj);
-}
-
 void get_reflection_view_matrix(camera* cam, float water_level, mat4* view) {
     // Create a reflected camera position across the water plane
     vec3 reflected_pos = {
@@ -83,53 +69,41 @@ void get_reflection_proj_matrix(mat4* proj, camera* cam) {
     glm_perspective(RADS(FOV), (float)WIDTH / (float)HEIGHT, 0.1f, RENDER_DISTANCE, *proj);
 }
 
-void send_reflection_matrices(shader_program* program, camera* cam, float water_level) {
+void send_reflection_matrices(FBO* map, camera* cam, float water_level) {
     mat4 view;
     get_reflection_view_matrix(cam, water_level, &view);
-    uint view_loc = glGetUniformLocation(program->id, "reflectionView");
-    glUniformMatrix4fv(view_loc, 1, GL_FALSE, (float*)view);
+    glUniformMatrix4fv(map->view_loc, 1, GL_FALSE, (float*)view);
 
     mat4 proj;
     get_reflection_proj_matrix(&proj, cam);
-    uint proj_loc = glGetUniformLocation(program->id, "reflectionProj");
-    glUniformMatrix4fv(proj_loc, 1, GL_FALSE, (float*)proj);
+    glUniformMatrix4fv(map->proj_loc, 1, GL_FALSE, (float*)proj);
 
     // Send water level uniform for clipping
-    uint water_level_loc = glGetUniformLocation(program->id, "waterLevel");
-    glUniform1f(water_level_loc, water_level);
-
-    // Send atlas size uniform for proper texture sampling
-    uint atlas_size_loc = glGetUniformLocation(program->id, "atlasSize");
-    glUniform1f(atlas_size_loc, (float)ATLAS_SIZE);
-}
-
-void send_fbo_texture(shader_program* program, FBO* map, uint texture_index, char* uniform_name) {
-    glActiveTexture(GL_TEXTURE0 + texture_index);
-    glBindTexture(GL_TEXTURE_2D, map->texture);
-    uint shadow_loc = glGetUniformLocation(program->id, uniform_name);
-    glUniform1i(shadow_loc, texture_index);
+    glUniform1f(map->water_level_loc, water_level);
 }
 
-void render_depth(FBO* map, int* side_data, int num_sides) {
-    use_program(map->program);
-    bind_vao(map->vao);
-    buffer_data(map->instance_vbo, GL_STATIC_DRAW, side_data, num_sides * VBO_WIDTH * sizeof(int));
-    i_add_attrib(&(map->instance_vbo), 1, 3, 0 * sizeof(int), VBO_WIDTH * sizeof(int)); // position
-    i_add_attrib(&(map->instance_vbo), 2, 2, 3 * sizeof(int), VBO_WIDTH * sizeof(int)); // atlas coords
-    i_add_attrib(&(map->instance_vbo), 3, 1, 5 * sizeof(int), VBO_WIDTH * sizeof(int)); // side
-    i_add_attrib(&(map->instance_vbo), 8, 1, 10 * sizeof(int), VBO_WIDTH * sizeof(int)); // lod scale
-    use_vbo(map->instance_vbo);
-
+void init_depth_vao(FBO* map) {
+    init_cube_vbo(map->vao, map->cube_vbo);
     glVertexAttribDivisor(1, 1);
     glVertexAttribDivisor(2, 1);
     glVertexAttribDivisor(3, 1);
     glVertexAttribDivisor(8, 1);
+}
 
-    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, num_sides);
+static void set_depth_side_attribs(VBO* vbo, uint offset) {
+    i_add_attrib(vbo, 1, 3, offset + 0 * sizeof(int), VBO_WIDTH * sizeof(int)); // position
+    i_add_attrib(vbo, 2, 2, offset + 3 * sizeof(int), VBO_WIDTH * sizeof(int)); // atlas coords
+    i_add_attrib(vbo, 3, 1, offset + 5 * sizeof(int), VBO_WIDTH * sizeof(int)); // side
+    i_add_attrib(vbo, 8, 1, offset + 10 * sizeof(int), VBO_WIDTH * sizeof(int)); // lod scale
+}
 
+void render_depth(FBO* map, chunk_arena* arena, chunk_draw_list* list, mesh_layer layer) {
+    use_program(map->program);
+    bind_vao(map->vao);
+    draw_chunk_layer(arena, list, layer, set_depth_side_attribs);
 }
 
-void FBO_render(FBO* map, sun* s, world_mesh* packet) {
+void FBO_render(FBO* map, sun* s, chunk_arena* arena) {
     // Save current viewport
     GLint viewport[4];
     glGetIntegerv(GL_VIEWPORT, viewport);
@@ -138,21 +112,10 @@ void FBO_render(FBO* map, sun* s, world_mesh* packet) {
     glViewport(0, 0, map->width, map->height);
     glClear(GL_DEPTH_BUFFER_BIT);
 
-    use_program(map->program);
-
-    send_sun_matrices(&(map->program), s);
-
-    // send cube vbo
-    send_cube_vbo(map->vao, map->cube_vbo);
-
-    if (packet != NULL) {
-        render_depth(map,
-            packet->opaque_data,
-            packet->num_opaque_sides);
-        render_depth(map,
-            packet->transparent_data,
-            packet->num_transparent_sides);
-    }
+    // The caller sets the program's matrices
+    (void)s;
+    render_depth(map, arena, &arena->view, MESH_LAYER_OPAQUE);
+    render_depth(map, arena, &arena->view, MESH_LAYER_TRANSPARENT);
 
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
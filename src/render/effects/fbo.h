@@ -8,6 +8,7 @@
 #include <vbo.h>
 #include <sun.h>
 #include <world_mesh.h>
+#include <chunk_arena.h>
 #include <util/settings.h>
 
 typedef struct {
@@ -17,20 +18,28 @@ typedef struct {
     uint texture;
     shader_program program;
     VAO vao;
-    VBO cube_vbo, instance_vbo;
+    VBO cube_vbo;
+    // Reflection matrices and clip height, -1 for maps that do not take them
+    int view_loc;
+    int proj_loc;
+    int water_level_loc;
 } FBO;
 
 FBO create_reflection_map(uint width, uint height);
 
 void FBO_cleanup(FBO* map);
 
-void FBO_render(FBO* map, sun* s, world_mesh* packet);
+void FBO_render(FBO* map, sun* s, chunk_arena* arena);
 
-void send_sun_matrices(shader_program* program, sun* sun);
+void get_sun_view_matrix(vec3 pos, vec3 player_pos, mat4* view);
+// Covers radius blocks around the player sideways and SHADOW_RENDER_DIST
+// towards and away from the sun
+void get_sun_proj_matrix(mat4* proj, float radius);
 void get_reflection_view_matrix(camera* cam, float water_level, mat4* view);
 void get_reflection_proj_matrix(mat4* proj, camera* cam);
-void send_reflection_matrices(shader_program* program, camera* cam, float water_level);
-void render_depth(FBO* map, int* side_data, int num_sides);
-void send_fbo_texture(shader_program* program, FBO* map, uint texture_index, char* uniform_name);
+void send_reflection_matrices(FBO* map, camera* cam, float water_level);
+// Set up the cube quad and instance divisors of a depth pass VAO, once
+void init_depth_vao(FBO* map);
+void render_depth(FBO* map, chunk_arena* arena, chunk_draw_list* list, mesh_layer layer);
 
 #endif
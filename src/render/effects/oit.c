@@ -0,0 +1,148 @@
+#include "oit.h"
+
+#include <glad/glad.h>
+#include <stdio.h>
+#include "util/settings.h"
+#include "gl_state.h"
+
+static uint create_oit_texture(uint unit, uint width, uint height, int internal_format, uint format) {
+    uint texture;
+    glGenTextures(1, &texture);
+    gl_state_bind_texture(unit, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+// Give the targets new storage in place, so the framebuffer attachments
+// stay valid
+static void resize_oit_buffer(oit_buffer* oit, uint width, uint height) {
+    gl_state_bind_texture(OIT_ACCUM_TEXTURE_INDEX, oit->accum_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+    gl_state_bind_texture(OIT_WEIGHT_TEXTURE_INDEX, oit->weight_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, width, height, 0, GL_RED, GL_FLOAT, NULL);
+    glBindRenderbuffer(GL_RENDERBUFFER, oit->depth_buffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+
+    oit->width = width;
+    oit->height = height;
+}
+
+oit_buffer create_oit_buffer(uint width, uint height) {
+    // create fbo
+    uint fbo;
+    glGenFramebuffers(1, &fbo);
+
+    // create composite program
+    shader vert_shader = create_shader(OIT_COMPOSITE_VERTEX_SHADER, GL_VERTEX_SHADER);
+    shader frag_shader = create_shader(OIT_COMPOSITE_FRAGMENT_SHADER, GL_FRAGMENT_SHADER);
+    shader_program program = create_program(vert_shader, frag_shader);
+    delete_shader(vert_shader);
+    delete_shader(frag_shader);
+
+    use_program(program);
+    glUniform1i(glGetUniformLocation(program.id, "accum"), OIT_ACCUM_TEXTURE_INDEX);
+    glUniform1i(glGetUniformLocation(program.id, "weight"), OIT_WEIGHT_TEXTURE_INDEX);
+
+    // create accumulation targets
+    uint accum_texture = create_oit_texture(OIT_ACCUM_TEXTURE_INDEX, width, height, GL_RGBA16F, GL_RGBA);
+    uint weight_texture = create_oit_texture(OIT_WEIGHT_TEXTURE_INDEX, width, height, GL_R16F, GL_RED);
+
+    // depth is copied in from the default framebuffer each frame, so match its format
+    uint depth_buffer;
+    glGenRenderbuffers(1, &depth_buffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth_buffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+
+    // the composite pass draws a full screen triangle from gl_VertexID
+    VAO vao = create_vao();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accum_texture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, weight_texture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth_buffer);
+
+    uint draw_buffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, draw_buffers);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        printf("Error: OIT framebuffer is not complete\n");
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    oit_buffer oit = {
+        .width = width,
+        .height = height,
+        .fbo = fbo,
+        .accum_texture = accum_texture,
+        .weight_texture = weight_texture,
+        .depth_buffer = depth_buffer,
+        .program = program,
+        .vao = vao
+    };
+
+    return oit;
+}
+
+void destroy_oit_buffer(oit_buffer* oit) {
+    glDeleteFramebuffers(1, &oit->fbo);
+    gl_state_forget_texture(oit->accum_texture);
+    gl_state_forget_texture(oit->weight_texture);
+    glDeleteTextures(1, &oit->accum_texture);
+    glDeleteTextures(1, &oit->weight_texture);
+    glDeleteRenderbuffers(1, &oit->depth_buffer);
+    delete_vao(oit->vao);
+    delete_program(oit->program);
+}
+
+void begin_oit_pass(oit_buffer* oit) {
+    // the viewport follows the framebuffer size, so resize to match it
+    int viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    uint width = viewport[2];
+    uint height = viewport[3];
+    if (width != oit->width || height != oit->height) {
+        resize_oit_buffer(oit, width, height);
+    }
+
+    // transparent faces are depth tested against everything already drawn
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, oit->fbo);
+    glBlitFramebuffer(0, 0, oit->width, oit->height,
+                      0, 0, oit->width, oit->height,
+                      GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, oit->fbo);
+
+    // revealage starts fully revealed
+    float accum_clear[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+    float weight_clear[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    glClearBufferfv(GL_COLOR, 0, accum_clear);
+    glClearBufferfv(GL_COLOR, 1, weight_clear);
+
+    // rgb is summed, alpha is multiplied by (1 - alpha) to get revealage.
+    // The same function on the weight target sums its red channel.
+    glDepthMask(GL_FALSE);
+    glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void end_oit_pass(oit_buffer* oit) {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDepthMask(GL_TRUE);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_DEPTH_TEST);
+
+    use_program(oit->program);
+    bind_vao(oit->vao);
+
+    gl_state_bind_texture(OIT_ACCUM_TEXTURE_INDEX, oit->accum_texture);
+    gl_state_bind_texture(OIT_WEIGHT_TEXTURE_INDEX, oit->weight_texture);
+
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    stop_program();
+    glEnable(GL_DEPTH_TEST);
+}
@@ -0,0 +1,32 @@
+#ifndef OIT_H
+#define OIT_H
+
+#include <util.h>
+#include <shader.h>
+#include <vao.h>
+
+// Weighted blended order-independent transparency targets.
+// Transparent faces accumulate into these in any order and are resolved
+// onto the screen by a single full screen composite.
+typedef struct {
+    uint width;
+    uint height;
+    uint fbo;
+    uint accum_texture;  // rgb: weighted premultiplied color, a: revealage
+    uint weight_texture; // r: sum of weighted alpha
+    uint depth_buffer;
+    shader_program program;
+    VAO vao;
+} oit_buffer;
+
+oit_buffer create_oit_buffer(uint width, uint height);
+void destroy_oit_buffer(oit_buffer* oit);
+
+// Copy the scene depth in, clear the targets and set up accumulation blending.
+// The targets are resized first when the viewport has changed size.
+void begin_oit_pass(oit_buffer* oit);
+
+// Composite the accumulated transparency over the default framebuffer
+void end_oit_pass(oit_buffer* oit);
+
+#endif
@@ -5,6 +5,7 @@
 #include "vbo.h"
 #include "block.h"
 #include <fbo.h>
+#include <gl_state.h>
 
 FBO create_reflection_map(uint width, uint height) {
 
@@ -22,7 +23,7 @@ FBO create_reflection_map(uint width, uint height) {
     // create color texture
     uint texture;
     glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    gl_state_bind_texture(REFLECTION_MAP_TEXTURE_INDEX, texture);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -37,11 +38,9 @@ FBO create_reflection_map(uint width, uint height) {
 
     // create vao
     VAO vao = create_vao();
-    bind_vao(vao);
 
     // create cube vbo
     VBO cube_vbo = create_vbo(GL_STATIC_DRAW);
-    VBO instance_vbo = create_vbo(GL_STATIC_DRAW);
 
     // bind framebuffer
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
@@ -72,13 +71,19 @@ FBO create_reflection_map(uint width, uint height) {
         .program = program,
         .vao = vao,
         .cube_vbo = cube_vbo,
-        .instance_vbo = instance_vbo
+        .view_loc = glGetUniformLocation(program.id, "reflectionView"),
+        .proj_loc = glGetUniformLocation(program.id, "reflectionProj"),
+        .water_level_loc = glGetUniformLocation(program.id, "waterLevel")
     };
+    init_depth_vao(&map);
+
+    use_program(program);
+    glUniform1f(glGetUniformLocation(program.id, "atlasSize"), (float)ATLAS_SIZE);
 
     return map;
 }
 
-void render_reflection_map(FBO* map, camera* cam, float water_level, world_mesh* packet) {
+void render_reflection_map(FBO* map, camera* cam, float water_level, chunk_arena* arena) {
     // Save current viewport
     GLint viewport[4];
     glGetIntegerv(GL_VIEWPORT, viewport);
@@ -92,15 +97,16 @@ void render_reflection_map(FBO* map, camera* cam, float water_level, world_mesh*
 
     use_program(map->program);
 
-    send_reflection_matrices(&(map->program), cam, water_level);
+    send_reflection_matrices(map, cam, water_level);
 
-    // send cube vbo
-    send_cube_vbo(map->vao, map->cube_vbo);
+    // The mirrored camera sees the sides facing it, not the ones facing cam
+    side_filter filter = {.from_eye = 1};
+    glm_vec3_copy(cam->position, filter.eye);
+    filter.eye[1] = 2.0f * water_level - cam->position[1];
+    cull_chunk_arena_pass(arena, &arena->reflection, filter);
 
-    if (packet != NULL) {
-        render_depth(map, packet->opaque_data, packet->num_opaque_sides);
-        render_depth(map, packet->transparent_data, packet->num_transparent_sides);
-    }
+    render_depth(map, arena, &arena->reflection, MESH_LAYER_OPAQUE);
+    render_depth(map, arena, &arena->reflection, MESH_LAYER_TRANSPARENT);
 
     // Disable clipping
     glDisable(GL_CLIP_DISTANCE0);
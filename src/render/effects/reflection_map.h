@@ -4,6 +4,6 @@
 #include <fbo.h>
 
 FBO create_reflection_map(uint width, uint height);
-void render_reflection_map(FBO* map, camera* cam, float water_level, world_mesh* packet);
+void render_reflection_map(FBO* map, camera* cam, float water_level, chunk_arena* arena);
 
 #endif
@@ -5,8 +5,39 @@
 #include "vbo.h"
 #include "block.h"
 #include <fbo.h>
+#include <cglm/cglm.h>
+#include <gl_state.h>
+
+// Outward normal of each block side, NORTH to DOWN
+static const float side_normals[6][3] = {
+    {0, 0, -1}, {1, 0, 0}, {0, 0, 1}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}
+};
+
+// Whether a side's quad is counter-clockwise seen from outside the block,
+// after the shaders rotate the cube face onto it
+static const int side_winds_outward[6] = {0, 0, 1, 1, 0, 1};
+
+// A cached cascade is redrawn once the player is this far through its radius
+static const float SHADOW_CASCADE_RECENTER = 0.25f;
+
+// The world shaders leave everything in shadow once the sun is this low
+static const float SHADOW_NIGHT_SUN_HEIGHT = -0.2f;
+
+// Sides the pass keeps with front faces culled, a side is front facing to
+// the sun when it faces it and winds outward or faces away and winds inward.
+// Sides edge on to the sun have no area and are dropped as well.
+static int shadow_sides(vec3 to_sun) {
+    int sides = 0;
+    for (int side = 0; side < 6; side++) {
+        float facing = glm_vec3_dot((float*)side_normals[side], to_sun);
+        if (facing != 0.0f && (facing > 0.0f) != side_winds_outward[side]) {
+            sides |= 1 << side;
+        }
+    }
+    return sides;
+}
 
-FBO create_shadow_map(uint width, uint height) {
+shadow_map create_shadow_map(uint width, uint height) {
 
     // create fbo
     uint fbo;
@@ -19,29 +50,27 @@ FBO create_shadow_map(uint width, uint height) {
     delete_shader(vert_shader);
     delete_shader(frag_shader);
 
-    // create depth buffer
+    // create depth buffer, a layer per cascade
     uint texture;
     glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    gl_state_bind_texture_array(SHADOW_MAP_TEXTURE_INDEX, texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, width, height, SHADOW_CASCADES, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
     float border_color[] = {1.0f, 1.0f, 1.0f, 1.0f};
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border_color);
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border_color);
 
     // create vao
     VAO vao = create_vao();
-    bind_vao(vao);
 
     // create cube vbo
     VBO cube_vbo = create_vbo(GL_STATIC_DRAW);
-    VBO instance_vbo = create_vbo(GL_STATIC_DRAW);
 
     // bind framebuffer
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, 0);
 
     // disable writes to color buffer
     glDrawBuffer(GL_NONE);
@@ -55,7 +84,7 @@ FBO create_shadow_map(uint width, uint height) {
     // unbind framebuffer
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    FBO map = {
+    FBO depth = {
         .width = width,
         .height = height,
         .fbo = fbo,
@@ -63,36 +92,138 @@ FBO create_shadow_map(uint width, uint height) {
         .program = program,
         .vao = vao,
         .cube_vbo = cube_vbo,
-        .instance_vbo = instance_vbo
+        .view_loc = -1,
+        .proj_loc = -1,
+        .water_level_loc = -1
     };
+    init_depth_vao(&depth);
+
+    shadow_map map = {
+        .depth = depth,
+        .light_space_loc = glGetUniformLocation(program.id, "lightSpace"),
+        .num_cascades = SHADOW_CASCADES
+    };
+
+    // The last cascade reaches SHADOW_RENDER_DIST, each one before is
+    // SHADOW_CASCADE_SCALE times narrower
+    float radius = SHADOW_RENDER_DIST;
+    for (int i = map.num_cascades - 1; i >= 0; i--) {
+        map.cascades[i].radius = radius;
+        radius /= SHADOW_CASCADE_SCALE;
+    }
 
     return map;
 }
 
-void render_shadow_map(FBO* map, sun* s, world_mesh* packet) {
+void destroy_shadow_map(shadow_map* map) {
+    FBO_cleanup(&map->depth);
+    delete_program(map->depth.program);
+    delete_vao(map->depth.vao);
+    delete_vbo(map->depth.cube_vbo);
+}
+
+// Projection * view of a cascade around its centre, nudged by less than a
+// texel so world positions always land on the same texels. Otherwise shadow
+// edges crawl as the player walks.
+static void get_cascade_light_space(shadow_cascade* cascade, uint width, uint height) {
+    mat4 view;
+    mat4 proj;
+    get_sun_view_matrix(cascade->sun_dir, cascade->center, &view);
+    get_sun_proj_matrix(&proj, cascade->radius);
+    glm_mat4_mul(proj, view, cascade->light_space);
+
+    vec4 origin = {0.0f, 0.0f, 0.0f, 1.0f};
+    glm_mat4_mulv(cascade->light_space, origin, origin);
+    float texel_x = origin[0] * (float)width * 0.5f;
+    float texel_y = origin[1] * (float)height * 0.5f;
+    cascade->light_space[3][0] += (roundf(texel_x) - texel_x) * 2.0f / (float)width;
+    cascade->light_space[3][1] += (roundf(texel_y) - texel_y) * 2.0f / (float)height;
+}
+
+static int cascade_stale(shadow_cascade* cascade, int index, vec3 sun_dir, camera* cam, chunk_arena* arena) {
+    if (index == 0 || !cascade->drawn || cascade->stale) {
+        return 1;
+    }
+    if (!glm_vec3_eqv(cascade->sun_dir, sun_dir)) {
+        return 1;
+    }
+    if (glm_vec3_distance(cam->position, cascade->center) > cascade->radius * SHADOW_CASCADE_RECENTER) {
+        return 1;
+    }
+
+    vec4 planes[6];
+    glm_frustum_planes(cascade->light_space, planes);
+    return chunk_arena_changed_in(arena, planes);
+}
+
+static void render_cascade(shadow_map* map, int index, vec3 sun_dir, camera* cam, chunk_arena* arena) {
+    shadow_cascade* cascade = &map->cascades[index];
+    glm_vec3_copy(cam->position, cascade->center);
+    glm_vec3_copy(sun_dir, cascade->sun_dir);
+    get_cascade_light_space(cascade, map->depth.width, map->depth.height);
+    cascade->drawn = 1;
+    cascade->stale = 0;
+
+    // Only the sections inside this cascade, seen by the camera or not, as
+    // casters out of view still throw shadows into it
+    vec4 planes[6];
+    glm_frustum_planes(cascade->light_space, planes);
+    side_filter filter = {.from_eye = 0, .sides = shadow_sides(sun_dir)};
+    cull_chunk_arena_frustum(arena, &arena->shadow, planes, filter);
+
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, map->depth.texture, 0, index);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    use_program(map->depth.program);
+    glUniformMatrix4fv(map->light_space_loc, 1, GL_FALSE, (float*)cascade->light_space);
+    render_depth(&map->depth, arena, &arena->shadow, MESH_LAYER_OPAQUE);
+    render_depth(&map->depth, arena, &arena->shadow, MESH_LAYER_TRANSPARENT);
+}
+
+void render_shadow_map(shadow_map* map, sun* s, camera* cam, chunk_arena* arena) {
+    // Cascades follow the sun in steps, so cached ones stay valid in between
+    // and all of them agree on where it is
+    vec3 sun_dir = {s->x, s->y, s->z};
+    glm_normalize(sun_dir);
+    shadow_cascade* first = &map->cascades[0];
+    if (first->drawn && glm_vec3_dot(sun_dir, first->sun_dir) >= cosf(RADS(SHADOW_CASCADE_SUN_ANGLE))) {
+        glm_vec3_copy(first->sun_dir, sun_dir);
+    }
+
+    for (int i = 0; i < map->num_cascades; i++) {
+        map->cascades[i].stale = cascade_stale(&map->cascades[i], i, sun_dir, cam, arena);
+    }
+
+    if (s->y < SHADOW_NIGHT_SUN_HEIGHT) {
+        return;
+    }
+
     // Save current viewport
     GLint viewport[4];
     glGetIntegerv(GL_VIEWPORT, viewport);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, map->fbo);
-    glViewport(0, 0, map->width, map->height);
-    glClear(GL_DEPTH_BUFFER_BIT);
+    glBindFramebuffer(GL_FRAMEBUFFER, map->depth.fbo);
+    glViewport(0, 0, map->depth.width, map->depth.height);
 
     glEnable(GL_CULL_FACE);
     glCullFace(GL_FRONT);
     glEnable(GL_POLYGON_OFFSET_FILL);
     glPolygonOffset(SHADOW_POLYGON_OFFSET_FACTOR, SHADOW_POLYGON_OFFSET_UNITS);
 
-    use_program(map->program);
-
-    send_sun_matrices(&(map->program), s);
-
-    // send cube vbo
-    send_cube_vbo(map->vao, map->cube_vbo);
-
-    if (packet != NULL) {
-        render_depth(map, packet->opaque_data, packet->num_opaque_sides);
-        render_depth(map, packet->transparent_data, packet->num_transparent_sides);
+    // The first cascade every frame, and at most one cached cascade so a
+    // sun step does not redraw them all at once
+    int cached_left = 1;
+    for (int i = 0; i < map->num_cascades; i++) {
+        if (!map->cascades[i].stale) {
+            continue;
+        }
+        if (i > 0 && map->cascades[i].drawn) {
+            if (cached_left == 0) {
+                continue;
+            }
+            cached_left--;
+        }
+        render_cascade(map, i, sun_dir, cam, arena);
     }
 
     glDisable(GL_POLYGON_OFFSET_FILL);
@@ -104,3 +235,12 @@ void render_shadow_map(FBO* map, sun* s, world_mesh* packet) {
     // Restore the viewport to what it was before
     glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
 }
+
+int get_shadow_cascades(shadow_map* map, mat4* light_spaces) {
+    int count = 0;
+    while (count < map->num_cascades && map->cascades[count].drawn) {
+        glm_mat4_copy(map->cascades[count].light_space, light_spaces[count]);
+        count++;
+    }
+    return count;
+}
@@ -3,7 +3,34 @@
 
 #include <fbo.h>
 
-FBO create_shadow_map(uint width, uint height);
-void render_shadow_map(FBO* map, sun* s, world_mesh* packet);
+// One layer of the shadow map, centred on where the player was when it was
+// last drawn
+typedef struct {
+    float radius;       // half the width it covers, in blocks
+    mat4 light_space;   // sun projection * view it was drawn with
+    vec3 center;
+    vec3 sun_dir;
+    int drawn;          // 0 until the first draw
+    int stale;          // waiting for a redraw
+} shadow_cascade;
+
+// Cascades of growing size in the layers of one depth texture array. The
+// first follows the player every frame, the wider ones are kept until the
+// sun turns, the player walks away from their centre or a chunk inside them
+// changes.
+typedef struct {
+    FBO depth;
+    int light_space_loc;
+    shadow_cascade cascades[MAX_SHADOW_CASCADES];
+    int num_cascades;
+} shadow_map;
+
+shadow_map create_shadow_map(uint width, uint height);
+void destroy_shadow_map(shadow_map* map);
+void render_shadow_map(shadow_map* map, sun* s, camera* cam, chunk_arena* arena);
+
+// Copy the light space matrices of the cascades drawn so far, returns how
+// many there are
+int get_shadow_cascades(shadow_map* map, mat4* light_spaces);
 
 #endif
@@ -4,18 +4,36 @@
 #include "../../world/core/world.h"
 #include <util.h>
 #include <glad/glad.h>
-#include <GLFW/glfw3.h>
+#include <gl_state.h>
 #include "sun.h"
 #include "util/settings.h"
 #include <mesh.h>
+#include "../../mesh/geometry/blockbench_loader.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+// Rotations are about the block center so a model stays in its cell
+static void build_model_rotations(mat4 rotations[MODEL_ROTATION_COUNT]) {
+    for (int i = 0; i < MODEL_ROTATION_COUNT; i++) {
+        glm_mat4_identity(rotations[i]);
+        glm_translate(rotations[i], (vec3){0.5f, 0.5f, 0.5f});
+        if (i < 4) {
+            glm_rotate(rotations[i], i * GLM_PIf / 2.0f, (vec3){0.0f, 1.0f, 0.0f});
+        } else {
+            glm_rotate(rotations[i], GLM_PIf, (vec3){1.0f, 0.0f, 0.0f});
+        }
+        glm_translate(rotations[i], (vec3){-0.5f, -0.5f, -0.5f});
+    }
+}
 
 blockbench_renderer create_blockbench_renderer(camera* cam, char* atlas_path, char* bump_path) {
     texture atlas = t_init(atlas_path, ATLAS_TEXTURE_INDEX);
     texture bump = t_init(bump_path, BUMP_TEXTURE_INDEX);
     
-    VAO vao = create_vao();
-    bind_vao(vao);
-    VBO vertex_vbo = create_vbo(GL_DYNAMIC_DRAW);
+    VBO instance_vbo = create_vbo(GL_DYNAMIC_DRAW);
 
     shader vertex_shader = create_shader(BLOCKBENCH_VERTEX_SHADER, GL_VERTEX_SHADER);
     shader fragment_shader = create_shader(BLOCKBENCH_FRAGMENT_SHADER, GL_FRAGMENT_SHADER);
@@ -28,105 +46,221 @@ blockbench_renderer create_blockbench_renderer(camera* cam, char* atlas_path, ch
         .program = program,
         .atlas = atlas,
         .bump = bump,
-        .vao = vao,
-        .vertex_vbo = vertex_vbo
+        .instance_vbo = instance_vbo,
+        .uploaded_version = 0,
+        .instances = NULL,
+        .instance_capacity = 0,
+        .runs = NULL,
+        .num_runs = 0,
+        .run_capacity = 0,
+        .models = NULL,
+        .num_models = 0
     };
+    build_model_rotations(br.rotations);
+
+    // Samplers sit on fixed units and the rotations never change
+    use_program(program);
+    glUniform1i(glGetUniformLocation(program.id, "atlas"), atlas.tex_index);
+    glUniform1i(glGetUniformLocation(program.id, "bump"), bump.tex_index);
+    glUniform1i(glGetUniformLocation(program.id, "shadowMap"), SHADOW_MAP_TEXTURE_INDEX);
+    glUniform1f(glGetUniformLocation(program.id, "atlasSize"), (float)ATLAS_SIZE);
+    glUniformMatrix4fv(glGetUniformLocation(program.id, "modelRotations"), MODEL_ROTATION_COUNT, GL_FALSE, (float*)br.rotations);
 
     return br;
 }
 
 void destroy_blockbench_renderer(blockbench_renderer br) {
-    delete_vao(br.vao);
-    delete_vbo(br.vertex_vbo);
+    for (int i = 0; i < br.num_models; i++) {
+        delete_vao(br.models[i].vao);
+        delete_vbo(br.models[i].vertex_vbo);
+    }
+    free(br.models);
+    free(br.instances);
+    free(br.runs);
+    delete_vbo(br.instance_vbo);
     delete_program(br.program);
     t_cleanup(&(br.atlas));
     t_cleanup(&(br.bump));
 }
 
-void send_blockbench_view_matrix(blockbench_renderer* br) {
-    mat4 view;
-    get_view_matrix(*(br->cam), &view);
-    uint view_loc = glGetUniformLocation(br->program.id, "view");
-    glUniformMatrix4fv(view_loc, 1, GL_FALSE, (float*)view);
+// Upload geometry for any models registered since the last frame.
+// Indices are expanded so each model is a plain triangle list.
+static void sync_blockbench_models(blockbench_renderer* br) {
+    int model_count = get_blockbench_model_count();
+    if (model_count <= br->num_models) {
+        return;
+    }
+
+    blockbench_gpu_model* models = realloc(br->models, model_count * sizeof(blockbench_gpu_model));
+    if (models == NULL) {
+        fprintf(stderr, "ERROR: Failed to allocate Blockbench GPU models\n");
+        return;
+    }
+    br->models = models;
+
+    for (int i = br->num_models; i < model_count; i++) {
+        blockbench_model* model = get_blockbench_model_by_id(i);
+        blockbench_gpu_model* gpu = &br->models[i];
+        gpu->vao = create_vao();
+        gpu->vertex_vbo = create_vbo(GL_STATIC_DRAW);
+        gpu->vertex_count = 0;
+
+        if (model == NULL || model->index_count == 0) {
+            continue;
+        }
+
+        blockbench_vertex* vertices = malloc(model->index_count * sizeof(blockbench_vertex));
+        if (vertices == NULL) {
+            fprintf(stderr, "ERROR: Failed to allocate vertices for model %s\n", model->name);
+            continue;
+        }
+        for (int j = 0; j < model->index_count; j++) {
+            vertices[j] = model->vertices[model->indices[j]];
+        }
+
+        bind_vao(gpu->vao);
+        buffer_data(gpu->vertex_vbo, GL_STATIC_DRAW, vertices,
+                    model->index_count * sizeof(blockbench_vertex));
+        f_add_attrib(&gpu->vertex_vbo, 0, 3, offsetof(blockbench_vertex, position), sizeof(blockbench_vertex)); // position
+        f_add_attrib(&gpu->vertex_vbo, 1, 3, offsetof(blockbench_vertex, normal), sizeof(blockbench_vertex)); // normal
+        f_add_attrib(&gpu->vertex_vbo, 2, 2, offsetof(blockbench_vertex, uv), sizeof(blockbench_vertex)); // uv
+        glVertexAttribDivisor(3, 1);
+        glVertexAttribDivisor(4, 1);
+        gpu->vertex_count = model->index_count;
+
+        free(vertices);
+    }
+
+    br->num_models = model_count;
+}
+
+static int instance_chunk(int pos) {
+    return (int)floorf((float)pos / (float)CHUNK_SIZE);
+}
+
+static int instance_section(const model_instance* instance) {
+    return instance->y / VISIBILITY_SECTION_HEIGHT;
 }
 
-void send_blockbench_proj_matrix(blockbench_renderer* br) {
-    mat4 proj;
-    get_projection_matrix(&proj, RADS(FOV), (float)WIDTH / (float)HEIGHT, 0.1f, RENDER_DISTANCE);
-    uint proj_loc = glGetUniformLocation(br->program.id, "proj");
-    glUniformMatrix4fv(proj_loc, 1, GL_FALSE, (float*)proj);
+static int compare_model_instances(const void* a, const void* b) {
+    const model_instance* ia = a;
+    const model_instance* ib = b;
+    int keys_a[4] = {ia->model_id, instance_chunk(ia->x), instance_chunk(ia->z), instance_section(ia)};
+    int keys_b[4] = {ib->model_id, instance_chunk(ib->x), instance_chunk(ib->z), instance_section(ib)};
+    for (int i = 0; i < 4; i++) {
+        if (keys_a[i] != keys_b[i]) {
+            return keys_a[i] < keys_b[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+static void push_instance_run(blockbench_renderer* br, model_instance_run run) {
+    if (br->num_runs == br->run_capacity) {
+        br->run_capacity = br->run_capacity > 0 ? br->run_capacity * 2 : 64;
+        br->runs = realloc(br->runs, br->run_capacity * sizeof(model_instance_run));
+        assert(br->runs != NULL && "Failed to grow Blockbench instance runs");
+    }
+    br->runs[br->num_runs++] = run;
 }
 
-void send_blockbench_atlas(blockbench_renderer* br) {
-    glActiveTexture(GL_TEXTURE0 + br->atlas.tex_index);
-    glBindTexture(GL_TEXTURE_2D, br->atlas.id);
-    uint atlas_loc = glGetUniformLocation(br->program.id, "atlas");
-    glUniform1i(atlas_loc, br->atlas.tex_index);
+// Upload the instances of a new world mesh, sorted so each chunk section's
+// instances of a model are one run. Meshes are told apart by version, a new
+// one can be allocated where a freed one was.
+static void upload_model_instances(blockbench_renderer* br, world_mesh* packet) {
+    if (packet->version == br->uploaded_version) {
+        return;
+    }
+    br->uploaded_version = packet->version;
+    br->num_runs = 0;
 
-    glActiveTexture(GL_TEXTURE0 + br->bump.tex_index);
-    glBindTexture(GL_TEXTURE_2D, br->bump.id);
-    uint bump_loc = glGetUniformLocation(br->program.id, "bump");
-    glUniform1i(bump_loc, br->bump.tex_index);
+    int count = packet->model_instances != NULL ? packet->num_model_instances : 0;
+    if (count == 0) {
+        return;
+    }
+    if (count > br->instance_capacity) {
+        br->instance_capacity = count;
+        br->instances = realloc(br->instances, count * sizeof(model_instance));
+        assert(br->instances != NULL && "Failed to grow Blockbench instances");
+    }
+    memcpy(br->instances, packet->model_instances, count * sizeof(model_instance));
+    qsort(br->instances, count, sizeof(model_instance), compare_model_instances);
+
+    for (int i = 0; i < count; i++) {
+        model_instance* instance = &br->instances[i];
+        model_instance_run run = {
+            .model_id = instance->model_id,
+            .chunk_x = instance_chunk(instance->x),
+            .chunk_z = instance_chunk(instance->z),
+            .section = instance_section(instance),
+            .first = i,
+            .count = 1
+        };
+        model_instance_run* last = br->num_runs > 0 ? &br->runs[br->num_runs - 1] : NULL;
+        if (last != NULL && last->model_id == run.model_id && last->chunk_x == run.chunk_x
+            && last->chunk_z == run.chunk_z && last->section == run.section) {
+            last->count++;
+        } else {
+            push_instance_run(br, run);
+        }
+    }
 
-    uint atlas_size_loc = glGetUniformLocation(br->program.id, "atlasSize");
-    glUniform1f(atlas_size_loc, (float)ATLAS_SIZE);
+    buffer_data(br->instance_vbo, GL_STATIC_DRAW, br->instances, count * sizeof(model_instance));
 }
 
-void send_blockbench_fog(blockbench_renderer* br) {
-    uint fog_loc = glGetUniformLocation(br->program.id, "fogDistance");
-    glUniform1f(fog_loc, RENDER_DISTANCE);
+static int instance_run_visible(chunk_arena* arena, model_instance_run* run) {
+    uint32_t sections = chunk_arena_visible_sections(arena, run->chunk_x, run->chunk_z);
+    return run->section >= 0 && run->section < VISIBILITY_SECTIONS && (sections & (1u << run->section));
 }
 
-void send_blockbench_time(blockbench_renderer* br) {
-    float current_time = (float)glfwGetTime();
-    glUniform1f(glGetUniformLocation(br->program.id, "time"), current_time);
+static void draw_model_instances(blockbench_renderer* br, int model_id, int first, int count) {
+    if (model_id < 0 || model_id >= br->num_models || br->models[model_id].vertex_count == 0) {
+        return;
+    }
+
+    blockbench_gpu_model* gpu = &br->models[model_id];
+    bind_vao(gpu->vao);
+    use_vbo(br->instance_vbo);
+    i_add_attrib(&br->instance_vbo, 3, 3, first * sizeof(model_instance) + offsetof(model_instance, x), sizeof(model_instance)); // position
+    i_add_attrib(&br->instance_vbo, 4, 1, first * sizeof(model_instance) + offsetof(model_instance, rotation), sizeof(model_instance)); // rotation
+
+    glDrawArraysInstanced(GL_TRIANGLES, 0, gpu->vertex_count, count);
 }
 
-void render_blockbench_models(blockbench_renderer* br, sun* sun, FBO* shadow_map, world_mesh* packet) {
-    if (packet == NULL || packet->custom_model_data == NULL || packet->num_custom_verts == 0) {
+void render_blockbench_models(blockbench_renderer* br, FBO* shadow_map, world_mesh* packet, chunk_arena* arena) {
+    if (packet == NULL) {
+        return;
+    }
+
+    // A mesh without instances still replaces the runs of the last one
+    upload_model_instances(br, packet);
+    if (br->num_runs == 0) {
         return;
     }
+    sync_blockbench_models(br);
 
+    // Camera, sun, fog and shadow uniforms come from the shared blocks
     use_program(br->program);
-    bind_vao(br->vao);
-
-    // Send uniforms
-    send_blockbench_view_matrix(br);
-    send_blockbench_proj_matrix(br);
-    send_blockbench_atlas(br);
-    send_blockbench_fog(br);
-    send_blockbench_time(br);
-    send_sun_info(&(br->program), sun);
-    send_ambient_light(&(br->program));
-    send_sun_matrices(&(br->program), sun);
-    send_fbo_texture(&(br->program), shadow_map, SHADOW_MAP_TEXTURE_INDEX, "shadowMap");
-    send_shadow_info(&(br->program));
-
-    // Buffer vertex data
-    use_vbo(br->vertex_vbo);
-    buffer_data(br->vertex_vbo, GL_DYNAMIC_DRAW, packet->custom_model_data, 
-                packet->num_custom_verts * FLOATS_PER_MODEL_VERT * sizeof(float));
-
-    // Set vertex attributes
-    // Position (location 0): 3 floats at offset 0
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, FLOATS_PER_MODEL_VERT * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    // Normal (location 1): 3 floats at offset 3
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, FLOATS_PER_MODEL_VERT * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    // UV (location 2): 2 floats at offset 6
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, FLOATS_PER_MODEL_VERT * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-    // Draw all vertices
-    glDrawArrays(GL_TRIANGLES, 0, packet->num_custom_verts);
-
-    // Disable vertex attributes
-    glDisableVertexAttribArray(0);
-    glDisableVertexAttribArray(1);
-    glDisableVertexAttribArray(2);
+    t_bind(&br->atlas);
+    t_bind(&br->bump);
+    gl_state_bind_texture_array(SHADOW_MAP_TEXTURE_INDEX, shadow_map->texture);
+
+    // One instanced draw per stretch of visible runs of the same model
+    int i = 0;
+    while (i < br->num_runs) {
+        model_instance_run* run = &br->runs[i++];
+        if (!instance_run_visible(arena, run)) {
+            continue;
+        }
+
+        int first = run->first;
+        int count = run->count;
+        while (i < br->num_runs && br->runs[i].model_id == run->model_id
+            && instance_run_visible(arena, &br->runs[i])) {
+            count += br->runs[i++].count;
+        }
+        draw_model_instances(br, run->model_id, first, count);
+    }
 
     stop_program();
 }
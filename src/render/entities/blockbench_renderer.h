@@ -9,10 +9,36 @@
 #include <sun.h>
 #include <fbo.h>
 #include <world_mesh.h>
+#include <chunk_arena.h>
 
+// Geometry of one Blockbench model, uploaded once and drawn per instance
 typedef struct {
     VAO vao;
     VBO vertex_vbo;
+    int vertex_count;
+} blockbench_gpu_model;
+
+// Instances of one model in one chunk section, next to each other in the
+// instance buffer
+typedef struct {
+    int model_id;
+    int chunk_x, chunk_z;
+    int section;
+    int first;
+    int count;
+} model_instance_run;
+
+typedef struct {
+    VBO instance_vbo;
+    unsigned int uploaded_version; // world mesh whose instances are in instance_vbo
+    model_instance* instances;     // sorted by model, chunk and section
+    int instance_capacity;
+    model_instance_run* runs;
+    int num_runs;
+    int run_capacity;
+    blockbench_gpu_model* models;  // indexed by blockbench_model id
+    int num_models;
+    mat4 rotations[MODEL_ROTATION_COUNT];
     shader_program program;
     camera* cam;
     texture atlas;
@@ -22,12 +48,7 @@ typedef struct {
 blockbench_renderer create_blockbench_renderer(camera* cam, char* atlas, char* bump);
 void destroy_blockbench_renderer(blockbench_renderer br);
 
-void send_blockbench_view_matrix(blockbench_renderer* br);
-void send_blockbench_proj_matrix(blockbench_renderer* br);
-void send_blockbench_atlas(blockbench_renderer* br);
-void send_blockbench_fog(blockbench_renderer* br);
-void send_blockbench_time(blockbench_renderer* br);
-
-void render_blockbench_models(blockbench_renderer* br, sun* sun, FBO* shadow_map, world_mesh* packet);
+// Draw the instances in the sections the arena's last cull found visible
+void render_blockbench_models(blockbench_renderer* br, FBO* shadow_map, world_mesh* packet, chunk_arena* arena);
 
 #endif
@@ -71,6 +71,7 @@ outline_renderer create_outline_renderer(camera* cam) {
         .vbo = vbo,
         .program = program,
         .cam = cam,
+        .model_loc = glGetUniformLocation(program.id, "model"),
     };
 
     return or;
@@ -82,38 +83,20 @@ void destroy_outline_renderer(outline_renderer or) {
     delete_program(or.program);
 }
 
-void send_outline_view_matrix(outline_renderer* or) {
-    mat4 view;
-    get_view_matrix(*(or->cam), &view);
-    uint view_loc = glGetUniformLocation(or->program.id, "view");
-    glUniformMatrix4fv(view_loc, 1, GL_FALSE, (float*)view);
-}
-
-void send_outline_proj_matrix(outline_renderer* or) {
-    mat4 proj;
-    get_projection_matrix(&proj, RADS(FOV), (float)WIDTH / (float)HEIGHT, 0.1f, RENDER_DISTANCE);
-    uint proj_loc = glGetUniformLocation(or->program.id, "proj");
-    glUniformMatrix4fv(proj_loc, 1, GL_FALSE, (float*)proj);
-}
-
 void render_outline(outline_renderer* or, int block_x, int block_y, int block_z) {
     if (or == NULL) {
         return;
     }
 
-    // Use the outline shader program
+    // Use the outline shader program, view and projection come from the
+    // camera uniform block
     use_program(or->program);
 
-    // Set up matrices
-    send_outline_view_matrix(or);
-    send_outline_proj_matrix(or);
-
     // Create model matrix for the block position
     mat4 model = GLM_MAT4_IDENTITY_INIT;
     glm_translate(model, (vec3){(float)block_x, (float)block_y, (float)block_z});
 
-    uint model_loc = glGetUniformLocation(or->program.id, "model");
-    glUniformMatrix4fv(model_loc, 1, GL_FALSE, (float*)model);
+    glUniformMatrix4fv(or->model_loc, 1, GL_FALSE, (float*)model);
 
     // Enable polygon offset to render outline on top of the block
     glEnable(GL_POLYGON_OFFSET_LINE);
@@ -12,13 +12,12 @@ typedef struct {
     VBO vbo;
     shader_program program;
     camera* cam;
+    int model_loc;
 } outline_renderer;
 
 outline_renderer create_outline_renderer(camera* cam);
 void destroy_outline_renderer(outline_renderer or);
 
-void send_outline_view_matrix(outline_renderer* or);
-void send_outline_proj_matrix(outline_renderer* or);
 void render_outline(outline_renderer* or, int block_x, int block_y, int block_z);
 
 #endif
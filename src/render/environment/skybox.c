@@ -81,6 +81,9 @@ skybox create_skybox(camera* cam) {
     delete_shader(vert_shader);
     delete_shader(frag_shader);
 
+    use_program(program);
+    glUniform1i(glGetUniformLocation(program.id, "skybox"), sky.tex_index);
+
     skybox s = {
         .vertices = data,
         .vertex_count = count,
@@ -88,7 +91,9 @@ skybox create_skybox(camera* cam) {
         .vbo = vbo,
         .program = program,
         .texture = sky,
-        .cam = cam
+        .cam = cam,
+        .view_loc = glGetUniformLocation(program.id, "view"),
+        .proj_loc = glGetUniformLocation(program.id, "proj")
     };
 
     return s;
@@ -107,27 +112,18 @@ void get_rotation_matrix(camera* cam, mat4* out) {
     glm_mat4_inv(view, *out);
 }
 
-void send_sky_view_matrix(shader_program* p, camera* cam) {
+void send_sky_view_matrix(int view_loc, camera* cam) {
     mat4 view;
     get_rotation_matrix(cam, &view);
-    uint view_loc = glGetUniformLocation(p->id, "view");
     glUniformMatrix4fv(view_loc, 1, GL_FALSE, (float*)view);
 }
 
-void send_sky_proj_matrix(shader_program* p) {
+void send_sky_proj_matrix(int proj_loc) {
     mat4 proj;
     get_projection_matrix(&proj, RADS(FOV), (float)WIDTH / (float)HEIGHT, 0.1f, RENDER_DISTANCE);
-    uint proj_loc = glGetUniformLocation(p->id, "proj");
     glUniformMatrix4fv(proj_loc, 1, GL_FALSE, (float*)proj);
 }
 
-void send_texture(skybox* s) {
-    glActiveTexture(GL_TEXTURE0 + s->texture.tex_index);
-    glBindTexture(GL_TEXTURE_2D, s->texture.id);
-    uint tex_loc = glGetUniformLocation(s->program.id, "skybox");
-    glUniform1i(tex_loc, s->texture.tex_index);
-}
-
 void render_skybox(skybox* s) {
     glDisable(GL_DEPTH_TEST);
     use_program(s->program);
@@ -135,9 +131,9 @@ void render_skybox(skybox* s) {
 
     glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
-    send_sky_view_matrix(&(s->program), s->cam);
-    send_sky_proj_matrix(&(s->program));
-    send_texture(s);
+    send_sky_view_matrix(s->view_loc, s->cam);
+    send_sky_proj_matrix(s->proj_loc);
+    t_bind(&s->texture);
 
     int vertices_per_stack = 2 * (SKYBOX_SLICES + 1);
     
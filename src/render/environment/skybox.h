@@ -19,12 +19,14 @@ typedef struct {
     camera* cam;
 
     shader_program program;
+    int view_loc;
+    int proj_loc;
 } skybox;
 
 skybox create_skybox(camera* cam);
 void skybox_cleanup(skybox* s);
 void render_skybox(skybox* s);
-void send_sky_view_matrix(shader_program* p, camera* cam);
-void send_sky_proj_matrix(shader_program* p);
+void send_sky_view_matrix(int view_loc, camera* cam);
+void send_sky_proj_matrix(int proj_loc);
 
 #endif
\ No newline at end of file
@@ -61,6 +61,11 @@ sun create_sun(camera* cam, float r, float b, float g) {
     use_program(program);
     bind_vao(vao);
 
+    // Color and intensity never change, the world shaders read them from
+    // the sun uniform block
+    glUniform1f(glGetUniformLocation(program.id, "sunIntensity"), SUN_INTENSITY);
+    glUniform3f(glGetUniformLocation(program.id, "sunColor"), r, g, b);
+
     // buffer points to GPU
     buffer_data(vbo, GL_STATIC_DRAW, vertices, count * sizeof(float));
     f_add_attrib(&vbo, 0, 3, 0, 3 * sizeof(float));
@@ -80,7 +85,10 @@ sun create_sun(camera* cam, float r, float b, float g) {
         .vbo = vbo,
         .program = program,
         .vertices = vertices,
-        .vertex_count = count
+        .vertex_count = count,
+        .view_loc = glGetUniformLocation(program.id, "view"),
+        .proj_loc = glGetUniformLocation(program.id, "proj"),
+        .sun_pos_loc = glGetUniformLocation(program.id, "sunPos")
     };
 
     return s;
@@ -93,15 +101,6 @@ void sun_cleanup(sun* s) {
     free(s->vertices);
 }
 
-void send_sun_info(shader_program* p, sun* s) {
-    glUniform3f(glGetUniformLocation(p->id, "sunPos"), s->x, s->y, s->z);
-    glUniform1f(glGetUniformLocation(p->id, "sunIntensity"), SUN_INTENSITY);
-    glUniform3f(glGetUniformLocation(p->id, "sunColor"), s->r, s->g, s->b);
-    glUniform1f(glGetUniformLocation(p->id, "sunSpecularStrength"), SUN_SPECULAR_STRENGTH);
-    glUniform3f(glGetUniformLocation(p->id, "cameraPos"), s->cam->position[0], s->cam->position[1], s->cam->position[2]);
-    glUniform1f(glGetUniformLocation(p->id, "waterShininess"), WATER_SHININESS);
-}
-
 void update_sun(sun* s, int t) {
     float ellipticalFactor = 3;  // Stretches the orbit horizontally
     // TIME_SCALE: 0.0001047 represents a full day cycle in ~60 seconds
@@ -122,10 +121,9 @@ void render_sun(sun* s, int tick) {
     bind_vao(s->vao);
     use_vbo(s->vbo);
 
-    send_sky_view_matrix(&(s->program), s->cam);
-    send_sky_proj_matrix(&(s->program));
-
-    send_sun_info(&(s->program), s);
+    send_sky_view_matrix(s->view_loc, s->cam);
+    send_sky_proj_matrix(s->proj_loc);
+    glUniform3f(s->sun_pos_loc, s->x, s->y, s->z);
 
     int vertices_per_stack = 2 * (SKYBOX_SLICES + 1);
     
@@ -17,13 +17,14 @@ typedef struct {
     shader_program program;
     float* vertices;
     int vertex_count;
+    int view_loc;
+    int proj_loc;
+    int sun_pos_loc;
 } sun;
 
 sun create_sun(camera* cam, float r, float g, float b);
 void sun_cleanup(sun* s);
 
-void send_sun_info(shader_program* p, sun* s);
-
 void update_sun(sun* s, int t);
 void render_sun(sun* s, int tick);
 
@@ -0,0 +1,746 @@
+#include "chunk_arena.h"
+
+#include <assert.h>
+#include <math.h>
+#include <glad/glad.h>
+#include <block_models.h>
+#include <chunk_mesh.h>
+#include <util/settings.h>
+
+#define SIDE_ARENA_MIN_CAPACITY 65536
+#define SIDE_STRIDE (VBO_WIDTH * sizeof(int))
+
+// Chunks this close to the camera's chunk are always drawn, and boxes are
+// padded, so nothing right next to the camera pops
+#define CHUNK_CULL_PADDING 2.0f
+#define CHUNK_CULL_NEARBY 1
+
+#define ALL_SECTIONS (VISIBILITY_SECTIONS == 32 ? 0xFFFFFFFFu : (1u << VISIBILITY_SECTIONS) - 1)
+
+// Block side order, NORTH to DOWN
+static const int side_opposite[6] = {2, 3, 0, 1, 5, 4};
+
+static void create_side_arena(side_arena* arena) {
+    arena->vbo = create_vbo(GL_DYNAMIC_DRAW);
+    arena->capacity = 0;
+    arena->used = 0;
+    arena->free_ranges = NULL;
+    arena->num_free_ranges = 0;
+    arena->free_range_capacity = 0;
+}
+
+static void destroy_side_arena(side_arena* arena) {
+    delete_vbo(arena->vbo);
+    free(arena->free_ranges);
+    arena->free_ranges = NULL;
+    arena->num_free_ranges = 0;
+    arena->capacity = 0;
+    arena->used = 0;
+}
+
+static void insert_free_range(side_arena* arena, int index, side_range range) {
+    if (arena->num_free_ranges == arena->free_range_capacity) {
+        arena->free_range_capacity = arena->free_range_capacity > 0 ? arena->free_range_capacity * 2 : 64;
+        arena->free_ranges = realloc(arena->free_ranges, arena->free_range_capacity * sizeof(side_range));
+        assert(arena->free_ranges != NULL && "Failed to grow side arena free list");
+    }
+    memmove(&arena->free_ranges[index + 1], &arena->free_ranges[index],
+        (arena->num_free_ranges - index) * sizeof(side_range));
+    arena->free_ranges[index] = range;
+    arena->num_free_ranges++;
+}
+
+static void remove_free_range(side_arena* arena, int index) {
+    memmove(&arena->free_ranges[index], &arena->free_ranges[index + 1],
+        (arena->num_free_ranges - index - 1) * sizeof(side_range));
+    arena->num_free_ranges--;
+}
+
+// Give a range back, merging it with the free ranges either side
+static void free_sides(side_arena* arena, side_range range) {
+    if (range.count <= 0) {
+        return;
+    }
+    arena->used -= range.count;
+
+    // First free range after this one
+    int lo = 0;
+    int hi = arena->num_free_ranges;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (arena->free_ranges[mid].first < range.first) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    side_range* prev = lo > 0 ? &arena->free_ranges[lo - 1] : NULL;
+    side_range* next = lo < arena->num_free_ranges ? &arena->free_ranges[lo] : NULL;
+    int joins_prev = prev != NULL && prev->first + prev->count == range.first;
+    int joins_next = next != NULL && range.first + range.count == next->first;
+
+    if (joins_prev && joins_next) {
+        prev->count += range.count + next->count;
+        remove_free_range(arena, lo);
+    } else if (joins_prev) {
+        prev->count += range.count;
+    } else if (joins_next) {
+        next->first = range.first;
+        next->count += range.count;
+    } else {
+        insert_free_range(arena, lo, range);
+    }
+}
+
+// Move the buffer into a larger one on the GPU, the sides keep their offsets
+static void grow_side_arena(side_arena* arena, int min_extra) {
+    int capacity = arena->capacity > 0 ? arena->capacity * 2 : SIDE_ARENA_MIN_CAPACITY;
+    if (capacity < arena->capacity + min_extra) {
+        capacity = arena->capacity + min_extra;
+    }
+
+    VBO vbo = create_vbo(GL_DYNAMIC_DRAW);
+    buffer_data(vbo, GL_DYNAMIC_DRAW, NULL, capacity * SIDE_STRIDE);
+    if (arena->capacity > 0) {
+        glBindBuffer(GL_COPY_READ_BUFFER, arena->vbo.id);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vbo.id);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, arena->capacity * SIDE_STRIDE);
+    }
+    delete_vbo(arena->vbo);
+    arena->vbo = vbo;
+
+    // The new space is free, counted as used until free_sides hands it out
+    side_range added = {arena->capacity, capacity - arena->capacity};
+    arena->capacity = capacity;
+    arena->used += added.count;
+    free_sides(arena, added);
+}
+
+// First fit, growing the buffer when no free range is large enough
+static side_range alloc_sides(side_arena* arena, int count) {
+    for (;;) {
+        for (int i = 0; i < arena->num_free_ranges; i++) {
+            side_range* free_range = &arena->free_ranges[i];
+            if (free_range->count < count) {
+                continue;
+            }
+
+            side_range range = {free_range->first, count};
+            free_range->first += count;
+            free_range->count -= count;
+            if (free_range->count == 0) {
+                remove_free_range(arena, i);
+            }
+            arena->used += count;
+            return range;
+        }
+        grow_side_arena(arena, count);
+    }
+}
+
+chunk_arena create_chunk_arena(void) {
+    chunk_arena arena = {0};
+    for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+        create_side_arena(&arena.layers[layer]);
+    }
+    key_index_init(&arena.chunk_index);
+
+    if (GLAD_GL_VERSION_4_3) {
+        arena.draw_path = CHUNK_DRAW_MULTI_INDIRECT;
+        for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+            arena.view.commands[layer] = create_vbo(GL_STREAM_DRAW);
+            arena.shadow.commands[layer] = create_vbo(GL_STREAM_DRAW);
+            arena.reflection.commands[layer] = create_vbo(GL_STREAM_DRAW);
+        }
+    } else if (GLAD_GL_VERSION_4_2) {
+        arena.draw_path = CHUNK_DRAW_BASE_INSTANCE;
+    } else {
+        arena.draw_path = CHUNK_DRAW_ATTRIB_OFFSET;
+    }
+    return arena;
+}
+
+static void destroy_draw_list(chunk_arena* arena, chunk_draw_list* list) {
+    for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+        free(list->draws[layer]);
+        list->draws[layer] = NULL;
+        list->num_draws[layer] = 0;
+        list->draw_capacity[layer] = 0;
+        if (arena->draw_path == CHUNK_DRAW_MULTI_INDIRECT) {
+            delete_vbo(list->commands[layer]);
+        }
+    }
+}
+
+void destroy_chunk_arena(chunk_arena* arena) {
+    for (int i = 0; i < arena->num_chunks; i++) {
+        for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+            release_packed_sides(arena->chunks[i].uploaded[layer]);
+        }
+    }
+    for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+        destroy_side_arena(&arena->layers[layer]);
+    }
+    destroy_draw_list(arena, &arena->view);
+    destroy_draw_list(arena, &arena->shadow);
+    destroy_draw_list(arena, &arena->reflection);
+    free(arena->command_scratch);
+    arena->command_scratch = NULL;
+    arena->command_capacity = 0;
+    free(arena->cull_queue);
+    arena->cull_queue = NULL;
+    arena->cull_queue_capacity = 0;
+    free(arena->evicted);
+    arena->evicted = NULL;
+    arena->num_evicted = 0;
+    arena->evicted_capacity = 0;
+    free(arena->chunks);
+    arena->chunks = NULL;
+    arena->num_chunks = 0;
+    arena->chunk_capacity = 0;
+    key_index_free(&arena->chunk_index);
+}
+
+static resident_chunk* get_resident_chunk(chunk_arena* arena, int x, int z) {
+    uint64_t key = chunk_work_key(x, z);
+    uint64_t index;
+    if (key_index_get(&arena->chunk_index, key, &index)) {
+        return &arena->chunks[index];
+    }
+
+    if (arena->num_chunks == arena->chunk_capacity) {
+        arena->chunk_capacity = arena->chunk_capacity > 0 ? arena->chunk_capacity * 2 : 256;
+        arena->chunks = realloc(arena->chunks, arena->chunk_capacity * sizeof(resident_chunk));
+        assert(arena->chunks != NULL && "Failed to grow chunk arena");
+    }
+    key_index_put(&arena->chunk_index, key, (uint64_t)arena->num_chunks);
+
+    resident_chunk* chunk = &arena->chunks[arena->num_chunks++];
+    memset(chunk, 0, sizeof(resident_chunk));
+    chunk->x = x;
+    chunk->z = z;
+    return chunk;
+}
+
+static void release_layer(chunk_arena* arena, resident_chunk* chunk, int layer) {
+    if (chunk->uploaded[layer] != NULL) {
+        chunk->changed_frame = arena->frame;
+    }
+    free_sides(&arena->layers[layer], chunk->slots[layer]);
+    chunk->slots[layer] = (side_range){0, 0};
+    chunk->num_sides[layer] = 0;
+    release_packed_sides(chunk->uploaded[layer]);
+    chunk->uploaded[layer] = NULL;
+}
+
+// Write a new version of a layer, in place when it still fits its slot
+static void upload_layer(chunk_arena* arena, resident_chunk* chunk, int layer, packed_sides* sides) {
+    side_arena* side_arena = &arena->layers[layer];
+    if (sides->num_sides > chunk->slots[layer].count) {
+        free_sides(side_arena, chunk->slots[layer]);
+        chunk->slots[layer] = alloc_sides(side_arena, sides->num_sides);
+    }
+
+    size_t bytes = (size_t)sides->num_sides * SIDE_STRIDE;
+    use_vbo(side_arena->vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)(chunk->slots[layer].first * SIDE_STRIDE), bytes, sides->data);
+    arena->uploaded_bytes += bytes;
+
+    chunk->num_sides[layer] = sides->num_sides;
+    chunk->changed_frame = arena->frame;
+    release_packed_sides(chunk->uploaded[layer]);
+    chunk->uploaded[layer] = retain_packed_sides(sides);
+}
+
+// Free the slots of chunks the last sync did not see
+static void evict_chunks(chunk_arena* arena) {
+    arena->num_evicted = 0;
+    int i = 0;
+    while (i < arena->num_chunks) {
+        resident_chunk* chunk = &arena->chunks[i];
+        if (chunk->frame == arena->frame) {
+            i++;
+            continue;
+        }
+
+        for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+            release_layer(arena, chunk, layer);
+        }
+        if (arena->num_evicted == arena->evicted_capacity) {
+            arena->evicted_capacity = arena->evicted_capacity > 0 ? arena->evicted_capacity * 2 : 64;
+            arena->evicted = realloc(arena->evicted, arena->evicted_capacity * sizeof(evicted_chunk));
+            assert(arena->evicted != NULL && "Failed to grow chunk arena evictions");
+        }
+        arena->evicted[arena->num_evicted++] = (evicted_chunk){chunk->x, chunk->z};
+        key_index_remove(&arena->chunk_index, chunk_work_key(chunk->x, chunk->z));
+
+        arena->num_chunks--;
+        if (i < arena->num_chunks) {
+            *chunk = arena->chunks[arena->num_chunks];
+            key_index_put(&arena->chunk_index, chunk_work_key(chunk->x, chunk->z), (uint64_t)i);
+        }
+    }
+}
+
+static void push_draw(chunk_draw_list* list, int layer, side_range range) {
+    if (list->num_draws[layer] == list->draw_capacity[layer]) {
+        list->draw_capacity[layer] = list->draw_capacity[layer] > 0 ? list->draw_capacity[layer] * 2 : 256;
+        list->draws[layer] = realloc(list->draws[layer], list->draw_capacity[layer] * sizeof(side_range));
+        assert(list->draws[layer] != NULL && "Failed to grow chunk arena draw list");
+    }
+    list->draws[layer][list->num_draws[layer]++] = range;
+}
+
+static int compare_side_ranges(const void* a, const void* b) {
+    return ((const side_range*)a)->first - ((const side_range*)b)->first;
+}
+
+// Liquids, and without OIT the blended layers, are drawn back to front in
+// world mesh order. The rest can go in buffer order.
+static int layer_needs_order(int layer) {
+    if (layer == MESH_LAYER_LIQUID) {
+        return 1;
+    }
+    return !ORDER_INDEPENDENT_TRANSPARENCY
+        && (layer == MESH_LAYER_TRANSPARENT || layer == MESH_LAYER_FOLIAGE);
+}
+
+// Join draws that continue where the previous one ends
+static void merge_draws(chunk_draw_list* list, int layer) {
+    side_range* draws = list->draws[layer];
+    int count = list->num_draws[layer];
+    if (count < 2) {
+        return;
+    }
+
+    if (!layer_needs_order(layer)) {
+        qsort(draws, count, sizeof(side_range), compare_side_ranges);
+    }
+
+    int merged = 0;
+    for (int i = 1; i < count; i++) {
+        if (draws[merged].first + draws[merged].count == draws[i].first) {
+            draws[merged].count += draws[i].count;
+        } else {
+            draws[++merged] = draws[i];
+        }
+    }
+    list->num_draws[layer] = merged + 1;
+}
+
+void sync_chunk_arena(chunk_arena* arena, world_mesh* mesh) {
+    arena->frame++;
+    arena->uploaded_bytes = 0;
+
+    if (mesh != NULL) {
+        for (int i = 0; i < mesh->num_chunks; i++) {
+            world_mesh_chunk* source = &mesh->chunks[i];
+            resident_chunk* chunk = get_resident_chunk(arena, source->x, source->z);
+            chunk->frame = arena->frame;
+            memcpy(chunk->visibility, source->visibility, sizeof(chunk->visibility));
+
+            for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+                packed_sides* sides = source->layers[layer];
+                if (sides == NULL) {
+                    release_layer(arena, chunk, layer);
+                    continue;
+                }
+                if (chunk->uploaded[layer] != sides) {
+                    upload_layer(arena, chunk, layer, sides);
+                }
+            }
+        }
+    }
+
+    evict_chunks(arena);
+}
+
+// Hand the merged draws of a layer to the GPU as indirect commands
+static void upload_commands(chunk_arena* arena, chunk_draw_list* list, int layer) {
+    int count = list->num_draws[layer];
+    if (count > arena->command_capacity) {
+        arena->command_capacity = count;
+        arena->command_scratch = realloc(arena->command_scratch, count * sizeof(draw_arrays_command));
+        assert(arena->command_scratch != NULL && "Failed to grow chunk arena commands");
+    }
+
+    for (int i = 0; i < count; i++) {
+        side_range range = list->draws[layer][i];
+        arena->command_scratch[i] = (draw_arrays_command){
+            .count = 6,
+            .instance_count = (uint)range.count,
+            .first = 0,
+            .base_instance = (uint)range.first
+        };
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, list->commands[layer].id);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, count * sizeof(draw_arrays_command), arena->command_scratch, GL_STREAM_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+static int chunk_nearby(resident_chunk* chunk, int cam_chunk_x, int cam_chunk_z) {
+    return abs(chunk->x - cam_chunk_x) <= CHUNK_CULL_NEARBY
+        && abs(chunk->z - cam_chunk_z) <= CHUNK_CULL_NEARBY;
+}
+
+// Sections first to last of the chunk at x, z against the padded frustum
+static int column_in_frustum(int x, int z, int first, int last, vec4 planes[6]) {
+    vec3 box[2] = {
+        {
+            (float)(x * CHUNK_SIZE) - CHUNK_CULL_PADDING,
+            (float)(first * VISIBILITY_SECTION_HEIGHT) - CHUNK_CULL_PADDING,
+            (float)(z * CHUNK_SIZE) - CHUNK_CULL_PADDING
+        },
+        {
+            (float)((x + 1) * CHUNK_SIZE) + CHUNK_CULL_PADDING,
+            (float)((last + 1) * VISIBILITY_SECTION_HEIGHT) + CHUNK_CULL_PADDING,
+            (float)((z + 1) * CHUNK_SIZE) + CHUNK_CULL_PADDING
+        }
+    };
+    return glm_aabb_frustum(box, planes);
+}
+
+static int sections_in_frustum(resident_chunk* chunk, int first, int last, vec4 planes[6]) {
+    return column_in_frustum(chunk->x, chunk->z, first, last, planes);
+}
+
+// Look up every chunk's horizontal neighbours, indices move on eviction so
+// this runs each cull
+static void link_chunk_neighbours(chunk_arena* arena) {
+    static const int offsets[4][2] = {{0, -1}, {1, 0}, {0, 1}, {-1, 0}};
+    for (int i = 0; i < arena->num_chunks; i++) {
+        resident_chunk* chunk = &arena->chunks[i];
+        for (int side = 0; side < 4; side++) {
+            uint64_t index;
+            int found = key_index_get(&arena->chunk_index,
+                chunk_work_key(chunk->x + offsets[side][0], chunk->z + offsets[side][1]), &index);
+            chunk->neighbours[side] = found ? (int)index : -1;
+        }
+        chunk->visible_sections = 0;
+    }
+}
+
+// Bit per section of chunk inside the frustum
+static uint32_t frustum_sections(resident_chunk* chunk, vec4 planes[6]) {
+    if (!sections_in_frustum(chunk, 0, VISIBILITY_SECTIONS - 1, planes)) {
+        return 0;
+    }
+    uint32_t sections = 0;
+    for (int section = 0; section < VISIBILITY_SECTIONS; section++) {
+        if (sections_in_frustum(chunk, section, section, planes)) {
+            sections |= 1u << section;
+        }
+    }
+    return sections;
+}
+
+// Without occlusion culling every section in the frustum is visible
+static void mark_sections_in_frustum(chunk_arena* arena, vec4 planes[6]) {
+    for (int i = 0; i < arena->num_chunks; i++) {
+        arena->chunks[i].visible_sections = frustum_sections(&arena->chunks[i], planes);
+    }
+}
+
+// Breadth first search from the camera's section through the frustum. A
+// section is left through a side only if its open blocks connect that side to
+// the one it was entered through, and never back towards the camera, so
+// sections sealed off by terrain are never reached.
+static void flood_visible_sections(chunk_arena* arena, int start_chunk, int start_section,
+    vec4 planes[6], int cam_chunk_x, int cam_chunk_z) {
+    int capacity = arena->num_chunks * VISIBILITY_SECTIONS;
+    if (capacity > arena->cull_queue_capacity) {
+        arena->cull_queue_capacity = capacity;
+        arena->cull_queue = realloc(arena->cull_queue, capacity * sizeof(cull_node));
+        assert(arena->cull_queue != NULL && "Failed to grow chunk arena cull queue");
+    }
+
+    cull_node* queue = arena->cull_queue;
+    int head = 0;
+    int tail = 0;
+    arena->chunks[start_chunk].visible_sections |= 1u << start_section;
+    queue[tail++] = (cull_node){start_chunk, start_section, -1, 0};
+
+    while (head < tail) {
+        cull_node node = queue[head++];
+        resident_chunk* chunk = &arena->chunks[node.chunk];
+        section_visibility visibility = chunk->visibility[node.section];
+
+        for (int side = 0; side < 6; side++) {
+            int entry = side_opposite[side];
+            if (node.directions & (1 << entry)) {
+                continue;
+            }
+            if (node.entry >= 0 && !section_faces_connected(visibility, node.entry, side)) {
+                continue;
+            }
+
+            int next_chunk = node.chunk;
+            int next_section = node.section;
+            if (side == (int)UP) {
+                next_section++;
+            } else if (side == (int)DOWN) {
+                next_section--;
+            } else {
+                next_chunk = chunk->neighbours[side];
+            }
+            if (next_chunk < 0 || next_section < 0 || next_section >= VISIBILITY_SECTIONS) {
+                continue;
+            }
+
+            resident_chunk* next = &arena->chunks[next_chunk];
+            uint32_t bit = 1u << next_section;
+            if (next->visible_sections & bit) {
+                continue;
+            }
+            if (!chunk_nearby(next, cam_chunk_x, cam_chunk_z)
+                && !sections_in_frustum(next, next_section, next_section, planes)) {
+                continue;
+            }
+
+            next->visible_sections |= bit;
+            queue[tail++] = (cull_node){next_chunk, next_section, entry, node.directions | (1 << side)};
+        }
+    }
+}
+
+// Conservative, a side is kept if any face in the bucket could face eye
+static int bucket_faces_viewer(const side_filter* filter, resident_chunk* chunk, int side, int section) {
+    if (!filter->from_eye) {
+        return (filter->sides >> side) & 1;
+    }
+
+    float min_x = (float)(chunk->x * CHUNK_SIZE);
+    float min_y = (float)(section * VISIBILITY_SECTION_HEIGHT);
+    float min_z = (float)(chunk->z * CHUNK_SIZE);
+    switch (side) {
+        case (int)NORTH:  // -Z
+            return filter->eye[2] < min_z + CHUNK_SIZE;
+        case (int)WEST:   // +X
+            return filter->eye[0] > min_x;
+        case (int)SOUTH:  // +Z
+            return filter->eye[2] > min_z;
+        case (int)EAST:   // -X
+            return filter->eye[0] < min_x + CHUNK_SIZE;
+        case (int)UP:
+            return filter->eye[1] > min_y;
+        default:          // DOWN
+            return filter->eye[1] < min_y + VISIBILITY_SECTION_HEIGHT;
+    }
+}
+
+// Push the buckets of a layer in the sections of the mask that can face the
+// viewer, returns the number of sides drawn. Depth sorted layers are one
+// bucket and drawn whole.
+static int push_chunk_draws(chunk_draw_list* list, resident_chunk* chunk, int layer,
+    uint32_t visible_sections, const side_filter* filter) {
+    packed_sides* sides = chunk->uploaded[layer];
+    if (sides == NULL) {
+        return 0;
+    }
+
+    side_buckets* buckets = &sides->buckets;
+    int first = chunk->slots[layer].first;
+    int drawn = 0;
+    for (int side = 0; side < buckets->directions; side++) {
+        for (int section = 0; section < buckets->sections; section++) {
+            int bucket = side * buckets->sections + section;
+            int count = buckets->starts[bucket + 1] - buckets->starts[bucket];
+            uint32_t section_mask = buckets->sections > 1 ? 1u << section : ALL_SECTIONS;
+            if (count == 0 || !(visible_sections & section_mask)) {
+                continue;
+            }
+            if (buckets->directions > 1 && !bucket_faces_viewer(filter, chunk, side, section)) {
+                continue;
+            }
+            // Neighbouring buckets are joined again by merge_draws
+            push_draw(list, layer, (side_range){first + buckets->starts[bucket], count});
+            drawn += count;
+        }
+    }
+    return drawn;
+}
+
+static void finish_draw_list(chunk_arena* arena, chunk_draw_list* list) {
+    for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+        merge_draws(list, layer);
+        if (arena->draw_path == CHUNK_DRAW_MULTI_INDIRECT) {
+            upload_commands(arena, list, layer);
+        }
+    }
+}
+
+void cull_chunk_arena(chunk_arena* arena, world_mesh* mesh, camera* cam) {
+    chunk_draw_list* list = &arena->view;
+    for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+        list->num_draws[layer] = 0;
+    }
+    arena->visible_chunks = 0;
+    arena->culled_chunks = 0;
+    arena->drawn_sides = 0;
+    arena->culled_sides = 0;
+    if (mesh == NULL) {
+        return;
+    }
+
+    mat4 view;
+    mat4 proj;
+    mat4 view_proj;
+    vec4 planes[6];
+    get_view_matrix(*cam, &view);
+    get_projection_matrix(&proj, RADS(FOV), (float)WIDTH / (float)HEIGHT, 0.1f, RENDER_DISTANCE);
+    glm_mat4_mul(proj, view, view_proj);
+    glm_frustum_planes(view_proj, planes);
+
+    int cam_chunk_x = WORLD_POS_TO_CHUNK_POS(cam->position[0]);
+    int cam_chunk_z = WORLD_POS_TO_CHUNK_POS(cam->position[2]);
+    int cam_section = (int)floorf(cam->position[1] / (float)VISIBILITY_SECTION_HEIGHT);
+
+    link_chunk_neighbours(arena);
+
+    // Above or below the world, or before the camera's own chunk is meshed,
+    // there is nothing to flood fill from
+    uint64_t cam_chunk;
+    int flood = OCCLUSION_CULLING
+        && cam_section >= 0 && cam_section < VISIBILITY_SECTIONS
+        && key_index_get(&arena->chunk_index, chunk_work_key(cam_chunk_x, cam_chunk_z), &cam_chunk);
+    if (flood) {
+        flood_visible_sections(arena, (int)cam_chunk, cam_section, planes, cam_chunk_x, cam_chunk_z);
+    } else {
+        mark_sections_in_frustum(arena, planes);
+    }
+
+    side_filter filter = {.from_eye = 1};
+    glm_vec3_copy(cam->position, filter.eye);
+
+    // World mesh order is back to front, which the ordered layers keep
+    for (int i = 0; i < mesh->num_chunks; i++) {
+        world_mesh_chunk* source = &mesh->chunks[i];
+        uint64_t index;
+        if (!key_index_get(&arena->chunk_index, chunk_work_key(source->x, source->z), &index)) {
+            continue;
+        }
+        resident_chunk* chunk = &arena->chunks[index];
+
+        int total = 0;
+        for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+            total += chunk->num_sides[layer];
+        }
+
+        if (chunk_nearby(chunk, cam_chunk_x, cam_chunk_z)) {
+            chunk->visible_sections = ALL_SECTIONS;
+        }
+        if (chunk->visible_sections == 0) {
+            arena->culled_chunks++;
+            arena->culled_sides += total;
+            continue;
+        }
+
+        arena->visible_chunks++;
+        int drawn = 0;
+        for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+            drawn += push_chunk_draws(list, chunk, layer, chunk->visible_sections, &filter);
+        }
+        arena->drawn_sides += drawn;
+        arena->culled_sides += total - drawn;
+    }
+
+    finish_draw_list(arena, list);
+}
+
+void cull_chunk_arena_pass(chunk_arena* arena, chunk_draw_list* list, side_filter filter) {
+    for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+        list->num_draws[layer] = 0;
+    }
+
+    for (int i = 0; i < arena->num_chunks; i++) {
+        resident_chunk* chunk = &arena->chunks[i];
+        if (chunk->visible_sections == 0) {
+            continue;
+        }
+        for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+            push_chunk_draws(list, chunk, layer, chunk->visible_sections, &filter);
+        }
+    }
+
+    finish_draw_list(arena, list);
+}
+
+void cull_chunk_arena_frustum(chunk_arena* arena, chunk_draw_list* list, vec4 planes[6], side_filter filter) {
+    for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+        list->num_draws[layer] = 0;
+    }
+
+    for (int i = 0; i < arena->num_chunks; i++) {
+        resident_chunk* chunk = &arena->chunks[i];
+        uint32_t sections = frustum_sections(chunk, planes);
+        if (sections == 0) {
+            continue;
+        }
+        for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+            push_chunk_draws(list, chunk, layer, sections, &filter);
+        }
+    }
+
+    finish_draw_list(arena, list);
+}
+
+int chunk_arena_changed_in(chunk_arena* arena, vec4 planes[6]) {
+    for (int i = 0; i < arena->num_chunks; i++) {
+        resident_chunk* chunk = &arena->chunks[i];
+        if (chunk->changed_frame == arena->frame
+            && sections_in_frustum(chunk, 0, VISIBILITY_SECTIONS - 1, planes)) {
+            return 1;
+        }
+    }
+    for (int i = 0; i < arena->num_evicted; i++) {
+        evicted_chunk chunk = arena->evicted[i];
+        if (column_in_frustum(chunk.x, chunk.z, 0, VISIBILITY_SECTIONS - 1, planes)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+uint32_t chunk_arena_visible_sections(chunk_arena* arena, int x, int z) {
+    uint64_t index;
+    if (!key_index_get(&arena->chunk_index, chunk_work_key(x, z), &index)) {
+        return 0;
+    }
+    return arena->chunks[index].visible_sections;
+}
+
+void draw_chunk_layer(chunk_arena* arena, chunk_draw_list* list, mesh_layer layer, side_attrib_fn set_attribs) {
+    side_arena* side_arena = &arena->layers[layer];
+    if (list->num_draws[layer] == 0) {
+        return;
+    }
+
+    use_vbo(side_arena->vbo);
+    switch (arena->draw_path) {
+        case CHUNK_DRAW_MULTI_INDIRECT:
+            set_attribs(&side_arena->vbo, 0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, list->commands[layer].id);
+            glMultiDrawArraysIndirect(GL_TRIANGLES, NULL, list->num_draws[layer], 0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+            break;
+
+        case CHUNK_DRAW_BASE_INSTANCE:
+            set_attribs(&side_arena->vbo, 0);
+            for (int i = 0; i < list->num_draws[layer]; i++) {
+                side_range range = list->draws[layer][i];
+                glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, 6, range.count, (uint)range.first);
+            }
+            break;
+
+        case CHUNK_DRAW_ATTRIB_OFFSET:
+            // Without a base instance each range re-points the attributes
+            for (int i = 0; i < list->num_draws[layer]; i++) {
+                side_range range = list->draws[layer][i];
+                set_attribs(&side_arena->vbo, (uint)(range.first * SIDE_STRIDE));
+                glDrawArraysInstanced(GL_TRIANGLES, 0, 6, range.count);
+            }
+            break;
+    }
+}
@@ -0,0 +1,156 @@
+#ifndef CHUNK_ARENA_H
+#define CHUNK_ARENA_H
+
+#include <game_data.h>
+#include <camera.h>
+#include <vbo.h>
+#include <util/dedupe_queue.h>
+#include <util/settings.h>
+#include <stdint.h>
+
+#if VISIBILITY_SECTIONS > 32
+#error "resident_chunk.visible_sections holds at most 32 sections"
+#endif
+
+// A run of sides in an arena buffer
+typedef struct {
+    int first;
+    int count;
+} side_range;
+
+// One GPU buffer of sides, handed out in ranges from a free list
+typedef struct {
+    VBO vbo;
+    int capacity;             // in sides
+    int used;                 // in sides
+    side_range* free_ranges;  // ordered by first, neighbours always merged
+    int num_free_ranges;
+    int free_range_capacity;
+} side_arena;
+
+// How draw_chunk_layer submits the ranges, picked from the context version
+typedef enum {
+    CHUNK_DRAW_MULTI_INDIRECT = 0,  // one glMultiDrawArraysIndirect per layer, GL 4.3
+    CHUNK_DRAW_BASE_INSTANCE,       // a glDrawArraysInstancedBaseInstance per range, GL 4.2
+    CHUNK_DRAW_ATTRIB_OFFSET        // attributes re-pointed per range, GL 3.3
+} chunk_draw_path;
+
+// Layout of a glMultiDrawArraysIndirect command
+typedef struct {
+    uint count;
+    uint instance_count;
+    uint first;
+    uint base_instance;
+} draw_arrays_command;
+
+// A chunk whose faces are on the GPU
+typedef struct {
+    int x, z;
+    // Layers on the GPU, retained for their bucket layout. Packed layers are
+    // never changed, so a different pointer is a new version.
+    packed_sides* uploaded[MESH_LAYER_COUNT];
+    side_range slots[MESH_LAYER_COUNT];       // allocated space, may be larger than the faces
+    int num_sides[MESH_LAYER_COUNT];
+    unsigned int frame;                       // last sync that saw the chunk
+    unsigned int changed_frame;               // last sync that changed its faces
+    section_visibility visibility[VISIBILITY_SECTIONS];
+
+    int neighbours[4];          // index of the chunk on each horizontal side, -1 if none
+    uint32_t visible_sections;  // bit per section, after the last cull
+} resident_chunk;
+
+// A section reached by the occlusion flood fill
+typedef struct {
+    int chunk;       // index into chunks
+    int section;
+    int entry;       // side it was entered through, -1 for the camera's own
+    int directions;  // mask of the sides stepped through on the way here
+} cull_node;
+
+// Ranges of one pass over the arena, merged where they touch
+typedef struct {
+    side_range* draws[MESH_LAYER_COUNT];
+    int num_draws[MESH_LAYER_COUNT];
+    int draw_capacity[MESH_LAYER_COUNT];
+    VBO commands[MESH_LAYER_COUNT];  // indirect commands of the draws, multi-draw indirect only
+} chunk_draw_list;
+
+// A chunk column the last sync evicted
+typedef struct {
+    int x, z;
+} evicted_chunk;
+
+// Which sides of direction split layers a pass keeps
+typedef struct {
+    int from_eye;  // keep the sides that can face eye, else the ones in sides
+    vec3 eye;
+    int sides;     // mask of (1 << side)
+} side_filter;
+
+// Keeps the faces of every chunk of the world mesh on the GPU, one buffer per
+// layer with a slot per chunk. A sync uploads only the layers whose version
+// changed and frees the slots of chunks that left the world mesh. Culling
+// then flood fills the sections the camera can see into and turns them into
+// draw ranges, skipping the sides that face away from the camera or the sun.
+typedef struct {
+    side_arena layers[MESH_LAYER_COUNT];
+    chunk_draw_path draw_path;
+
+    resident_chunk* chunks;
+    int num_chunks;
+    int chunk_capacity;
+    key_index chunk_index;  // chunk_work_key -> index into chunks
+    unsigned int frame;
+    evicted_chunk* evicted;  // by the last sync
+    int num_evicted;
+    int evicted_capacity;
+
+    chunk_draw_list view;    // seen by the camera
+    chunk_draw_list shadow;      // sections in a shadow cascade, as seen from the sun
+    chunk_draw_list reflection;  // visible sections as seen from under the water
+    draw_arrays_command* command_scratch;
+    int command_capacity;
+
+    cull_node* cull_queue;
+    int cull_queue_capacity;
+
+    size_t uploaded_bytes;  // during the last sync
+    int visible_chunks;     // after the last cull
+    int culled_chunks;
+    int drawn_sides;
+    int culled_sides;       // out of view, hidden behind terrain or facing away
+} chunk_arena;
+
+// Points the bound VAO's instance attributes at the side byte offset bytes
+// into vbo
+typedef void (*side_attrib_fn)(VBO* vbo, uint offset);
+
+chunk_arena create_chunk_arena(void);
+void destroy_chunk_arena(chunk_arena* arena);
+
+void sync_chunk_arena(chunk_arena* arena, world_mesh* mesh);
+
+// Collect the view draws of the sections of mesh the camera can see, call
+// after sync_chunk_arena with the same mesh
+void cull_chunk_arena(chunk_arena* arena, world_mesh* mesh, camera* cam);
+
+// Collect draws of the sections the last cull found visible into list, for
+// passes that see them from somewhere other than the camera
+void cull_chunk_arena_pass(chunk_arena* arena, chunk_draw_list* list, side_filter filter);
+
+// Collect draws of every section inside the frustum planes, whether the
+// camera sees it or not, for shadow casters out of view
+void cull_chunk_arena_frustum(chunk_arena* arena, chunk_draw_list* list, vec4 planes[6], side_filter filter);
+
+// Whether the last sync uploaded, dropped or evicted faces of a chunk inside
+// the frustum planes
+int chunk_arena_changed_in(chunk_arena* arena, vec4 planes[6]);
+
+// Sections of the chunk at x, z the last cull found visible, 0 when the
+// chunk is not resident
+uint32_t chunk_arena_visible_sections(chunk_arena* arena, int x, int z);
+
+// Draw one layer of a draw list with the bound program and VAO
+void draw_chunk_layer(chunk_arena* arena, chunk_draw_list* list, mesh_layer layer, side_attrib_fn set_attribs);
+
+#endif
@@ -1,5 +1,6 @@
 #include "vao.h"
 #include <glad/glad.h>
+#include <gl_state.h>
 
 VAO create_vao() {
     uint id;
@@ -12,9 +13,10 @@ VAO create_vao() {
 }
 
 void delete_vao(VAO vao) {
+    gl_state_forget_vao(vao.id);
     glDeleteVertexArrays(1, &vao.id);
 }
 
 void bind_vao(VAO vao) {
-    glBindVertexArray(vao.id);
+    gl_state_bind_vao(vao.id);
 }
\ No newline at end of file
@@ -173,6 +173,10 @@ ui_renderer create_ui_renderer() {
     // Load atlas texture (reuse the existing atlas)
     texture atlas = t_init(ATLAS_PATH, ATLAS_TEXTURE_INDEX);
 
+    use_program(program);
+    glUniform1i(glGetUniformLocation(program.id, "atlas"), atlas.tex_index);
+    glUniform1f(glGetUniformLocation(program.id, "atlasSize"), (float)ATLAS_SIZE);
+
     // Create orthographic projection matrix
     mat4 projection;
     glm_ortho(0.0f, (float)WIDTH, (float)HEIGHT, 0.0f, -1.0f, 1.0f, projection);
@@ -186,6 +190,8 @@ ui_renderer create_ui_renderer() {
         .vbo = vbo,
         .program = program,
         .atlas = atlas,
+        .projection_loc = glGetUniformLocation(program.id, "projection"),
+        .atlas_coord_loc = glGetUniformLocation(program.id, "atlasCoord"),
         .font = g_font_config,
         .hotbar = g_hotbar_config,
         .fps_config = g_fps_config,
@@ -210,21 +216,11 @@ void render_ui_quad_ex(ui_renderer* ui, float x, float y, float width, float hei
     glm_ortho(0.0f, (float)get_screen_width(), (float)get_screen_height(), 0.0f, -1.0f, 1.0f, projection);
 
     // Set uniforms
-    uint proj_loc = glGetUniformLocation(ui->program.id, "projection");
-    glUniformMatrix4fv(proj_loc, 1, GL_FALSE, (float*)projection);
-
-    uint atlas_coord_loc = glGetUniformLocation(ui->program.id, "atlasCoord");
-    glUniform2f(atlas_coord_loc, (float)atlas_x, (float)atlas_y);
-
-    uint atlas_size_loc = glGetUniformLocation(ui->program.id, "atlasSize");
-    glUniform1f(atlas_size_loc, (float)ATLAS_SIZE);
+    glUniformMatrix4fv(ui->projection_loc, 1, GL_FALSE, (float*)projection);
+    glUniform2f(ui->atlas_coord_loc, (float)atlas_x, (float)atlas_y);
 
     // Bind atlas texture
-    glActiveTexture(GL_TEXTURE0 + ui->atlas.tex_index);
-    glBindTexture(GL_TEXTURE_2D, ui->atlas.id);
-
-    uint atlas_tex_loc = glGetUniformLocation(ui->program.id, "atlas");
-    glUniform1i(atlas_tex_loc, ui->atlas.tex_index);
+    t_bind(&ui->atlas);
 
     // UV coordinates - flip if requested
     float v_top = flip_v ? 0.0f : 1.0f;
@@ -294,7 +290,8 @@ static float render_string(ui_renderer* ui, const char* str, float x, float y,
     return x;
 }
 
-void render_debug(ui_renderer* ui, int fps, float player_x, float player_y, float player_z) {
+void render_debug(ui_renderer* ui, int fps, float player_x, float player_y, float player_z,
+                  int drawn_sides, int culled_sides, int worker_threads) {
     // Clamp FPS to reasonable range
     if (fps < 0) fps = 0;
     if (fps > 9999) fps = 9999;
@@ -316,6 +313,18 @@ void render_debug(ui_renderer* ui, int fps, float player_x, float player_y, floa
     char coord_str[64];
     snprintf(coord_str, sizeof(coord_str), "(%.2f,%.2f,%.2f)", player_x, player_y, player_z);
     render_string(ui, coord_str, x, y, char_width, char_height, spacing);
+
+    // Line 3: Chunk faces drawn and culled this frame
+    y += line_height;
+    char sides_str[32];
+    snprintf(sides_str, sizeof(sides_str), "(%d,%d)", drawn_sides, culled_sides);
+    render_string(ui, sides_str, x, y, char_width, char_height, spacing);
+
+    // Line 4: Chunk worker threads, changed with F3 / F4
+    y += line_height;
+    char workers_str[16];
+    snprintf(workers_str, sizeof(workers_str), "(%d)", worker_threads);
+    render_string(ui, workers_str, x, y, char_width, char_height, spacing);
 }
 
 void render_hotbar(ui_renderer* ui, char** hotbar, int hotbar_size, int selected_block) {
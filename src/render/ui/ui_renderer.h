@@ -36,6 +36,8 @@ typedef struct {
     shader_program program;
     texture atlas;
     mat4 projection;
+    int projection_loc;
+    int atlas_coord_loc;
 
     ui_font_config font;
     ui_hotbar_config hotbar;
@@ -48,7 +50,9 @@ ui_renderer create_ui_renderer();
 void destroy_ui_renderer(ui_renderer* ui);
 
 void render_ui_quad(ui_renderer* ui, float x, float y, float width, float height, int atlas_x, int atlas_y);
-void render_debug(ui_renderer* ui, int fps, float player_x, float player_y, float player_z);
+// FPS, player position, (drawn,culled) chunk faces and (chunk workers)
+void render_debug(ui_renderer* ui, int fps, float player_x, float player_y, float player_z,
+                  int drawn_sides, int culled_sides, int worker_threads);
 void render_hotbar(ui_renderer* ui, char** hotbar, int hotbar_size, int selected_block);
 
 #endif
@@ -10,33 +10,38 @@
 #include <sun.h>
 #include <fbo.h>
 #include <world_mesh.h>
+#include <chunk_arena.h>
+
+// How a transparent pass writes its fragments, see world.frag
+typedef enum {
+    TRANSPARENCY_PASS_BLENDED = 0,    // sorted alpha blending
+    TRANSPARENCY_PASS_OPAQUE = 1,     // only fully opaque texels, writes depth
+    TRANSPARENCY_PASS_ACCUMULATE = 2  // translucent texels into the OIT targets
+} transparency_pass;
 
 typedef struct {
     VAO vao;
-    VBO cube_vbo, instance_vbo;
+    VBO cube_vbo;
     shader_program program;
     camera* cam;
     texture atlas;
     texture bump;
     texture caustic;
+    int transparency_pass_loc;
 } block_renderer;
 
 block_renderer create_block_renderer(camera* cam, char* atlas, char* bump, char* caustic);
 void destroy_block_renderer(block_renderer wr);
 
-void send_view_matrix(block_renderer* br);
-void send_proj_matrix(block_renderer* br);
-void send_atlas(block_renderer* br);
-void send_fog(block_renderer* br);
-void send_time(block_renderer* br);
-void send_water_info(block_renderer* br);
-void send_caustic_texture(block_renderer* br);
-void send_ambient_light(shader_program* p);
-void send_shadow_info(shader_program* p);
+// Shared by the block, liquid and foliage renderers at creation
+void init_side_vao(block_renderer* br, int num_attribs);
+void init_block_program(block_renderer* br);
+
+void bind_block_textures(block_renderer* br, FBO* shadow_map);
 
-void render_sides(block_renderer* br, int* side_data, int num_sides);
+void render_sides(block_renderer* br, chunk_arena* arena, mesh_layer layer);
 
-void render_solids(block_renderer* br, sun* sun, FBO* shadow_map, world_mesh* packet);
-void render_transparent(block_renderer* br, sun* sun, FBO* shadow_map, world_mesh* packet);
+void render_solids(block_renderer* br, FBO* shadow_map, chunk_arena* arena);
+void render_transparent(block_renderer* br, FBO* shadow_map, chunk_arena* arena, transparency_pass pass);
 
 #endif
\ No newline at end of file
@@ -3,23 +3,16 @@
 #include <string.h>
 #include <time.h>
 #include <glad/glad.h>
-#include <GLFW/glfw3.h>
+#include <gl_state.h>
 #include "fbo.h"
 
 block_renderer create_liquid_renderer(camera* cam, char* atlas_path, char* bump_path, char* caustic_path) {
     texture atlas = t_init(atlas_path, ATLAS_TEXTURE_INDEX);
     texture bump = t_init(bump_path, BUMP_TEXTURE_INDEX);
     texture caustic = t_init(caustic_path, CAUSTIC_TEXTURE_INDEX);
-    
-    camera_cache cam_cache = {
-        .x = cam->position[0],
-        .z = cam->position[2],
-    };
 
     VAO vao = create_vao();
-    bind_vao(vao);
     VBO cube_vbo = create_vbo(GL_STATIC_DRAW);
-    VBO instance_vbo = create_vbo(GL_STATIC_DRAW);
 
     shader vertex_shader = create_shader(LIQUID_VERTEX_SHADER, GL_VERTEX_SHADER);
     shader fragment_shader = create_shader(LIQUID_FRAGMENT_SHADER, GL_FRAGMENT_SHADER);
@@ -34,16 +27,18 @@ block_renderer create_liquid_renderer(camera* cam, char* atlas_path, char* bump_
         .bump = bump,
         .caustic = caustic,
         .vao = vao,
-        .cube_vbo = cube_vbo,
-        .instance_vbo = instance_vbo
+        .cube_vbo = cube_vbo
     };
+    init_side_vao(&br, 9);
+    init_block_program(&br);
 
     return br;
 }
 
-void render_liquids(block_renderer* br, sun* sun, FBO* shadow_map, FBO* reflection_map, world_mesh* packet) {
+void render_liquids(block_renderer* br, FBO* shadow_map, FBO* reflection_map, chunk_arena* arena) {
     use_program(br->program);
-    bind_vao(br->vao);
+    bind_block_textures(br, shadow_map);
+    gl_state_bind_texture(REFLECTION_MAP_TEXTURE_INDEX, reflection_map->texture);
 
     // Enable blending for transparent liquid volumes
     glEnable(GL_BLEND);
@@ -65,27 +60,7 @@ void render_liquids(block_renderer* br, sun* sun, FBO* shadow_map, FBO* reflecti
         glPolygonOffset(-1.0f, -1.0f);
     }
 
-    send_view_matrix(br);
-    send_proj_matrix(br);
-    send_atlas(br);
-    send_fog(br);
-    send_water_info(br);
-    send_caustic_texture(br);
-    send_time(br);
-    send_sun_info(&(br->program), sun);
-    send_fbo_texture(&(br->program), shadow_map, SHADOW_MAP_TEXTURE_INDEX, "shadowMap");
-    send_fbo_texture(&(br->program), reflection_map, REFLECTION_MAP_TEXTURE_INDEX, "reflectionMap");
-    send_sun_matrices(&(br->program), sun);
-    send_ambient_light(&(br->program));
-    send_shadow_info(&(br->program));
-
-    send_cube_vbo(br->vao, br->cube_vbo);
-
-    if (packet != NULL) {
-        render_sides(br,
-            packet->liquid_data,
-            packet->num_liquid_sides);
-    }
+    render_sides(br, arena, MESH_LAYER_LIQUID);
 
     // Disable polygon offset
     glDisable(GL_POLYGON_OFFSET_FILL);
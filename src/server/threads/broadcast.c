@@ -2,10 +2,12 @@
 
 #include <server/models.h>
 #include <stdbool.h>
-#include <unistd.h>
 #include <string.h>
+#include "../../util/thread_event.h"
 
 pthread_mutex_t broadcast_queue_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t broadcast_queue_signal = PTHREAD_COND_INITIALIZER;
+static thread_usage broadcast_usage = THREAD_USAGE_INITIALIZER("broadcast");
 struct broadcast_queue_node* queue_head = NULL;
 struct broadcast_queue_node* queue_tail = NULL;
 
@@ -54,6 +56,7 @@ void add_to_broadcast_queue(byte* data, int size) {
         queue_tail->next = node;
         queue_tail = node;
     }
+    pthread_cond_signal(&broadcast_queue_signal);
     pthread_mutex_unlock(&broadcast_queue_lock);
 }
 
@@ -65,21 +68,23 @@ void* run_broadcast_thread(void* args) {
         return NULL;
     }
 
+    thread_usage_register(&broadcast_usage);
+    thread_usage_begin(&broadcast_usage);
     while (1) {
         pthread_mutex_lock(&broadcast_queue_lock);
-        struct broadcast_queue_node* cur = queue_head;
-        if (cur != NULL) {
-            queue_head = cur->next;
-            if (queue_head == NULL) {
-                queue_tail = NULL;
+        if (queue_head == NULL) {
+            thread_usage_idle(&broadcast_usage);
+            while (queue_head == NULL) {
+                pthread_cond_wait(&broadcast_queue_signal, &broadcast_queue_lock);
             }
+            thread_usage_wake(&broadcast_usage);
         }
-        pthread_mutex_unlock(&broadcast_queue_lock);
-
-        if (cur == NULL) {
-            usleep(100); // TODO: this should be configurable
-            continue;
+        struct broadcast_queue_node* cur = queue_head;
+        queue_head = cur->next;
+        if (queue_head == NULL) {
+            queue_tail = NULL;
         }
+        pthread_mutex_unlock(&broadcast_queue_lock);
 
         broadcast_data(server, cur->data, cur->size);
 
@@ -8,10 +8,14 @@
 #include "../../world/core/world.h"
 #include "../compression/compression.h"
 #include "../../mesh/core/mesh.h"
+#include "../../mesh/generation/mesh_pipeline.h"
+#include "../../util/thread_event.h"
 
 #include <sys/socket.h>
 #include <stdlib.h>
 
+static thread_usage recv_usage = THREAD_USAGE_INITIALIZER("net_recv");
+
 static void process_chunk_broadcast(int fd) {
     int packet_size = -1;
     if (recv(fd, &packet_size, sizeof(int), MSG_WAITALL) <= 0) {
@@ -45,6 +49,7 @@ static void process_chunk_broadcast(int fd) {
     get_mesh_player_pos(&player_x, &player_z);
     chunk_mesh* mesh = create_chunk_mesh(x, z, player_x, player_z);
     free(mesh);
+    notify_mesh_pipeline();
 }
 
 void* run_client_recv_thread(void* args) {
@@ -61,9 +66,14 @@ void* run_client_recv_thread(void* args) {
         return NULL;
     }
 
+    thread_usage_register(&recv_usage);
+    thread_usage_begin(&recv_usage);
     while (1) {
         chunk_msg_type msg_type = UNKNOWN;
-        if (recv(fd, &msg_type, sizeof(chunk_msg_type), MSG_WAITALL) <= 0) {
+        thread_usage_idle(&recv_usage);
+        ssize_t received = recv(fd, &msg_type, sizeof(chunk_msg_type), MSG_WAITALL);
+        thread_usage_wake(&recv_usage);
+        if (received <= 0) {
             printf("Server disconnected (client recv thread)\n");
             break;
         }
@@ -77,6 +87,8 @@ void* run_client_recv_thread(void* args) {
                 break;
         }
     }
+    thread_usage_end(&recv_usage);
+    thread_usage_unregister(&recv_usage);
 
     return NULL;
 }
@@ -0,0 +1,287 @@
+#include "dedupe_queue.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define KEY_INDEX_MIN_CAPACITY 64
+#define DEDUPE_QUEUE_MIN_CAPACITY 64
+
+static size_t hash_key(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDull;
+    key ^= key >> 33;
+    key *= 0xC4CEB9FE1A85EC53ull;
+    key ^= key >> 33;
+    return (size_t)key;
+}
+
+void key_index_init(key_index* index) {
+    index->keys = NULL;
+    index->values = NULL;
+    index->used = NULL;
+    index->capacity = 0;
+    index->size = 0;
+}
+
+void key_index_free(key_index* index) {
+    free(index->keys);
+    free(index->values);
+    free(index->used);
+    key_index_init(index);
+}
+
+// Slot holding key, or the empty slot where it would go
+static size_t find_slot(key_index* index, uint64_t key) {
+    size_t mask = index->capacity - 1;
+    size_t slot = hash_key(key) & mask;
+    while (index->used[slot] && index->keys[slot] != key) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static void key_index_grow(key_index* index) {
+    key_index old = *index;
+    size_t capacity = old.capacity > 0 ? old.capacity * 2 : KEY_INDEX_MIN_CAPACITY;
+
+    index->keys = malloc(capacity * sizeof(uint64_t));
+    index->values = malloc(capacity * sizeof(uint64_t));
+    index->used = calloc(capacity, 1);
+    assert(index->keys != NULL && index->values != NULL && index->used != NULL
+        && "Failed to grow key index");
+    index->capacity = capacity;
+
+    for (size_t i = 0; i < old.capacity; i++) {
+        if (old.used[i]) {
+            size_t slot = find_slot(index, old.keys[i]);
+            index->used[slot] = 1;
+            index->keys[slot] = old.keys[i];
+            index->values[slot] = old.values[i];
+        }
+    }
+
+    free(old.keys);
+    free(old.values);
+    free(old.used);
+}
+
+int key_index_get(key_index* index, uint64_t key, uint64_t* value) {
+    if (index->size == 0) {
+        return 0;
+    }
+
+    size_t slot = find_slot(index, key);
+    if (!index->used[slot]) {
+        return 0;
+    }
+    if (value != NULL) {
+        *value = index->values[slot];
+    }
+    return 1;
+}
+
+void key_index_put(key_index* index, uint64_t key, uint64_t value) {
+    if ((index->size + 1) * 2 > index->capacity) {
+        key_index_grow(index);
+    }
+
+    size_t slot = find_slot(index, key);
+    if (!index->used[slot]) {
+        index->used[slot] = 1;
+        index->keys[slot] = key;
+        index->size++;
+    }
+    index->values[slot] = value;
+}
+
+int key_index_remove(key_index* index, uint64_t key) {
+    if (index->size == 0) {
+        return 0;
+    }
+
+    size_t mask = index->capacity - 1;
+    size_t hole = find_slot(index, key);
+    if (!index->used[hole]) {
+        return 0;
+    }
+    index->used[hole] = 0;
+    index->size--;
+
+    // Shift later entries of the probe run back so lookups never stop early
+    size_t slot = hole;
+    for (;;) {
+        slot = (slot + 1) & mask;
+        if (!index->used[slot]) {
+            break;
+        }
+        size_t home = hash_key(index->keys[slot]) & mask;
+        // The entry may only move if its home is not between the hole and it
+        int stays = hole <= slot
+            ? (home > hole && home <= slot)
+            : (home > hole || home <= slot);
+        if (stays) {
+            continue;
+        }
+        index->used[hole] = 1;
+        index->keys[hole] = index->keys[slot];
+        index->values[hole] = index->values[slot];
+        index->used[slot] = 0;
+        hole = slot;
+    }
+    return 1;
+}
+
+static void lock_queue(dedupe_queue* queue) {
+    if (queue->thread_safe) {
+        pthread_mutex_lock(&queue->mutex);
+    }
+}
+
+static void unlock_queue(dedupe_queue* queue) {
+    if (queue->thread_safe) {
+        pthread_mutex_unlock(&queue->mutex);
+    }
+}
+
+static unsigned char* item_at(dedupe_queue* queue, uint64_t sequence) {
+    return queue->items + (size_t)(sequence & (queue->capacity - 1)) * queue->elem_size;
+}
+
+void dedupe_queue_init(dedupe_queue* queue, size_t elem_size, queue_key_fn get_key, int thread_safe) {
+    queue->items = NULL;
+    queue->live = NULL;
+    queue->elem_size = elem_size;
+    queue->capacity = 0;
+    queue->head = 0;
+    queue->tail = 0;
+    queue->count = 0;
+    queue->get_key = get_key;
+    key_index_init(&queue->index);
+    queue->thread_safe = thread_safe;
+    if (thread_safe) {
+        pthread_mutex_init(&queue->mutex, NULL);
+    }
+}
+
+void dedupe_queue_free(dedupe_queue* queue) {
+    free(queue->items);
+    free(queue->live);
+    queue->items = NULL;
+    queue->live = NULL;
+    queue->capacity = 0;
+    queue->head = 0;
+    queue->tail = 0;
+    queue->count = 0;
+    key_index_free(&queue->index);
+    if (queue->thread_safe) {
+        pthread_mutex_destroy(&queue->mutex);
+        queue->thread_safe = 0;
+    }
+}
+
+// Move the live items to the front of a new ring, doubling it only when
+// removed slots are not enough to make room. Renumbers the index.
+static void dedupe_queue_grow(dedupe_queue* queue) {
+    size_t capacity = queue->capacity;
+    if (capacity == 0) {
+        capacity = DEDUPE_QUEUE_MIN_CAPACITY;
+    } else if (queue->count * 2 >= capacity) {
+        capacity *= 2;
+    }
+
+    unsigned char* items = malloc(capacity * queue->elem_size);
+    unsigned char* live = malloc(capacity);
+    assert(items != NULL && live != NULL && "Failed to grow dedupe queue");
+
+    uint64_t next = 0;
+    for (uint64_t sequence = queue->head; sequence < queue->tail; sequence++) {
+        if (!queue->live[sequence & (queue->capacity - 1)]) {
+            continue;
+        }
+        unsigned char* item = item_at(queue, sequence);
+        memcpy(items + next * queue->elem_size, item, queue->elem_size);
+        live[next] = 1;
+        key_index_put(&queue->index, queue->get_key(item), next);
+        next++;
+    }
+
+    free(queue->items);
+    free(queue->live);
+    queue->items = items;
+    queue->live = live;
+    queue->capacity = capacity;
+    queue->head = 0;
+    queue->tail = next;
+}
+
+int dedupe_queue_push(dedupe_queue* queue, const void* item, void* replaced) {
+    uint64_t key = queue->get_key(item);
+    lock_queue(queue);
+
+    uint64_t sequence;
+    if (key_index_get(&queue->index, key, &sequence)) {
+        unsigned char* slot = item_at(queue, sequence);
+        if (replaced != NULL) {
+            memcpy(replaced, slot, queue->elem_size);
+        }
+        memcpy(slot, item, queue->elem_size);
+        unlock_queue(queue);
+        return 1;
+    }
+
+    if (queue->tail - queue->head == queue->capacity) {
+        dedupe_queue_grow(queue);
+    }
+    sequence = queue->tail++;
+    memcpy(item_at(queue, sequence), item, queue->elem_size);
+    queue->live[sequence & (queue->capacity - 1)] = 1;
+    key_index_put(&queue->index, key, sequence);
+    queue->count++;
+
+    unlock_queue(queue);
+    return 0;
+}
+
+int dedupe_queue_pop(dedupe_queue* queue, void* out) {
+    lock_queue(queue);
+
+    // Removed items are only skipped here, which keeps remove O(1)
+    while (queue->head < queue->tail && !queue->live[queue->head & (queue->capacity - 1)]) {
+        queue->head++;
+    }
+    if (queue->head == queue->tail) {
+        unlock_queue(queue);
+        return 0;
+    }
+
+    unsigned char* item = item_at(queue, queue->head);
+    memcpy(out, item, queue->elem_size);
+    key_index_remove(&queue->index, queue->get_key(item));
+    queue->head++;
+    queue->count--;
+
+    unlock_queue(queue);
+    return 1;
+}
+
+int dedupe_queue_remove(dedupe_queue* queue, uint64_t key) {
+    lock_queue(queue);
+
+    uint64_t sequence;
+    int found = key_index_get(&queue->index, key, &sequence);
+    if (found) {
+        queue->live[sequence & (queue->capacity - 1)] = 0;
+        key_index_remove(&queue->index, key);
+        queue->count--;
+    }
+
+    unlock_queue(queue);
+    return found;
+}
+
+size_t dedupe_queue_count(dedupe_queue* queue) {
+    lock_queue(queue);
+    size_t count = queue->count;
+    unlock_queue(queue);
+    return count;
+}
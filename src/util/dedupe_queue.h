@@ -0,0 +1,63 @@
+#ifndef DEDUPE_QUEUE_H
+#define DEDUPE_QUEUE_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Returns the dedupe key of a queued item
+typedef uint64_t (*queue_key_fn)(const void* item);
+
+// Open addressing map from a 64-bit key to a 64-bit value. Entries live in
+// flat arrays, so nothing is allocated per key.
+typedef struct {
+    uint64_t* keys;
+    uint64_t* values;
+    unsigned char* used;
+    size_t capacity;  // power of two, at most half full
+    size_t size;
+} key_index;
+
+void key_index_init(key_index* index);
+void key_index_free(key_index* index);
+// Returns 1 and fills value if key is present
+int key_index_get(key_index* index, uint64_t key, uint64_t* value);
+void key_index_put(key_index* index, uint64_t key, uint64_t value);
+// Returns 1 if key was present
+int key_index_remove(key_index* index, uint64_t key);
+
+// FIFO of fixed-size items with at most one item per key. Items are copied
+// into a ring buffer and found through a key_index, so push, pop and remove
+// are O(1) and never allocate per item.
+typedef struct {
+    unsigned char* items;
+    unsigned char* live;  // 0 once removed, skipped by pop
+    size_t elem_size;
+    size_t capacity;      // power of two
+    uint64_t head;        // sequence number of the oldest slot
+    uint64_t tail;        // sequence number of the next push
+    size_t count;         // live items
+    queue_key_fn get_key;
+    key_index index;      // key -> sequence number
+    int thread_safe;
+    pthread_mutex_t mutex;
+} dedupe_queue;
+
+// thread_safe guards every call with the queue's own mutex
+void dedupe_queue_init(dedupe_queue* queue, size_t elem_size, queue_key_fn get_key, int thread_safe);
+void dedupe_queue_free(dedupe_queue* queue);
+
+// Append item, or overwrite the queued item with the same key where it
+// stands. Returns 1 when an item was overwritten, its old value is copied to
+// replaced unless that is NULL.
+int dedupe_queue_push(dedupe_queue* queue, const void* item, void* replaced);
+
+// Copy the oldest item to out, returns 0 when the queue is empty
+int dedupe_queue_pop(dedupe_queue* queue, void* out);
+
+// Drop the queued item with this key, returns 1 if there was one
+int dedupe_queue_remove(dedupe_queue* queue, uint64_t key);
+
+size_t dedupe_queue_count(dedupe_queue* queue);
+
+#endif
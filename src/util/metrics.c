@@ -18,7 +18,8 @@ static bool profile_startup_enabled = true;
 static bool profile_show_stats[PROFILE_STAT_COUNT] = { true, true, true };
 static bool profile_section_enabled[PROFILE_SECTION_COUNT] = {
     true, true, true, true, true, true, true, true,
-    true, true, true, true, true, true, true, true
+    true, true, true, true, true, true, true, true,
+    true
 };
 static bool profile_log_to_file = false;
 static char profile_log_path[256] = {0};
@@ -41,11 +42,12 @@ static const char* profile_section_names[PROFILE_SECTION_COUNT] = {
     "update_camera",
     "apply_physics",
     "update_selected_block",
-    "copy_world_mesh",
     "render_total",
     "render_clear",
     "render_skybox",
     "render_sun",
+    "upload_chunks",
+    "cull_chunks",
     "render_shadow_map",
     "render_reflection_map",
     "render_world",
@@ -11,11 +11,12 @@ typedef enum {
     PROFILE_SECTION_UPDATE_CAMERA,
     PROFILE_SECTION_APPLY_PHYSICS,
     PROFILE_SECTION_UPDATE_SELECTED_BLOCK,
-    PROFILE_SECTION_COPY_WORLD_MESH,
     PROFILE_SECTION_RENDER_TOTAL,
     PROFILE_SECTION_RENDER_CLEAR,
     PROFILE_SECTION_RENDER_SKYBOX,
     PROFILE_SECTION_RENDER_SUN,
+    PROFILE_SECTION_UPLOAD_CHUNKS,
+    PROFILE_SECTION_CULL_CHUNKS,
     PROFILE_SECTION_RENDER_SHADOW_MAP,
     PROFILE_SECTION_RENDER_REFLECTION_MAP,
     PROFILE_SECTION_RENDER_WORLD,
@@ -13,10 +13,12 @@ int HEIGHT = 900;
 char* TITLE = "malloc-craft";
 // 0.0001047 represents 2π / (60000 ms), giving a full day cycle in ~60 seconds
 float TIME_SCALE = 0.0001047f;
-int WORKER_THREADS = 4;
-int CHUNK_LOAD_PER_FRAME = 1;
+int WORKER_THREADS = 0;
+int PIN_WORKER_THREADS = 0;
 int CHUNK_CACHE_SIZE = 1024;
 int WIREFRAME = 0;
+int ORDER_INDEPENDENT_TRANSPARENCY = 1;
+int OCCLUSION_CULLING = 1;
 char* ATLAS_PATH = "res/textures/atlas.png";
 char* BUMP_PATH = "res/textures/bump.png";
 char* SKYBOX_PATH = "res/textures/skybox.png";
@@ -27,6 +29,8 @@ int CAUSTIC_TEXTURE_INDEX = 2;
 int SKYBOX_TEXTURE_INDEX = 3;
 int SHADOW_MAP_TEXTURE_INDEX = 4;
 int REFLECTION_MAP_TEXTURE_INDEX = 5;
+int OIT_ACCUM_TEXTURE_INDEX = 6;
+int OIT_WEIGHT_TEXTURE_INDEX = 7;
 int VSYNC = 1;
 int FULLSCREEN = 0;
 int CHUNK_RENDER_DISTANCE = 16;
@@ -34,9 +38,13 @@ int LOD_SCALING_CONSTANT = 2;
 int MAX_LOD_BLOCK_SIZE = 4;
 int FOLIAGE_RENDER_DISTANCE = 16;
 int TRANSPARENT_RENDER_DISTANCE = 16;
-int CHUNK_SKIRT_DEPTH = 2;
-int SHADOW_MAP_WIDTH = 10000;
-int SHADOW_MAP_HEIGHT = 10000;
+int MESH_CACHE = 1;
+char* MESH_CACHE_DIR = "./cache/meshes/";
+int MESH_CACHE_MAX_MB = 256;
+int MESH_SECTIONS = 4;
+int MESH_SECTION_DISTANCE = 1;
+int SHADOW_MAP_WIDTH = 2048;
+int SHADOW_MAP_HEIGHT = 2048;
 float SHADOW_RENDER_DIST = 16.0f * 16.0f;
 float SHADOW_LIGHT_DISTANCE = 16.0f * 16.0f;
 float SHADOW_NEAR_CLIP = 1.0f;
@@ -45,6 +53,9 @@ float SHADOW_POLYGON_OFFSET_UNITS = 4.0f;
 float SHADOW_SOFTNESS = 3.0f;
 int SHADOW_SAMPLES = 4;
 float SHADOW_BIAS = 0.0025f;
+int SHADOW_CASCADES = 3;
+float SHADOW_CASCADE_SCALE = 3.0f;
+float SHADOW_CASCADE_SUN_ANGLE = 1.0f;
 int REFLECTION_FBO_WIDTH = 512;
 int REFRACTION_FBO_HEIGHT = 512;
 int TICK_RATE = 32;
@@ -128,6 +139,8 @@ char* SHADOW_VERTEX_SHADER = "res/shaders/effects/shadow.vert";
 char* SHADOW_FRAGMENT_SHADER = "res/shaders/effects/shadow.frag";
 char* REFLECTION_VERTEX_SHADER = "res/shaders/effects/reflection.vert";
 char* REFLECTION_FRAGMENT_SHADER = "res/shaders/effects/reflection.frag";
+char* OIT_COMPOSITE_VERTEX_SHADER = "res/shaders/effects/oit_composite.vert";
+char* OIT_COMPOSITE_FRAGMENT_SHADER = "res/shaders/effects/oit_composite.frag";
 char* OUTLINE_VERTEX_SHADER = "res/shaders/ui/outline.vert";
 char* OUTLINE_FRAGMENT_SHADER = "res/shaders/ui/outline.frag";
 char* UI_VERTEX_SHADER = "res/shaders/ui/ui.vert";
@@ -258,15 +271,17 @@ void parse_chunks_settings(json_object chunks_obj) {
     json_object worker_threads = json_get_property(chunks_obj, "worker_threads");
     if (worker_threads.type == JSON_NUMBER) {
         int threads = (int)worker_threads.value.number;
-        // Clamp to valid range 1-16
+        // Clamp to valid range 1-64
         if (threads < 1) threads = 1;
-        if (threads > 16) threads = 16;
+        if (threads > 64) threads = 64;
         WORKER_THREADS = threads;
+    } else if (worker_threads.type == JSON_STRING && strcmp(worker_threads.value.string, "auto") == 0) {
+        WORKER_THREADS = 0;
     }
 
-    json_object chunk_load_per_frame = json_get_property(chunks_obj, "chunk_load_per_frame");
-    if (chunk_load_per_frame.type == JSON_NUMBER) {
-        CHUNK_LOAD_PER_FRAME = (int)chunk_load_per_frame.value.number;
+    json_object pin_worker_threads = json_get_property(chunks_obj, "pin_worker_threads");
+    if (pin_worker_threads.type == JSON_BOOL) {
+        PIN_WORKER_THREADS = pin_worker_threads.value.boolean ? 1 : 0;
     }
 
     json_object chunk_cache_size = json_get_property(chunks_obj, "chunk_cache_size");
@@ -299,9 +314,29 @@ void parse_chunks_settings(json_object chunks_obj) {
         TRANSPARENT_RENDER_DISTANCE = (int)transparent_render_distance.value.number;
     }
 
-    json_object chunk_skirt_depth = json_get_property(chunks_obj, "chunk_skirt_depth");
-    if (chunk_skirt_depth.type == JSON_NUMBER) {
-        CHUNK_SKIRT_DEPTH = (int)chunk_skirt_depth.value.number;
+    json_object mesh_cache = json_get_property(chunks_obj, "mesh_cache");
+    if (mesh_cache.type == JSON_BOOL) {
+        MESH_CACHE = mesh_cache.value.boolean ? 1 : 0;
+    }
+
+    json_object mesh_cache_dir = json_get_property(chunks_obj, "mesh_cache_dir");
+    if (mesh_cache_dir.type == JSON_STRING) {
+        MESH_CACHE_DIR = strdup(mesh_cache_dir.value.string);
+    }
+
+    json_object mesh_cache_max_mb = json_get_property(chunks_obj, "mesh_cache_max_mb");
+    if (mesh_cache_max_mb.type == JSON_NUMBER) {
+        MESH_CACHE_MAX_MB = (int)mesh_cache_max_mb.value.number;
+    }
+
+    json_object mesh_sections = json_get_property(chunks_obj, "mesh_sections");
+    if (mesh_sections.type == JSON_NUMBER) {
+        MESH_SECTIONS = (int)mesh_sections.value.number;
+    }
+
+    json_object mesh_section_distance = json_get_property(chunks_obj, "mesh_section_distance");
+    if (mesh_section_distance.type == JSON_NUMBER) {
+        MESH_SECTION_DISTANCE = (int)mesh_section_distance.value.number;
     }
 }
 
@@ -316,6 +351,16 @@ void parse_graphics_settings(json_object graphics_obj) {
         WIREFRAME = wireframe.value.boolean ? 1 : 0;
     }
 
+    json_object order_independent_transparency = json_get_property(graphics_obj, "order_independent_transparency");
+    if (order_independent_transparency.type == JSON_BOOL) {
+        ORDER_INDEPENDENT_TRANSPARENCY = order_independent_transparency.value.boolean ? 1 : 0;
+    }
+
+    json_object occlusion_culling = json_get_property(graphics_obj, "occlusion_culling");
+    if (occlusion_culling.type == JSON_BOOL) {
+        OCCLUSION_CULLING = occlusion_culling.value.boolean ? 1 : 0;
+    }
+
     json_object render_distance = json_get_property(graphics_obj, "render_distance");
     if (render_distance.type == JSON_NUMBER) {
         RENDER_DISTANCE = render_distance.value.number;
@@ -444,6 +489,25 @@ void parse_shadows_settings(json_object shadows_obj) {
     if (shadow_bias.type == JSON_NUMBER) {
         SHADOW_BIAS = shadow_bias.value.number;
     }
+
+    json_object shadow_cascades = json_get_property(shadows_obj, "shadow_cascades");
+    if (shadow_cascades.type == JSON_NUMBER) {
+        int cascades = (int)shadow_cascades.value.number;
+        // Clamp to valid range 1-MAX_SHADOW_CASCADES
+        if (cascades < 1) cascades = 1;
+        if (cascades > MAX_SHADOW_CASCADES) cascades = MAX_SHADOW_CASCADES;
+        SHADOW_CASCADES = cascades;
+    }
+
+    json_object shadow_cascade_scale = json_get_property(shadows_obj, "shadow_cascade_scale");
+    if (shadow_cascade_scale.type == JSON_NUMBER) {
+        SHADOW_CASCADE_SCALE = shadow_cascade_scale.value.number;
+    }
+
+    json_object shadow_cascade_sun_angle = json_get_property(shadows_obj, "shadow_cascade_sun_angle");
+    if (shadow_cascade_sun_angle.type == JSON_NUMBER) {
+        SHADOW_CASCADE_SUN_ANGLE = shadow_cascade_sun_angle.value.number;
+    }
 }
 
 void parse_reflections_settings(json_object reflections_obj) {
@@ -876,6 +940,16 @@ void parse_shader_settings(json_object shader_obj) {
         REFLECTION_FRAGMENT_SHADER = strdup(reflection_fragment.value.string);
     }
 
+    json_object oit_composite_vertex = json_get_property(shader_obj, "oit_composite_vertex");
+    if (oit_composite_vertex.type == JSON_STRING) {
+        OIT_COMPOSITE_VERTEX_SHADER = strdup(oit_composite_vertex.value.string);
+    }
+
+    json_object oit_composite_fragment = json_get_property(shader_obj, "oit_composite_fragment");
+    if (oit_composite_fragment.type == JSON_STRING) {
+        OIT_COMPOSITE_FRAGMENT_SHADER = strdup(oit_composite_fragment.value.string);
+    }
+
     json_object outline_vertex = json_get_property(shader_obj, "outline_vertex");
     if (outline_vertex.type == JSON_STRING) {
         OUTLINE_VERTEX_SHADER = strdup(outline_vertex.value.string);
@@ -16,13 +16,14 @@ extern float TIME_SCALE;
 // Chunk size
 #define CHUNK_SIZE 16
 #define CHUNK_HEIGHT 256
+// Chunks are split into cubes this tall for occlusion culling
+#define VISIBILITY_SECTION_HEIGHT 16
+#define VISIBILITY_SECTIONS (CHUNK_HEIGHT / VISIBILITY_SECTION_HEIGHT)
 // Number of worker threads for chunk mesh generation
-// Valid range: 1-16
+// Valid range: 1-64, 0 ("auto") sizes the pool to the usable CPUs
 extern int WORKER_THREADS;
-// How many chunks can be loaded per frame.  
-// Higher values will load chunks faster, but may cause stuttering.
-extern int CHUNK_LOAD_PER_FRAME;
-
+// Pin the render thread to its CPU and the workers to the others
+extern int PIN_WORKER_THREADS;
 // Chunks are cached in memory to reduce load times, how large should the cache be?
 extern int CHUNK_CACHE_SIZE;
 
@@ -32,6 +33,13 @@ extern int CHUNK_CACHE_SIZE;
 // Render as wireframe? Useful for debugging
 extern int WIREFRAME;
 
+// Blend transparent and foliage faces with weighted blended order-independent
+// transparency instead of sorting them on the CPU
+extern int ORDER_INDEPENDENT_TRANSPARENCY;
+
+// Skip chunk sections the camera cannot see through the terrain
+extern int OCCLUSION_CULLING;
+
 extern char* ATLAS_PATH;
 extern char* BUMP_PATH;
 extern char* SKYBOX_PATH;
@@ -43,6 +51,8 @@ extern int CAUSTIC_TEXTURE_INDEX;
 extern int SKYBOX_TEXTURE_INDEX;
 extern int SHADOW_MAP_TEXTURE_INDEX;
 extern int REFLECTION_MAP_TEXTURE_INDEX;
+extern int OIT_ACCUM_TEXTURE_INDEX;
+extern int OIT_WEIGHT_TEXTURE_INDEX;
 
 // Vsync on?  Comment to disable
 extern int VSYNC;
@@ -57,12 +67,22 @@ extern int MAX_LOD_BLOCK_SIZE;
 extern int FOLIAGE_RENDER_DISTANCE;
 extern int TRANSPARENT_RENDER_DISTANCE;
 
-// Chunk boundary skirt depth (blocks) to hide LOD seams
-extern int CHUNK_SKIRT_DEPTH;
+// Keep finished chunk meshes on disk so startup and revisits skip meshing
+extern int MESH_CACHE;
+extern char* MESH_CACHE_DIR;
+// Past this size the least recently used cache files are deleted
+extern int MESH_CACHE_MAX_MB;
+
+// Chunks within MESH_SECTION_DISTANCE of the player, and edited chunks, are
+// split into MESH_SECTIONS vertical slices meshed in parallel
+extern int MESH_SECTIONS;
+extern int MESH_SECTION_DISTANCE;
 
 // Shadow map settings
-extern int SHADOW_MAP_WIDTH;
-extern int SHADOW_MAP_HEIGHT;
+// Size of the sunCascades array in the world shaders
+#define MAX_SHADOW_CASCADES 4
+extern int SHADOW_MAP_WIDTH;   // per cascade
+extern int SHADOW_MAP_HEIGHT;  // per cascade
 extern float SHADOW_RENDER_DIST;
 extern float SHADOW_LIGHT_DISTANCE;
 extern float SHADOW_NEAR_CLIP;
@@ -71,6 +91,14 @@ extern float SHADOW_POLYGON_OFFSET_UNITS;
 extern float SHADOW_SOFTNESS;
 extern int SHADOW_SAMPLES;
 extern float SHADOW_BIAS;
+// Valid range: 1-MAX_SHADOW_CASCADES, the first is redrawn every frame and
+// the rest only when the sun, the player or their chunks move on
+extern int SHADOW_CASCADES;
+// Each cascade is this many times wider than the one before, the last one
+// reaches SHADOW_RENDER_DIST
+extern float SHADOW_CASCADE_SCALE;
+// Degrees the sun turns before a cached cascade is redrawn
+extern float SHADOW_CASCADE_SUN_ANGLE;
 
 // Reflection Settings
 extern int REFLECTION_FBO_WIDTH;
@@ -203,6 +231,8 @@ extern char* SHADOW_VERTEX_SHADER;
 extern char* SHADOW_FRAGMENT_SHADER;
 extern char* REFLECTION_VERTEX_SHADER;
 extern char* REFLECTION_FRAGMENT_SHADER;
+extern char* OIT_COMPOSITE_VERTEX_SHADER;
+extern char* OIT_COMPOSITE_FRAGMENT_SHADER;
 extern char* OUTLINE_VERTEX_SHADER;
 extern char* OUTLINE_FRAGMENT_SHADER;
 extern char* UI_VERTEX_SHADER;
@@ -1,6 +1,29 @@
 #include "sort.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <string.h>
 
+// Incremental sorts give up on insertion sort past these limits
+#define SORT_INCREMENTAL_MAX_DESCENT_RATIO 16 // at most 1 in 16 elements out of order
+#define SORT_INCREMENTAL_MOVE_FACTOR 4        // at most 4 shifts per element
+
+typedef struct {
+    uint32_t key;
+    uint32_t index;
+} sort_entry;
+
+typedef struct {
+    sort_entry* entries;
+    sort_entry* temp;
+    size_t entry_capacity;
+    char* items;
+    size_t item_capacity; // in bytes
+} sort_scratch;
+
+static pthread_key_t sort_scratch_key;
+static pthread_once_t sort_scratch_key_once = PTHREAD_ONCE_INIT;
+
 void swap(void* a, void* b, size_t size) {
     char temp[size];
     memcpy(temp, a, size);
@@ -41,4 +64,178 @@ void quicksort(void* array, size_t count, size_t elem_size, sort_key_fn get_key)
         return;
         
     _quicksort(array, 0, count - 1, elem_size, get_key);
-}
\ No newline at end of file
+}
+
+static void free_sort_scratch(void* ptr) {
+    sort_scratch* scratch = (sort_scratch*)ptr;
+    if (scratch == NULL) {
+        return;
+    }
+
+    free(scratch->entries);
+    free(scratch->temp);
+    free(scratch->items);
+    free(scratch);
+}
+
+static void init_sort_scratch_key(void) {
+    pthread_key_create(&sort_scratch_key, free_sort_scratch);
+}
+
+static sort_scratch* get_sort_scratch(size_t count, size_t elem_size) {
+    pthread_once(&sort_scratch_key_once, init_sort_scratch_key);
+
+    sort_scratch* scratch = (sort_scratch*)pthread_getspecific(sort_scratch_key);
+    if (scratch == NULL) {
+        scratch = calloc(1, sizeof(sort_scratch));
+        assert(scratch != NULL && "Failed to allocate sort scratch");
+        pthread_setspecific(sort_scratch_key, scratch);
+    }
+
+    if (count > scratch->entry_capacity) {
+        size_t capacity = scratch->entry_capacity > 0 ? scratch->entry_capacity : 64;
+        while (capacity < count) {
+            capacity *= 2;
+        }
+        free(scratch->entries);
+        free(scratch->temp);
+        scratch->entries = malloc(capacity * sizeof(sort_entry));
+        scratch->temp = malloc(capacity * sizeof(sort_entry));
+        assert(scratch->entries != NULL && scratch->temp != NULL && "Failed to allocate sort entries");
+        scratch->entry_capacity = capacity;
+    }
+
+    size_t item_bytes = count * elem_size;
+    if (item_bytes > scratch->item_capacity) {
+        free(scratch->items);
+        scratch->items = malloc(item_bytes);
+        assert(scratch->items != NULL && "Failed to allocate sort items");
+        scratch->item_capacity = item_bytes;
+    }
+
+    return scratch;
+}
+
+// Map a float to an unsigned int with the same ordering. Negative floats
+// have every bit flipped, positive floats only the sign bit.
+static inline uint32_t float_to_sortable(float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    uint32_t mask = (bits & 0x80000000u) ? 0xFFFFFFFFu : 0x80000000u;
+    return bits ^ mask;
+}
+
+static void compute_keys(sort_entry* entries, void* array, size_t count, size_t elem_size, sort_key_fn get_key) {
+    for (size_t i = 0; i < count; i++) {
+        entries[i].key = float_to_sortable(get_key((char*)array + i * elem_size));
+        entries[i].index = (uint32_t)i;
+    }
+}
+
+// LSD radix sort on 8 bit digits. All histograms are built in one pass and
+// digits every key shares are skipped, which is most of the high bytes for
+// distance keys. Returns whichever buffer holds the result.
+static sort_entry* radix_sort_entries(sort_entry* entries, sort_entry* temp, size_t count) {
+    size_t histograms[4][256];
+    memset(histograms, 0, sizeof(histograms));
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t key = entries[i].key;
+        histograms[0][key & 0xFF]++;
+        histograms[1][(key >> 8) & 0xFF]++;
+        histograms[2][(key >> 16) & 0xFF]++;
+        histograms[3][key >> 24]++;
+    }
+
+    sort_entry* src = entries;
+    sort_entry* dst = temp;
+    for (int pass = 0; pass < 4; pass++) {
+        int shift = pass * 8;
+        size_t* histogram = histograms[pass];
+        if (histogram[(src[0].key >> shift) & 0xFF] == count) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (int digit = 0; digit < 256; digit++) {
+            size_t digit_count = histogram[digit];
+            histogram[digit] = offset;
+            offset += digit_count;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+        }
+
+        sort_entry* swap_tmp = src;
+        src = dst;
+        dst = swap_tmp;
+    }
+
+    return src;
+}
+
+// Insertion sort that gives up once it has shifted more than max_moves
+// entries. Returns 0 if it gave up, entries are still a valid permutation.
+static int insertion_sort_entries(sort_entry* entries, size_t count, size_t max_moves) {
+    size_t moves = 0;
+    for (size_t i = 1; i < count; i++) {
+        sort_entry current = entries[i];
+        size_t j = i;
+        while (j > 0 && entries[j - 1].key > current.key) {
+            entries[j] = entries[j - 1];
+            j--;
+            if (++moves > max_moves) {
+                entries[j] = current;
+                return 0;
+            }
+        }
+        entries[j] = current;
+    }
+    return 1;
+}
+
+static void permute(void* array, size_t count, size_t elem_size, sort_entry* sorted, char* items) {
+    for (size_t i = 0; i < count; i++) {
+        memcpy(items + i * elem_size, (char*)array + (size_t)sorted[i].index * elem_size, elem_size);
+    }
+    memcpy(array, items, count * elem_size);
+}
+
+void radix_sort(void* array, size_t count, size_t elem_size, sort_key_fn get_key) {
+    if (array == NULL || count <= 1)
+        return;
+
+    sort_scratch* scratch = get_sort_scratch(count, elem_size);
+    compute_keys(scratch->entries, array, count, elem_size, get_key);
+
+    sort_entry* sorted = radix_sort_entries(scratch->entries, scratch->temp, count);
+    permute(array, count, elem_size, sorted, scratch->items);
+}
+
+void sort_incremental(void* array, size_t count, size_t elem_size, sort_key_fn get_key) {
+    if (array == NULL || count <= 1)
+        return;
+
+    sort_scratch* scratch = get_sort_scratch(count, elem_size);
+    sort_entry* entries = scratch->entries;
+    compute_keys(entries, array, count, elem_size, get_key);
+
+    size_t descents = 0;
+    for (size_t i = 1; i < count; i++) {
+        descents += entries[i].key < entries[i - 1].key;
+    }
+
+    // Nothing moved relative to each other since the last sort
+    if (descents == 0) {
+        return;
+    }
+
+    sort_entry* sorted = entries;
+    if (descents > count / SORT_INCREMENTAL_MAX_DESCENT_RATIO
+        || !insertion_sort_entries(entries, count, count * SORT_INCREMENTAL_MOVE_FACTOR)) {
+        sorted = radix_sort_entries(entries, scratch->temp, count);
+    }
+
+    permute(array, count, elem_size, sorted, scratch->items);
+}
@@ -7,4 +7,16 @@ typedef float (*sort_key_fn)(const void* item);
 
 void quicksort(void* array, size_t count, size_t elem_size, sort_key_fn get_key);
 
-#endif
\ No newline at end of file
+// Sort ascending by key. Keys are computed once per element, the
+// (key, index) pairs are LSD radix sorted and the array is permuted once.
+// Stable, scratch memory is kept per thread.
+void radix_sort(void* array, size_t count, size_t elem_size, sort_key_fn get_key);
+
+// Same result as radix_sort, but for arrays that were sorted last time and
+// have only drifted since (e.g. faces re-sorted as the camera moves).
+// Already sorted input is detected without moving anything, a few
+// out-of-order elements are fixed with a bounded insertion sort, and
+// anything more falls back to the radix sort.
+void sort_incremental(void* array, size_t count, size_t elem_size, sort_key_fn get_key);
+
+#endif
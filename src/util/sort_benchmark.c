@@ -0,0 +1,128 @@
+#include "sort_benchmark.h"
+#include "sort.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define SORT_BENCHMARK_ITERATIONS 5
+
+// Same size as a side_instance so copies cost the same
+typedef struct {
+    int x, y, z;
+    int payload[9];
+} bench_item;
+
+static float bench_camera[3];
+
+static float bench_distance_key(const void* item) {
+    const bench_item* b = (const bench_item*)item;
+    // matches the old key: negative distance for back to front
+    return -1.0f * sqrt(
+        pow((float)b->x - bench_camera[0], 2) +
+        pow((float)b->y - bench_camera[1], 2) +
+        pow((float)b->z - bench_camera[2], 2)
+    );
+}
+
+static double bench_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+static void fill_items(bench_item* items, int count) {
+    for (int i = 0; i < count; i++) {
+        items[i].x = rand() % 512 - 256;
+        items[i].y = rand() % 128;
+        items[i].z = rand() % 512 - 256;
+        memset(items[i].payload, 0, sizeof(items[i].payload));
+    }
+}
+
+static int is_sorted(bench_item* items, int count) {
+    for (int i = 1; i < count; i++) {
+        if (bench_distance_key(&items[i]) < bench_distance_key(&items[i - 1])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+typedef void (*sort_fn)(void* array, size_t count, size_t elem_size, sort_key_fn get_key);
+
+typedef enum {
+    BENCH_INPUT_SHUFFLED = 0,
+    BENCH_INPUT_MOVED,     // sorted, then the camera moves a quarter block
+    BENCH_INPUT_UNCHANGED, // sorted, camera has not moved
+    BENCH_INPUT_COUNT
+} bench_input;
+
+static const char* bench_input_names[BENCH_INPUT_COUNT] = {
+    "shuffled",
+    "moved",
+    "unchanged"
+};
+
+// Best of several runs
+static double time_sort(sort_fn sort, bench_item* source, bench_item* work, int count, bench_input input) {
+    double best = -1.0;
+    for (int i = 0; i < SORT_BENCHMARK_ITERATIONS; i++) {
+        memcpy(work, source, count * sizeof(bench_item));
+        bench_camera[0] = 0.0f;
+        bench_camera[1] = 64.0f;
+        bench_camera[2] = 0.0f;
+        if (input != BENCH_INPUT_SHUFFLED) {
+            radix_sort(work, count, sizeof(bench_item), bench_distance_key);
+        }
+        if (input == BENCH_INPUT_MOVED) {
+            bench_camera[0] = 0.25f;
+        }
+
+        double start = bench_now_ms();
+        sort(work, count, sizeof(bench_item), bench_distance_key);
+        double elapsed = bench_now_ms() - start;
+
+        if (!is_sorted(work, count)) {
+            printf("[benchmark] ERROR: output not sorted\n");
+        }
+        if (best < 0.0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+void run_sort_benchmark(void) {
+    const int sizes[] = {1024, 4096, 16384};
+    const int num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+
+    srand(1);
+    printf("[benchmark] sort, best of %d runs\n", SORT_BENCHMARK_ITERATIONS);
+    printf("[benchmark]   %-8s %-10s %12s %12s %12s\n", "count", "input", "quicksort", "radix", "incremental");
+
+    for (int s = 0; s < num_sizes; s++) {
+        int count = sizes[s];
+        bench_item* source = malloc(count * sizeof(bench_item));
+        bench_item* work = malloc(count * sizeof(bench_item));
+        if (source == NULL || work == NULL) {
+            printf("[benchmark] ERROR: failed to allocate %d items\n", count);
+            free(source);
+            free(work);
+            return;
+        }
+        fill_items(source, count);
+
+        for (int input = 0; input < BENCH_INPUT_COUNT; input++) {
+            double quick_ms = time_sort(quicksort, source, work, count, input);
+            double radix_ms = time_sort(radix_sort, source, work, count, input);
+            double incremental_ms = time_sort(sort_incremental, source, work, count, input);
+            printf("[benchmark]   %-8d %-10s %9.3f ms %9.3f ms %9.3f ms\n",
+                   count, bench_input_names[input], quick_ms, radix_ms, incremental_ms);
+        }
+
+        free(source);
+        free(work);
+    }
+}
@@ -0,0 +1,9 @@
+#ifndef SORT_BENCHMARK_H
+#define SORT_BENCHMARK_H
+
+// Time quicksort against radix_sort and sort_incremental on face-sized
+// items sorted by distance, both freshly shuffled and after a small camera
+// move. Run with --benchmark-sort.
+void run_sort_benchmark(void);
+
+#endif
@@ -0,0 +1,118 @@
+#include "thread_event.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <time.h>
+
+#define THREAD_USAGE_MAX 16
+
+// When the calling thread last switched between busy and idle
+static _Thread_local long long usage_mark_us = 0;
+
+static pthread_mutex_t usage_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static thread_usage* usage_registry[THREAD_USAGE_MAX];
+static int usage_count = 0;
+
+static long long now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + (long long)(ts.tv_nsec / 1000LL);
+}
+
+void event_notify(thread_event* event) {
+    pthread_mutex_lock(&event->mutex);
+    event->pending = 1;
+    pthread_cond_signal(&event->signal);
+    pthread_mutex_unlock(&event->mutex);
+}
+
+int event_wait(thread_event* event, int timeout_ms, thread_usage* usage) {
+    struct timespec deadline;
+    if (timeout_ms >= 0) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    pthread_mutex_lock(&event->mutex);
+    if (!event->pending && usage != NULL) {
+        thread_usage_idle(usage);
+    }
+    int waited = !event->pending;
+    while (!event->pending) {
+        int result = timeout_ms >= 0
+            ? pthread_cond_timedwait(&event->signal, &event->mutex, &deadline)
+            : pthread_cond_wait(&event->signal, &event->mutex);
+        if (result == ETIMEDOUT) {
+            break;
+        }
+    }
+    int notified = event->pending;
+    event->pending = 0;
+    pthread_mutex_unlock(&event->mutex);
+
+    if (waited && usage != NULL) {
+        thread_usage_wake(usage);
+    }
+    return notified;
+}
+
+void thread_usage_begin(thread_usage* usage) {
+    (void)usage;
+    usage_mark_us = now_us();
+}
+
+void thread_usage_idle(thread_usage* usage) {
+    long long now = now_us();
+    atomic_fetch_add_explicit(&usage->busy_us, now - usage_mark_us, memory_order_relaxed);
+    usage_mark_us = now;
+}
+
+void thread_usage_wake(thread_usage* usage) {
+    long long now = now_us();
+    atomic_fetch_add_explicit(&usage->idle_us, now - usage_mark_us, memory_order_relaxed);
+    atomic_fetch_add_explicit(&usage->wakeups, 1, memory_order_relaxed);
+    usage_mark_us = now;
+}
+
+void thread_usage_end(thread_usage* usage) {
+    thread_usage_idle(usage);
+}
+
+void thread_usage_register(thread_usage* usage) {
+    pthread_mutex_lock(&usage_registry_mutex);
+    if (usage_count < THREAD_USAGE_MAX) {
+        usage_registry[usage_count++] = usage;
+    }
+    pthread_mutex_unlock(&usage_registry_mutex);
+}
+
+void thread_usage_unregister(thread_usage* usage) {
+    pthread_mutex_lock(&usage_registry_mutex);
+    for (int i = 0; i < usage_count; i++) {
+        if (usage_registry[i] == usage) {
+            usage_registry[i] = usage_registry[--usage_count];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&usage_registry_mutex);
+}
+
+void print_thread_usage(void) {
+    pthread_mutex_lock(&usage_registry_mutex);
+    for (int i = 0; i < usage_count; i++) {
+        thread_usage* usage = usage_registry[i];
+        long long busy = atomic_load_explicit(&usage->busy_us, memory_order_relaxed);
+        long long idle = atomic_load_explicit(&usage->idle_us, memory_order_relaxed);
+        long long total = busy + idle;
+        printf("[profile] thread %-12s busy %8.1f ms idle %8.1f ms (%5.1f%% busy), %lu wakeups\n",
+               usage->name, busy / 1000.0, idle / 1000.0,
+               total > 0 ? 100.0 * (double)busy / (double)total : 0.0,
+               atomic_load_explicit(&usage->wakeups, memory_order_relaxed));
+    }
+    pthread_mutex_unlock(&usage_registry_mutex);
+}
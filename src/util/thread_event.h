@@ -0,0 +1,46 @@
+#ifndef THREAD_EVENT_H
+#define THREAD_EVENT_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Auto-reset event. Notifies while nobody waits are remembered, so a
+// waiter never misses one, and many notifies wake it once.
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t signal;
+    int pending;
+} thread_event;
+
+#define THREAD_EVENT_INITIALIZER { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0 }
+
+// Time a thread (or group of threads sharing one entry) spends working
+// versus waiting for work
+typedef struct {
+    const char* name;
+    atomic_llong busy_us;
+    atomic_llong idle_us;
+    atomic_ulong wakeups;
+} thread_usage;
+
+#define THREAD_USAGE_INITIALIZER(label) { label, 0, 0, 0 }
+
+void event_notify(thread_event* event);
+
+// Wait until notified or timeout_ms passed, < 0 waits forever. Time spent
+// here counts as idle for usage, which may be NULL. Returns 1 if notified.
+int event_wait(thread_event* event, int timeout_ms, thread_usage* usage);
+
+// Accounting for the calling thread, between begin and end every moment is
+// busy unless marked idle
+void thread_usage_begin(thread_usage* usage);
+void thread_usage_idle(thread_usage* usage);
+void thread_usage_wake(thread_usage* usage);
+void thread_usage_end(thread_usage* usage);
+
+// Registered usages are listed by print_thread_usage
+void thread_usage_register(thread_usage* usage);
+void thread_usage_unregister(thread_usage* usage);
+void print_thread_usage(void);
+
+#endif
@@ -8,6 +8,8 @@
 #include "../../mesh/geometry/blockbench_loader.h"
 #include "mesh.h"
 #include "world.h"
+#include "chunk_lod.h"
+#include "mesh_pipeline.h"
 
 #include <cglm/cglm.h>
 #include <glad/glad.h>
@@ -349,6 +351,7 @@ void modify_block(game_data* data, short block_id, float t_offset) {
     short water_level = type.liquid ? 7 : 0;
 
     set_block_info(data, c, chunk_x, chunk_y, chunk_z, block_id, hit_side, rot, water_level);
+    invalidate_chunk_lod(c->x, c->z);
 
     if (data->packet != NULL) {
         *data->num_packets = 0;
@@ -383,6 +386,7 @@ void modify_block(game_data* data, short block_id, float t_offset) {
     int px = WORLD_POS_TO_CHUNK_POS(data->player.position[0]);
     int pz = WORLD_POS_TO_CHUNK_POS(data->player.position[2]);
     queue_chunk_for_sorting(new_mesh, px, pz);
+    notify_mesh_pipeline();
 
     send_chunk_to_server(c);
 }
@@ -471,7 +475,7 @@ block_type get_block_type(short id) {
     return out;
 }
 
-void send_cube_vbo(VAO vao, VBO vbo) {
+void init_cube_vbo(VAO vao, VBO vbo) {
     float faceVertices[] = {
         0.0f, 0.0f, 0.0f,
         1.0f, 0.0f, 0.0f,
@@ -484,7 +488,6 @@ void send_cube_vbo(VAO vao, VBO vbo) {
     bind_vao(vao);
     buffer_data(vbo, GL_STATIC_DRAW, faceVertices, 6 * 3 * sizeof(float));
     f_add_attrib(&vbo, 0, 3, 0, 3 * sizeof(float)); // position
-    use_vbo(vbo);
 }
 
 void update_selected_block(player* p) {
@@ -31,6 +31,8 @@ bool check_block_foliage(short id);
 block_data_t get_block_data(int x, int y, int z, chunk* c);
 block_type get_block_type(short id);
 
-void send_cube_vbo(VAO vao, VBO vbo);
+// Fill vbo with the unit quad every block side is drawn from and point
+// attribute 0 of vao at it, once when the VAO is created
+void init_cube_vbo(VAO vao, VBO vbo);
 
 #endif
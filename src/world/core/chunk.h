@@ -14,7 +14,6 @@ typedef struct {
 
 uint chunk_hash(chunk_coord c);
 int chunk_equals(chunk_coord a, chunk_coord b);
-int chunk_coord_equals(void* a, void* b);
 
 void init_chunks();
 void chunk_create(chunk* c, int x, int z);
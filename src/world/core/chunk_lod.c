@@ -0,0 +1,334 @@
+#include "chunk_lod.h"
+#include "chunk.h"
+#include "block.h"
+#include <hashmap.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_BLOCK_IDS 1024
+
+typedef enum {
+    LOD_CLASS_AIR = 0,
+    LOD_CLASS_SOLID,
+    LOD_CLASS_LIQUID,
+    LOD_CLASS_DETAIL // foliage and custom models, never fill a cell on their own
+} lod_block_class;
+
+// Current pyramid of a chunk and how often the chunk changed, a pyramid is
+// stale once its edit count falls behind the slot's
+typedef struct {
+    chunk_lod* lod;
+    unsigned int edits;
+} chunk_lod_slot;
+
+DEFINE_HASHMAP(chunk_lod_map, chunk_coord, chunk_lod_slot, chunk_hash, chunk_equals);
+typedef chunk_lod_map_hashmap chunk_lod_map;
+
+static chunk_lod_map chunk_lods;
+static pthread_mutex_t chunk_lod_lock;
+
+static unsigned char block_classes[MAX_BLOCK_IDS];
+static block_data_t air_data;
+
+void init_chunk_lods(void) {
+    memset(block_classes, LOD_CLASS_AIR, sizeof(block_classes));
+
+    short air_id = get_block_id("air");
+    air_data = int_to_block_data(air_id & 0x3FF);
+
+    for (int i = 0; i < BLOCK_COUNT; i++) {
+        block_type type = TYPES[i];
+        if (type.id >= MAX_BLOCK_IDS || (short)type.id == air_id) {
+            continue;
+        }
+
+        if (type.liquid) {
+            block_classes[type.id] = LOD_CLASS_LIQUID;
+        } else if (type.is_foliage || type.is_custom_model) {
+            block_classes[type.id] = LOD_CLASS_DETAIL;
+        } else {
+            block_classes[type.id] = LOD_CLASS_SOLID;
+        }
+    }
+
+    chunk_lods = chunk_lod_map_init(CHUNK_CACHE_SIZE);
+    pthread_mutex_init(&chunk_lod_lock, NULL);
+}
+
+void chunk_lod_cleanup(void) {
+    for (size_t i = 0; i < chunk_lods.capacity; ++i) {
+        chunk_lod_map_entry* current = chunk_lods.buckets[i];
+        while (current) {
+            release_chunk_lod(current->value.lod);
+            current = current->next;
+        }
+    }
+    chunk_lod_map_free(&chunk_lods);
+    pthread_mutex_destroy(&chunk_lod_lock);
+}
+
+static inline int lod_index(int x, int y, int z, int width, int height) {
+    return (x * height + y) * width + z;
+}
+
+static inline lod_block_class get_lod_class(block_data_t data) {
+    short id = 0;
+    get_block_info(data, &id, NULL, NULL, NULL);
+    return (lod_block_class)block_classes[id];
+}
+
+static inline short get_lod_id(block_data_t data) {
+    short id = 0;
+    get_block_info(data, &id, NULL, NULL, NULL);
+    return id;
+}
+
+// Pick a representative for a 2x2x2 region of src.
+// A region is solid when at least half of it is solid, so a one block thick
+// surface layer survives every level. The solid id is voted on by the top-most
+// solid block of each column so the terrain keeps its surface material.
+static block_data_t vote_region(block_data_t* src, int x, int y, int z, int width, int height) {
+    block_data_t surface[4];
+    int num_surface = 0;
+    int num_solid = 0;
+    int num_liquid = 0;
+    short liquid_level = -1;
+    block_data_t liquid = air_data;
+    int has_detail = 0;
+    block_data_t detail = air_data;
+
+    for (int dx = 0; dx < 2; dx++) {
+        for (int dz = 0; dz < 2; dz++) {
+            int found_surface = 0;
+            for (int dy = 1; dy >= 0; dy--) {
+                block_data_t data = src[lod_index(x + dx, y + dy, z + dz, width, height)];
+                switch (get_lod_class(data)) {
+                    case LOD_CLASS_SOLID:
+                        num_solid++;
+                        if (!found_surface) {
+                            surface[num_surface++] = data;
+                            found_surface = 1;
+                        }
+                        break;
+                    case LOD_CLASS_LIQUID: {
+                        short water_level = 0;
+                        get_block_info(data, NULL, NULL, NULL, &water_level);
+                        num_liquid++;
+                        if (water_level > liquid_level) {
+                            liquid_level = water_level;
+                            liquid = data;
+                        }
+                        break;
+                    }
+                    case LOD_CLASS_DETAIL:
+                        if (!has_detail) {
+                            has_detail = 1;
+                            detail = data;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    if (num_solid * 2 >= 8) {
+        int best = 0;
+        int best_votes = 0;
+        for (int i = 0; i < num_surface; i++) {
+            int votes = 0;
+            for (int j = 0; j < num_surface; j++) {
+                votes += get_lod_id(surface[i]) == get_lod_id(surface[j]);
+            }
+            if (votes > best_votes) {
+                best = i;
+                best_votes = votes;
+            }
+        }
+        return surface[best];
+    }
+
+    if (num_liquid > 0 && (num_solid + num_liquid) * 2 >= 8) {
+        return liquid;
+    }
+
+    if (has_detail) {
+        return detail;
+    }
+
+    return air_data;
+}
+
+static void downsample_level(block_data_t* src, int width, int height, block_data_t* dst) {
+    int dst_width = width / 2;
+    int dst_height = height / 2;
+
+    for (int x = 0; x < dst_width; x++) {
+        for (int y = 0; y < dst_height; y++) {
+            for (int z = 0; z < dst_width; z++) {
+                dst[lod_index(x, y, z, dst_width, dst_height)] =
+                    vote_region(src, 2 * x, 2 * y, 2 * z, width, height);
+            }
+        }
+    }
+}
+
+// Each level is built from the one below it so the chunk is only walked once
+static void fill_chunk_lod(chunk_lod* l, chunk* c, unsigned int edits) {
+    atomic_init(&l->refs, 1);
+    l->x = c->x;
+    l->z = c->z;
+
+    downsample_level(&c->blocks[0][0][0], CHUNK_SIZE, CHUNK_HEIGHT, &l->lod2[0][0][0]);
+    downsample_level(&l->lod2[0][0][0], CHUNK_SIZE / 2, CHUNK_HEIGHT / 2, &l->lod4[0][0][0]);
+    downsample_level(&l->lod4[0][0][0], CHUNK_SIZE / 4, CHUNK_HEIGHT / 4, &l->lod8[0][0][0]);
+
+    l->edits = edits;
+}
+
+static chunk_lod* retain_chunk_lod(chunk_lod* l) {
+    if (l != NULL) {
+        atomic_fetch_add_explicit(&l->refs, 1, memory_order_relaxed);
+    }
+    return l;
+}
+
+void release_chunk_lod(chunk_lod* l) {
+    if (l != NULL && atomic_fetch_sub_explicit(&l->refs, 1, memory_order_acq_rel) == 1) {
+        free(l);
+    }
+}
+
+// Build a new pyramid from the chunk as it is now and swap it in for the old
+// one, which is freed once the last mesher sampling it lets go. The
+// downsample runs outside chunk_lod_lock so meshers only wait on the swap.
+// edits is the slot's edit count read before the build, a pyramid built
+// from older data never replaces a newer one.
+static chunk_lod* publish_chunk_lod(chunk* c, unsigned int edits) {
+    chunk_lod* l = malloc(sizeof(chunk_lod));
+    if (l == NULL) {
+        fprintf(stderr, "ERROR: Failed to allocate LOD pyramid for chunk (%d, %d)\n", c->x, c->z);
+        return NULL;
+    }
+    fill_chunk_lod(l, c, edits);
+
+    chunk_coord coord = {c->x, c->z};
+    pthread_mutex_lock(&chunk_lod_lock);
+    chunk_lod_slot* slot = chunk_lod_map_get(&chunk_lods, coord);
+    if (slot == NULL) {
+        chunk_lod_slot fresh = {retain_chunk_lod(l), edits};
+        chunk_lod_map_insert(&chunk_lods, coord, fresh);
+    } else if (slot->lod == NULL || slot->lod->edits <= edits) {
+        release_chunk_lod(slot->lod);
+        slot->lod = retain_chunk_lod(l);
+    }
+    pthread_mutex_unlock(&chunk_lod_lock);
+    return l;
+}
+
+// Count a change to the chunk and return the new edit count
+static unsigned int bump_chunk_lod_edits(int x, int z) {
+    chunk_coord coord = {x, z};
+
+    pthread_mutex_lock(&chunk_lod_lock);
+    chunk_lod_slot* slot = chunk_lod_map_get(&chunk_lods, coord);
+    unsigned int edits = 1;
+    if (slot != NULL) {
+        edits = ++slot->edits;
+    } else {
+        chunk_lod_slot fresh = {NULL, edits};
+        chunk_lod_map_insert(&chunk_lods, coord, fresh);
+    }
+    pthread_mutex_unlock(&chunk_lod_lock);
+    return edits;
+}
+
+void build_chunk_lod(chunk* c) {
+    if (c == NULL) {
+        return;
+    }
+
+    // New chunk data outdates any pyramid still being built from the old
+    release_chunk_lod(publish_chunk_lod(c, bump_chunk_lod_edits(c->x, c->z)));
+}
+
+void invalidate_chunk_lod(int x, int z) {
+    bump_chunk_lod_edits(x, z);
+}
+
+chunk_lod* get_chunk_lod(chunk* c) {
+    if (c == NULL) {
+        return NULL;
+    }
+
+    chunk_coord coord = {c->x, c->z};
+    pthread_mutex_lock(&chunk_lod_lock);
+    chunk_lod_slot* slot = chunk_lod_map_get(&chunk_lods, coord);
+    unsigned int edits = slot != NULL ? slot->edits : 0;
+    chunk_lod* l = slot != NULL && slot->lod != NULL && slot->lod->edits == edits ? retain_chunk_lod(slot->lod) : NULL;
+    pthread_mutex_unlock(&chunk_lod_lock);
+
+    // Missing or stale, the caller keeps the reference publish hands back
+    return l != NULL ? l : publish_chunk_lod(c, edits);
+}
+
+void evict_chunk_lods(int center_x, int center_z, int radius) {
+    pthread_mutex_lock(&chunk_lod_lock);
+    for (size_t i = 0; i < chunk_lods.capacity; ++i) {
+        chunk_lod_map_entry* current = chunk_lods.buckets[i];
+        while (current) {
+            chunk_lod_map_entry* next = current->next;
+            int dx = current->key.x - center_x;
+            int dz = current->key.z - center_z;
+            if (dx * dx + dz * dz > radius * radius) {
+                release_chunk_lod(current->value.lod);
+                chunk_lod_map_remove(&chunk_lods, current->key);
+            }
+            current = next;
+        }
+    }
+    pthread_mutex_unlock(&chunk_lod_lock);
+}
+
+int chunk_lod_has_level(short lod_scale) {
+    return lod_scale == 2 || lod_scale == 4 || lod_scale == 8;
+}
+
+block_data_t chunk_lod_sample(chunk_lod* l, short lod_scale, int x, int y, int z) {
+    if (l == NULL || x < 0 || z < 0 || y < 0
+        || x >= CHUNK_SIZE / lod_scale
+        || z >= CHUNK_SIZE / lod_scale
+        || y >= CHUNK_HEIGHT / lod_scale) {
+        return air_data;
+    }
+
+    switch (lod_scale) {
+        case 2:
+            return l->lod2[x][y][z];
+        case 4:
+            return l->lod4[x][y][z];
+        case 8:
+            return l->lod8[x][y][z];
+        default:
+            return air_data;
+    }
+}
+
+const block_data_t* chunk_lod_level(chunk_lod* l, short lod_scale) {
+    if (l == NULL) {
+        return NULL;
+    }
+
+    switch (lod_scale) {
+        case 2:
+            return &l->lod2[0][0][0];
+        case 4:
+            return &l->lod4[0][0][0];
+        case 8:
+            return &l->lod8[0][0][0];
+        default:
+            return NULL;
+    }
+}
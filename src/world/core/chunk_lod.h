@@ -0,0 +1,52 @@
+#ifndef CHUNK_LOD_H
+#define CHUNK_LOD_H
+
+#include <block_models.h>
+#include <util/settings.h>
+#include <stdatomic.h>
+
+// Largest block size stored in the pyramid (levels are 2x, 4x, 8x)
+#define CHUNK_LOD_MAX_SCALE 8
+
+// Downsampled copies of a chunk, one cell per lod_scale^3 block region.
+// Each cell holds the block data of a representative block chosen by a
+// surface-preserving majority vote over the region. Never changed once
+// built, a rebuild publishes a new pyramid and readers keep theirs until
+// they release it.
+typedef struct {
+    atomic_int refs;
+    int x, z;
+    unsigned int edits;  // edit count of the chunk it was built from
+    block_data_t lod2[CHUNK_SIZE / 2][CHUNK_HEIGHT / 2][CHUNK_SIZE / 2];
+    block_data_t lod4[CHUNK_SIZE / 4][CHUNK_HEIGHT / 4][CHUNK_SIZE / 4];
+    block_data_t lod8[CHUNK_SIZE / 8][CHUNK_HEIGHT / 8][CHUNK_SIZE / 8];
+} chunk_lod;
+
+void init_chunk_lods(void);
+void chunk_lod_cleanup(void);
+
+// Rebuild the pyramid for a chunk, called when new chunk data arrives
+void build_chunk_lod(chunk* c);
+
+// Mark the pyramid stale after an edit, it is rebuilt on next access
+void invalidate_chunk_lod(int x, int z);
+
+// Drop the pyramids of chunks farther than radius chunks from the center,
+// meshers still sampling one keep it until they release it
+void evict_chunk_lods(int center_x, int center_z, int radius);
+
+// Get the pyramid for a chunk, building it if missing or stale. The caller
+// holds a reference and must hand it back with release_chunk_lod.
+chunk_lod* get_chunk_lod(chunk* c);
+void release_chunk_lod(chunk_lod* l);
+
+// Returns true if lod_scale has a level in the pyramid
+int chunk_lod_has_level(short lod_scale);
+
+// Sample a cell of the given level, cell coordinates are in units of lod_scale
+block_data_t chunk_lod_sample(chunk_lod* l, short lod_scale, int x, int y, int z);
+
+// Cells of one level laid out [x][y][z], NULL if there is no such level
+const block_data_t* chunk_lod_level(chunk_lod* l, short lod_scale);
+
+#endif
@@ -1,5 +1,6 @@
 #include "world.h"
 #include "chunk.h"
+#include "chunk_lod.h"
 #include "../../server/compression/compression.h"
 #include "../../util/settings.h"
 #include <hashmap.h>
@@ -31,6 +32,8 @@ void init_world() {
 
     chunks = chunk_map_init(CHUNK_CACHE_SIZE);
     pthread_mutex_init(&chunk_map_lock, NULL);
+
+    init_chunk_lods();
 }
 
 void world_cleanup() {
@@ -44,6 +47,7 @@ void world_cleanup() {
         }
     }
     chunk_map_free(&chunks);
+    chunk_lod_cleanup();
 }
 
 chunk* get_chunk(int x, int z) {
@@ -59,6 +63,8 @@ chunk* get_chunk(int x, int z) {
         pthread_mutex_lock(&chunk_map_lock);
         chunk_map_insert(&chunks, coord, c);
         pthread_mutex_unlock(&chunk_map_lock);
+
+        build_chunk_lod(c);
     }
     return c;
 }
@@ -71,6 +77,8 @@ void update_chunk(chunk* c) {
     if (existing) free(*existing);
     chunk_map_insert(&chunks, coord, c);
     pthread_mutex_unlock(&chunk_map_lock);
+
+    build_chunk_lod(c);
 }
 
 chunk* get_chunk_at(float x, float z, int* chunk_x, int* chunk_z) {